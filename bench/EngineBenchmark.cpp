@@ -0,0 +1,388 @@
+// 撮合引擎基准：在进程内直接驱动 MatchingEngine，不经过 ZeroMQ 收发，也不写数据库，
+// 输入为合成订单流或录制的输入日志，统计吞吐量和每条输入的撮合延迟分布
+//
+// 用法: EngineBenchmark [--orders=N] [--depth=N] [--width=TICKS] [--distribution=normal|uniform]
+//                       [--cancel=RATIO] [--amend=RATIO] [--market=RATIO] [--ioc=RATIO]
+//                       [--batch=N] [--warmup=N] [--seed=N] [--mass=N] [--journal=PATH] [--config=FILE] [--journal-dir=DIR]
+//   --mass       合成订单流每 N 条指令打包成一条批量下单消息（同一组属于同一用户），衡量批量下单的收益
+//   --journal    回放录制的输入日志（撮合引擎 journalDir 下的 <交易对>.journal，读取其各段，只含最近一次快照之后的输入），代替合成订单流
+//   --config     从配置文件读取交易对和撮合参数，回放日志时交易对须与录制时一致
+//   --journal-dir 撮合时同时记输入日志，用于衡量记日志的开销
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+#include "EngineConfig.h"
+#include "Instrument.h"
+#include "Journal.h"
+#include "Logger.h"
+#include "MatchingEngine.h"
+#include "Metrics.h"
+#include "WireProtocol.h"
+
+namespace {
+
+struct BenchOptions {
+    size_t orders = 1000000;
+    size_t depth = 1000;            // 计时前每边预先挂入的订单数
+    int64_t width = 2000;           // 价格相对中间价的分布宽度，单位 tick
+    std::string distribution = "normal";
+    double cancelRatio = 0.2;
+    double amendRatio = 0.0;
+    double marketRatio = 0.0;
+    double iocRatio = 0.0;
+    size_t batch = DEFAULT_ORDER_BATCH_SIZE;
+    size_t warmup = 100000;         // 前 N 条指令不计入延迟统计，批量下单时按指令数换算成消息数
+    uint64_t seed = 42;
+    size_t mass = 1;                // 每条批量下单消息携带的指令数，1 表示逐条发送
+    std::string journal;
+    std::string config;
+    std::string journalDir;
+};
+
+bool parseOption(const char* arg, const char* name, std::string& value) {
+    size_t length = std::strlen(name);
+    if (std::strncmp(arg, name, length) != 0 || arg[length] != '=') {
+        return false;
+    }
+    value = arg + length + 1;
+    return true;
+}
+
+BenchOptions parseOptions(int argc, char* argv[]) {
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string value;
+        if (parseOption(argv[i], "--orders", value)) options.orders = std::stoull(value);
+        else if (parseOption(argv[i], "--depth", value)) options.depth = std::stoull(value);
+        else if (parseOption(argv[i], "--width", value)) options.width = std::stoll(value);
+        else if (parseOption(argv[i], "--distribution", value)) options.distribution = value;
+        else if (parseOption(argv[i], "--cancel", value)) options.cancelRatio = std::stod(value);
+        else if (parseOption(argv[i], "--amend", value)) options.amendRatio = std::stod(value);
+        else if (parseOption(argv[i], "--market", value)) options.marketRatio = std::stod(value);
+        else if (parseOption(argv[i], "--ioc", value)) options.iocRatio = std::stod(value);
+        else if (parseOption(argv[i], "--batch", value)) options.batch = std::max<size_t>(1, std::stoull(value));
+        else if (parseOption(argv[i], "--warmup", value)) options.warmup = std::stoull(value);
+        else if (parseOption(argv[i], "--seed", value)) options.seed = std::stoull(value);
+        else if (parseOption(argv[i], "--mass", value)) options.mass = std::min(std::max<size_t>(1, std::stoull(value)), MAX_MASS_ORDER_INSTRUCTIONS);
+        else if (parseOption(argv[i], "--journal", value)) options.journal = value;
+        else if (parseOption(argv[i], "--config", value)) options.config = value;
+        else if (parseOption(argv[i], "--journal-dir", value)) options.journalDir = value;
+        else {
+            std::fprintf(stderr, "unknown option: %s\n", argv[i]);
+            std::exit(1);
+        }
+    }
+    if (options.distribution != "normal" && options.distribution != "uniform") {
+        std::fprintf(stderr, "unknown distribution: %s\n", options.distribution.c_str());
+        std::exit(1);
+    }
+    return options;
+}
+
+// 每行输出一个延迟分布的分位数，直方图与运行指标共用同一套对数线性分桶
+void printLatencyRow(const char* name, const HistogramSnapshot& latency) {
+    std::printf("%-10s %10llu %10llu %10llu %10llu %10llu %12llu %10.1f\n", name,
+                static_cast<unsigned long long>(latency.percentile(50)), static_cast<unsigned long long>(latency.percentile(90)),
+                static_cast<unsigned long long>(latency.percentile(99)), static_cast<unsigned long long>(latency.percentile(99.9)),
+                static_cast<unsigned long long>(latency.percentile(99.99)), static_cast<unsigned long long>(latency.max),
+                latency.mean());
+}
+
+typedef std::vector<std::string> InputStream;
+
+template <typename T>
+void appendInput(InputStream& inputs, const T& message) {
+    inputs.emplace_back(reinterpret_cast<const char*>(&message), sizeof(message));
+}
+
+// 合成订单流：价格围绕中间价按正态或均匀分布，买单偏低、卖单偏高使订单簿保持深度；
+// 撤单和改单随机挑选此前提交过的限价单（可能已经成交，走拒绝路径）
+class SyntheticStream {
+public:
+    SyntheticStream(const BenchOptions& options, const Instrument& instrument)
+            : options(options), instrument(instrument), rng(options.seed) {
+    }
+
+    void prefill(InputStream& inputs) {
+        for (size_t i = 0; i < options.depth; ++i) {
+            appendInput(inputs, encodeOrderMessage(WireMessageType::NEW_ORDER, restingOrder(OrderSide::BUY, i)));
+            appendInput(inputs, encodeOrderMessage(WireMessageType::NEW_ORDER, restingOrder(OrderSide::SELL, i)));
+        }
+    }
+
+    void generate(InputStream& inputs, size_t count) {
+        std::uniform_real_distribution<double> action(0.0, 1.0);
+        for (size_t i = 0; i < count; ++i) {
+            double roll = action(rng);
+            if (roll < options.cancelRatio && !liveOrders.empty()) {
+                addCancel(inputs, pickLiveOrder(true));
+            } else if (roll < options.cancelRatio + options.amendRatio && !liveOrders.empty()) {
+                Price price = priceFor(randomSide());
+                addAmend(inputs, pickLiveOrder(false), price);
+            } else {
+                addOrder(inputs, newOrder());
+            }
+        }
+        flushMassOrder(inputs);
+    }
+
+private:
+    void addOrder(InputStream& inputs, const Order& order) {
+        if (options.mass <= 1) {
+            appendInput(inputs, encodeOrderMessage(WireMessageType::NEW_ORDER, order));
+            return;
+        }
+        addInstruction(inputs, MassInstruction{MassAction::NEW, order.orderSide, order.orderType, order.timeInForce,
+                                               order.orderId, order.price, order.quantity, order.feeRate});
+    }
+
+    void addCancel(InputStream& inputs, unsigned int orderId) {
+        if (options.mass <= 1) {
+            appendInput(inputs, encodeCancelMessage(instrument.symbol, orderId));
+            return;
+        }
+        addInstruction(inputs, MassInstruction{MassAction::CANCEL, OrderSide::UNKNOWN, OrderType::UNKNOWN, TimeInForce::GTC, orderId, 0, 0, 0});
+    }
+
+    void addAmend(InputStream& inputs, unsigned int orderId, Price price) {
+        if (options.mass <= 1) {
+            appendInput(inputs, encodeAmendMessage(instrument.symbol, orderId, price, 0));
+            return;
+        }
+        addInstruction(inputs, MassInstruction{MassAction::AMEND, OrderSide::UNKNOWN, OrderType::UNKNOWN, TimeInForce::GTC, orderId, price, 0, 0});
+    }
+
+    void addInstruction(InputStream& inputs, const MassInstruction& instruction) {
+        pendingInstructions.push_back(instruction);
+        if (pendingInstructions.size() >= options.mass) {
+            flushMassOrder(inputs);
+        }
+    }
+
+    // 同一组指令以组序号作为用户号
+    void flushMassOrder(InputStream& inputs) {
+        if (pendingInstructions.empty()) {
+            return;
+        }
+        Order common{};
+        common.symbol = instrument.symbol;
+        common.userId = ++lastMassUserId;
+        common.createTime = nowTimestamp();
+        inputs.push_back(encodeMassOrderMessage(common, pendingInstructions));
+        pendingInstructions.clear();
+    }
+
+    Order baseOrder(OrderSide side) {
+        std::uniform_int_distribution<int64_t> lots(1, 100);
+        Order order{};
+        order.orderId = ++lastOrderId;
+        order.userId = lastOrderId;
+        order.symbol = instrument.symbol;
+        order.orderSide = side;
+        order.orderType = OrderType::LIMIT;
+        order.status = OrderStatus::INITIAL;
+        order.quantity = lots(rng) * std::max<Quantity>(instrument.lotSize, QUANTITY_SCALE / 100);
+        order.quantity -= order.quantity % instrument.lotSize;
+        order.feeRate = 0;
+        order.filledQuantity = 0;
+        order.createTime = nowTimestamp();
+        order.updateTime = order.createTime;
+        return order;
+    }
+
+    // 预挂单：不与对手盘交叉，按距离中间价由近到远排开
+    Order restingOrder(OrderSide side, size_t index) {
+        Order order = baseOrder(side);
+        int64_t offset = 1 + static_cast<int64_t>(index % static_cast<size_t>(std::max<int64_t>(options.width, 1)));
+        order.price = (MID_TICKS + (side == OrderSide::BUY ? -offset : offset)) * instrument.tickSize;
+        liveOrders.push_back(order.orderId);
+        return order;
+    }
+
+    Order newOrder() {
+        std::uniform_real_distribution<double> kind(0.0, 1.0);
+        Order order = baseOrder(randomSide());
+        double roll = kind(rng);
+        if (roll < options.marketRatio) {
+            order.orderType = OrderType::MARKET;
+            order.price = 0;
+            return order;
+        }
+        order.price = priceFor(order.orderSide);
+        if (roll < options.marketRatio + options.iocRatio) {
+            order.timeInForce = TimeInForce::IOC;
+        } else {
+            liveOrders.push_back(order.orderId);
+        }
+        return order;
+    }
+
+    Price priceFor(OrderSide side) {
+        int64_t bias = side == OrderSide::BUY ? -options.width / 10 : options.width / 10;
+        int64_t offset;
+        if (options.distribution == "uniform") {
+            offset = std::uniform_int_distribution<int64_t>(-options.width, options.width)(rng);
+        } else {
+            offset = std::llround(std::normal_distribution<double>(0.0, options.width / 3.0)(rng));
+        }
+        return std::max<int64_t>(1, MID_TICKS + bias + offset) * instrument.tickSize;
+    }
+
+    OrderSide randomSide() {
+        return std::uniform_int_distribution<int>(0, 1)(rng) ? OrderSide::BUY : OrderSide::SELL;
+    }
+
+    // 撤单时把订单移出候选，改单后订单仍可再被撤
+    unsigned int pickLiveOrder(bool remove) {
+        size_t index = std::uniform_int_distribution<size_t>(0, liveOrders.size() - 1)(rng);
+        unsigned int orderId = liveOrders[index];
+        if (remove) {
+            liveOrders[index] = liveOrders.back();
+            liveOrders.pop_back();
+        }
+        return orderId;
+    }
+
+    static constexpr int64_t MID_TICKS = 5000000;
+
+    const BenchOptions& options;
+    const Instrument& instrument;
+    std::mt19937_64 rng;
+    unsigned int lastOrderId = 0;
+    std::vector<unsigned int> liveOrders;
+    unsigned long long lastMassUserId = 0;
+    std::vector<MassInstruction> pendingInstructions;
+};
+
+InputStream loadJournal(const std::string& path) {
+    // 只读读取，指向正在使用的日志目录也不会创建或改动段文件
+    InputStream inputs;
+    Journal::read(path, 0, [&inputs](uint64_t, const void* data, size_t size) {
+        inputs.emplace_back(static_cast<const char*>(data), size);
+    });
+    return inputs;
+}
+
+struct RunStats {
+    size_t accepted = 0;
+    size_t results = 0;
+    std::map<WireMessageType, size_t> resultsByType;
+};
+
+}
+
+int main(int argc, char* argv[]) {
+    BenchOptions options = parseOptions(argc, argv);
+    Logger::getInstance().init("bench.log", LogLevel::WARN);
+
+    std::vector<Instrument> instruments{defaultInstrument()};
+    EngineConfig engineConfig;
+    engineConfig.orderPoolSize = OrderBook::DEFAULT_ORDER_CAPACITY;
+    engineConfig.priceWindowLevels = OrderBook::DEFAULT_WINDOW_LEVELS;
+    engineConfig.wireFormat = WireFormat::BINARY;
+    if (!options.config.empty()) {
+        instruments = readInstruments(options.config);
+        engineConfig = readEngineConfig(options.config);
+    }
+    engineConfig.journalDir = options.journalDir;
+    engineConfig.orderPoolSize = std::max(engineConfig.orderPoolSize, options.orders + 2 * options.depth);
+
+    // 输入在计时前全部编码好
+    InputStream prefill;
+    InputStream inputs;
+    if (!options.journal.empty()) {
+        inputs = loadJournal(options.journal);
+    } else {
+        SyntheticStream stream(options, instruments.front());
+        stream.prefill(prefill);
+        stream.generate(inputs, options.orders);
+    }
+
+    // 套接字只为满足构造函数，进程内驱动不会收发消息
+    zmq::context_t context(1);
+    zmq::socket_t orderSocket(context, zmq::socket_type::pull);
+    zmq::socket_t resultSocket(context, zmq::socket_type::push);
+    zmq::socket_t bookSocket(context, zmq::socket_type::pub);
+    MatchingEngine engine(orderSocket, resultSocket, bookSocket, instruments, engineConfig);
+
+    RunStats stats;
+    auto collect = [&stats](const ResultEvent& event) {
+        ++stats.resultsByType[readWireHeader(event.data, event.size)];
+    };
+    for (const std::string& input : prefill) {
+        engine.submit(input.data(), input.size());
+        engine.discardOutput();
+    }
+    engine.endBatch();
+    engine.discardOutput();
+
+    // 延迟按消息统计，预热的指令数换算成消息数；预热覆盖全部输入时不预热，全部计入统计
+    size_t warmup = options.warmup;
+    if (options.mass > 1 && options.journal.empty()) {
+        warmup = (warmup + options.mass - 1) / options.mass;
+    }
+    if (warmup >= inputs.size()) {
+        warmup = 0;
+    }
+
+    Histogram latency;
+    Histogram batchLatency;
+    uint64_t warmupAllocations = engine.allocationCount();
+    double busyNanos = 0;
+    for (size_t i = 0; i < inputs.size(); ++i) {
+        if (i == warmup) {
+            warmupAllocations = engine.allocationCount();
+        }
+        auto start = std::chrono::steady_clock::now();
+        bool accepted = engine.submit(inputs[i].data(), inputs[i].size());
+        auto end = std::chrono::steady_clock::now();
+        uint64_t nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+        busyNanos += nanos;
+        if (i >= warmup) {
+            latency.record(nanos);
+        }
+        stats.accepted += accepted;
+
+        // 结果不编码不发送，只在计时区间外取走，防止环形队列写满
+        if ((i + 1) % options.batch == 0 || i + 1 == inputs.size()) {
+            start = std::chrono::steady_clock::now();
+            engine.endBatch();
+            end = std::chrono::steady_clock::now();
+            nanos = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            busyNanos += nanos;
+            if (i >= warmup) {
+                batchLatency.record(nanos);
+            }
+        }
+        stats.results += engine.discardOutput(collect);
+    }
+
+    std::printf("inputs: %zu (accepted %zu), prefill: %zu, batch: %zu, warmup: %zu inputs\n",
+                inputs.size(), stats.accepted, prefill.size(), options.batch, warmup);
+    std::printf("matcher busy: %.1f ms, throughput: %.0f inputs/s",
+                busyNanos / 1e6, busyNanos > 0 ? inputs.size() / (busyNanos / 1e9) : 0.0);
+    if (options.mass > 1 && options.journal.empty()) {
+        std::printf(", %.0f instructions/s", busyNanos > 0 ? options.orders / (busyNanos / 1e9) : 0.0);
+    }
+    std::printf("\n");
+    std::printf("%-10s %10s %10s %10s %10s %10s %12s %10s\n", "latency ns", "p50", "p90", "p99", "p99.9", "p99.99", "max", "mean");
+    printLatencyRow("input", latency.snapshot());
+    printLatencyRow("endBatch", batchLatency.snapshot());
+
+    // 同一输入和种子下以下计数应完全相同，可用来比对撮合结果是否回归
+    std::printf("results: %zu", stats.results);
+    for (const auto& entry : stats.resultsByType) {
+        std::printf(", %s %zu", wireMessageTypeToString(entry.first).c_str(), entry.second);
+    }
+    std::printf("\nresting orders: %zu, book allocations after warmup: %llu\n", engine.restingOrderCount(),
+                static_cast<unsigned long long>(engine.allocationCount() - warmupAllocations));
+    return 0;
+}
@@ -0,0 +1,199 @@
+// 订单簿微基准：对比原先的 std::map<Price, std::map<unsigned int, Order>> 布局与 OrderBook 价格阶梯
+// 用法: OrderBookBenchmark [订单数] [价格档位半宽]
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <initializer_list>
+#include <map>
+#include <random>
+#include <utility>
+#include <vector>
+#include "OrderBook.h"
+
+namespace {
+
+constexpr Price TICK_SIZE = PRICE_SCALE / 100;
+
+using MapBook = std::map<Price, std::map<unsigned int, Order>>;
+
+struct MatchStats {
+    unsigned long long trades = 0;
+    Quantity filledQuantity = 0;
+    uint64_t checksum = 0;      // 按成交顺序累积价格、数量和双方订单号，顺序不同结果即不同
+
+    void record(Price price, Quantity quantity, unsigned int makerId, unsigned int takerId) {
+        ++trades;
+        filledQuantity += quantity;
+        for (uint64_t field : {static_cast<uint64_t>(price), static_cast<uint64_t>(quantity), uint64_t{makerId}, uint64_t{takerId}}) {
+            checksum = (checksum ^ field) * 0x100000001B3ULL;
+        }
+    }
+};
+
+// 原撮合逻辑：两层红黑树
+void matchWithMaps(Order& order, MapBook& buyOrders, MapBook& sellOrders, MatchStats& stats) {
+    if (order.orderSide == OrderSide::BUY) {
+        for (auto it = sellOrders.begin(); it != sellOrders.end() && order.quantity > order.filledQuantity; ) {
+            if (order.price < it->first) {
+                break;
+            }
+            auto& ordersAtPrice = it->second;
+            for (auto orderIt = ordersAtPrice.begin(); orderIt != ordersAtPrice.end() && order.quantity > order.filledQuantity; ) {
+                Order& resting = orderIt->second;
+                Quantity qty = std::min(order.quantity - order.filledQuantity, resting.quantity - resting.filledQuantity);
+                order.filledQuantity += qty;
+                resting.filledQuantity += qty;
+                stats.record(resting.price, qty, resting.orderId, order.orderId);
+                orderIt = resting.filledQuantity >= resting.quantity ? ordersAtPrice.erase(orderIt) : std::next(orderIt);
+            }
+            it = ordersAtPrice.empty() ? sellOrders.erase(it) : std::next(it);
+        }
+        if (order.quantity > order.filledQuantity) {
+            buyOrders[order.price][order.orderId] = order;
+        }
+    } else {
+        for (auto it = buyOrders.rbegin(); it != buyOrders.rend() && order.quantity > order.filledQuantity; ) {
+            if (order.price > it->first) {
+                break;
+            }
+            auto& ordersAtPrice = it->second;
+            for (auto orderIt = ordersAtPrice.begin(); orderIt != ordersAtPrice.end() && order.quantity > order.filledQuantity; ) {
+                Order& resting = orderIt->second;
+                Quantity qty = std::min(order.quantity - order.filledQuantity, resting.quantity - resting.filledQuantity);
+                order.filledQuantity += qty;
+                resting.filledQuantity += qty;
+                stats.record(resting.price, qty, resting.orderId, order.orderId);
+                orderIt = resting.filledQuantity >= resting.quantity ? ordersAtPrice.erase(orderIt) : std::next(orderIt);
+            }
+            if (ordersAtPrice.empty()) {
+                it = MapBook::reverse_iterator(buyOrders.erase(std::next(it).base()));
+            } else {
+                ++it;
+            }
+        }
+        if (order.quantity > order.filledQuantity) {
+            sellOrders[order.price][order.orderId] = order;
+        }
+    }
+}
+
+// 新撮合逻辑：价格阶梯 + 侵入式 FIFO
+void matchWithLadder(Order& order, OrderBook& book, MatchStats& stats) {
+    bool isBuy = order.orderSide == OrderSide::BUY;
+    OrderSide opposite = isBuy ? OrderSide::SELL : OrderSide::BUY;
+    while (order.quantity > order.filledQuantity) {
+        PriceLevel* level = book.bestLevel(opposite);
+        if (level == nullptr) {
+            break;
+        }
+        Price levelPrice = book.getOrder(level->head).price;
+        if (isBuy ? order.price < levelPrice : order.price > levelPrice) {
+            break;
+        }
+        while (!level->empty() && order.quantity > order.filledQuantity) {
+            OrderHandle handle = level->head;
+            Order& resting = book.getOrder(handle);
+            Quantity qty = std::min(order.quantity - order.filledQuantity, resting.quantity - resting.filledQuantity);
+            order.filledQuantity += qty;
+            book.fillOrder(handle, qty);
+            stats.record(resting.price, qty, resting.orderId, order.orderId);
+            if (resting.filledQuantity >= resting.quantity) {
+                book.removeOrder(handle);
+            }
+        }
+    }
+    if (order.quantity > order.filledQuantity) {
+        book.addOrder(std::move(order));
+    }
+}
+
+std::vector<Order> makeOrders(size_t count, int halfWidth) {
+    std::mt19937_64 rng(42);
+    std::normal_distribution<double> offset(0.0, halfWidth / 3.0);
+    std::uniform_int_distribution<int> side(0, 1);
+    std::uniform_int_distribution<int> lots(1, 100);
+
+    std::vector<Order> orders;
+    orders.reserve(count);
+    auto now = std::chrono::system_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        Order order{};
+        order.orderId = static_cast<unsigned int>(i + 1);
+        order.userId = i + 1;
+        order.orderSide = side(rng) ? OrderSide::BUY : OrderSide::SELL;
+        // 买单偏低、卖单偏高，使订单簿保持一定深度
+        int bias = order.orderSide == OrderSide::BUY ? -halfWidth / 10 : halfWidth / 10;
+        long ticks = 5000000 + bias + std::lround(offset(rng));
+        order.price = ticks * TICK_SIZE;
+        order.quantity = lots(rng) * (QUANTITY_SCALE / 10);
+        order.filledQuantity = 0;
+        order.orderType = OrderType::LIMIT;
+        order.status = OrderStatus::INITIAL;
+        order.createTime = now;
+        order.updateTime = now;
+        orders.push_back(order);
+    }
+    return orders;
+}
+
+template <typename Fn>
+double runTimed(Fn&& fn) {
+    auto start = std::chrono::steady_clock::now();
+    fn();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    int halfWidth = argc > 2 ? std::atoi(argv[2]) : 2000;
+    std::vector<Order> orders = makeOrders(count, halfWidth);
+
+    MatchStats mapStats;
+    MapBook buyOrders;
+    MapBook sellOrders;
+    std::vector<Order> mapInput = orders;
+    double mapNs = runTimed([&]() {
+        for (Order& order : mapInput) {
+            matchWithMaps(order, buyOrders, sellOrders, mapStats);
+        }
+    });
+    size_t mapResting = 0;
+    for (const auto& level : buyOrders) mapResting += level.second.size();
+    for (const auto& level : sellOrders) mapResting += level.second.size();
+
+    MatchStats ladderStats;
+    OrderBook book(TICK_SIZE, count);
+    std::vector<Order> ladderInput = orders;
+    uint64_t warmupAllocations = 0;
+    double ladderNs = runTimed([&]() {
+        for (size_t i = 0; i < ladderInput.size(); ++i) {
+            // 前 10% 订单视为预热（价格阶梯按需扩展），之后统计稳态分配次数
+            if (i == ladderInput.size() / 10) {
+                warmupAllocations = book.allocationCount();
+            }
+            matchWithLadder(ladderInput[i], book, ladderStats);
+        }
+    });
+
+    std::printf("orders: %zu, price half width: %d ticks\n", count, halfWidth);
+    std::printf("%-12s %12s %12s %14s %10s\n", "layout", "total ms", "ns/order", "trades", "resting");
+    std::printf("%-12s %12.1f %12.1f %14llu %10zu\n", "std::map", mapNs / 1e6, mapNs / count, mapStats.trades, mapResting);
+    std::printf("%-12s %12.1f %12.1f %14llu %10zu\n", "ladder", ladderNs / 1e6, ladderNs / count, ladderStats.trades, book.orderCount());
+    std::printf("speedup: %.2fx\n", mapNs / ladderNs);
+    std::printf("trade checksum: map %016llx, ladder %016llx\n",
+                static_cast<unsigned long long>(mapStats.checksum), static_cast<unsigned long long>(ladderStats.checksum));
+    std::printf("ladder book allocations: %llu total, %llu after warmup\n",
+                static_cast<unsigned long long>(book.allocationCount()),
+                static_cast<unsigned long long>(book.allocationCount() - warmupAllocations));
+
+    // 两种布局必须产生完全相同的成交序列（价格优先、时间优先），逐笔校验和一致
+    if (mapStats.trades != ladderStats.trades || mapStats.checksum != ladderStats.checksum || mapResting != book.orderCount()) {
+        std::fprintf(stderr, "mismatch between map and ladder results\n");
+        return 1;
+    }
+    return 0;
+}
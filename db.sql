@@ -4,12 +4,13 @@ CREATE TABLE `orders` (
                           `order_side` enum('BUY','SELL') NOT NULL,
                           `price` decimal(18,8) NOT NULL,
                           `quantity` decimal(10,6) NOT NULL,
-                          `fee_rate` decimal(5,4) NOT NULL,
+                          `fee_rate` decimal(8,6) NOT NULL,
                           `trading_pair` varchar(20) NOT NULL DEFAULT 'BTC_USDT',
-                          `status` enum('INITIAL','MATCHING','PARTIALLY_FILLED','FULLY_FILLED','CANCELING','CANCELED','EXCEPTION') NOT NULL,
+                          `status` enum('INITIAL','MATCHING','PARTIALLY_FILLED','FULLY_FILLED','CANCELING','CANCELED','PARTIALLY_FILLED_CANCELED','EXCEPTION') NOT NULL,
                           `order_type` enum('MARKET','LIMIT') NOT NULL,
-                          `create_time` timestamp NULL DEFAULT CURRENT_TIMESTAMP,
-                          `update_time` timestamp NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
+                          `time_in_force` enum('GTC','IOC','FOK','POST_ONLY') NOT NULL DEFAULT 'GTC',
+                          `create_time` timestamp(6) NULL DEFAULT CURRENT_TIMESTAMP(6),
+                          `update_time` timestamp(6) NULL DEFAULT CURRENT_TIMESTAMP(6) ON UPDATE CURRENT_TIMESTAMP(6),
                           `filled_quantity` decimal(10,6) NOT NULL DEFAULT '0.000000',
                           PRIMARY KEY (`order_id`),
                           KEY `idx_user_id` (`user_id`),
@@ -24,15 +25,34 @@ CREATE TABLE `orders` (
                           `order_side` enum('BUY','SELL') NOT NULL,
                           `price` decimal(18,8) NOT NULL,
                           `quantity` decimal(10,6) NOT NULL,
-                          `fee_rate` decimal(5,4) NOT NULL,
+                          `fee_rate` decimal(8,6) NOT NULL,
                           `trading_pair` varchar(20) NOT NULL DEFAULT 'BTC_USDT',
-                          `status` enum('INITIAL','MATCHING','PARTIALLY_FILLED','FULLY_FILLED','CANCELING','CANCELED','EXCEPTION') NOT NULL,
+                          `status` enum('INITIAL','MATCHING','PARTIALLY_FILLED','FULLY_FILLED','CANCELING','CANCELED','PARTIALLY_FILLED_CANCELED','EXCEPTION') NOT NULL,
                           `order_type` enum('MARKET','LIMIT') NOT NULL,
-                          `create_time` timestamp NULL DEFAULT CURRENT_TIMESTAMP,
-                          `update_time` timestamp NULL DEFAULT CURRENT_TIMESTAMP ON UPDATE CURRENT_TIMESTAMP,
+                          `time_in_force` enum('GTC','IOC','FOK','POST_ONLY') NOT NULL DEFAULT 'GTC',
+                          `create_time` timestamp(6) NULL DEFAULT CURRENT_TIMESTAMP(6),
+                          `update_time` timestamp(6) NULL DEFAULT CURRENT_TIMESTAMP(6) ON UPDATE CURRENT_TIMESTAMP(6),
                           `filled_quantity` decimal(10,6) NOT NULL DEFAULT '0.000000',
                           PRIMARY KEY (`order_id`),
                           KEY `idx_user_id` (`user_id`),
                           KEY `idx_status` (`status`),
                           KEY `idx_trading_pair` (`trading_pair`)
-) ENGINE=InnoDB AUTO_INCREMENT=10101 DEFAULT CHARSET=utf8mb3
\ No newline at end of file
+) ENGINE=InnoDB AUTO_INCREMENT=10101 DEFAULT CHARSET=utf8mb3;
+
+
+CREATE TABLE `trade_records` (
+                          `trade_id` bigint unsigned NOT NULL,
+                          `buyer_user_id` bigint NOT NULL,
+                          `seller_user_id` bigint NOT NULL,
+                          `buyer_order_id` bigint NOT NULL,
+                          `seller_order_id` bigint NOT NULL,
+                          `order_type` enum('BUY','SELL') NOT NULL,
+                          `trade_price` decimal(18,8) NOT NULL,
+                          `trade_quantity` decimal(10,6) NOT NULL,
+                          `buyer_fee` decimal(18,8) NOT NULL,
+                          `seller_fee` decimal(18,8) NOT NULL,
+                          `trade_time` timestamp NULL DEFAULT CURRENT_TIMESTAMP,
+                          PRIMARY KEY (`trade_id`),
+                          KEY `idx_buyer_order_id` (`buyer_order_id`),
+                          KEY `idx_seller_order_id` (`seller_order_id`)
+) ENGINE=InnoDB DEFAULT CHARSET=utf8mb3;
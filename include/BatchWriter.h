@@ -0,0 +1,87 @@
+#pragma once
+
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DbConnection.h"
+#include "Order.h"
+#include "TradeRecord.h"
+
+// 批量写库：同一批内同一订单的多次状态变化只保留最后一次，
+// 订单用多行 INSERT ... ON DUPLICATE KEY UPDATE 写入，成交用多行 INSERT 写入，整批一个事务
+class BatchWriter {
+public:
+    // 单条语句的最大行数，批次按 2 的幂拆分，预编译语句最多缓存 log2(MAX) 种
+    static constexpr size_t MAX_ROWS_PER_STATEMENT = 1024;
+
+    explicit BatchWriter(DbConnection& dbConn);
+    ~BatchWriter();
+
+    BatchWriter(const BatchWriter&) = delete;
+    BatchWriter& operator=(const BatchWriter&) = delete;
+
+    void addOrder(const Order& order);
+    void addTrade(const TradeRecord& trade);
+
+    bool empty() const { return orders.empty() && trades.empty(); }
+    size_t orderCount() const { return orders.size(); }
+    size_t tradeCount() const { return trades.size(); }
+
+    // 被拒绝的一行：order 与 trade 恰有一个非空，error 为 MySQL 错误码
+    using RejectHandler = std::function<void(const Order* order, const TradeRecord* trade, unsigned int error, const std::string& message)>;
+
+    // 提交当前批次并清空；失败时回滚并返回 false，批次数据保留，lastError() 给出失败原因
+    bool flush();
+    // 整批因数据错误被拒绝后逐行提交：能写入的行照常写入，被拒绝的行交给 onRejected 后丢弃；
+    // 遇到临时错误时停止并返回 false，尚未写入的行留在批次中，由调用方重连后再次 flush()
+    bool flushRows(const RejectHandler& onRejected);
+
+    unsigned int lastError() const { return errorCode; }
+    const std::string& lastErrorMessage() const { return errorMessage; }
+    // 断线、死锁、锁等待超时：重试可能成功；其余错误（如数值越界）重试多少次结果都一样
+    static bool isTransientError(unsigned int error);
+
+private:
+    // 一次 execute 的参数缓冲区：先写入全部值再统一绑定，保证指针稳定
+    class Params {
+    public:
+        void reset(size_t count);
+        void addInt(unsigned long long value);
+        void addText(std::string value);
+        std::vector<MYSQL_BIND>& bind();
+
+    private:
+        std::vector<unsigned long long> ints;
+        std::vector<std::string> texts;
+        std::vector<unsigned long> lengths;
+        std::vector<bool> isText;
+        std::vector<MYSQL_BIND> binds;
+    };
+
+    // 在一个事务里执行 write，失败时回滚并记下错误
+    bool commit(const std::function<bool()>& write);
+    // 写入 [begin, end) 范围内的订单 / 成交
+    bool writeOrders(size_t begin, size_t end);
+    bool writeTrades(size_t begin, size_t end);
+    MYSQL_STMT* orderStatement(size_t rows);
+    MYSQL_STMT* tradeStatement(size_t rows);
+    MYSQL_STMT* prepare(const std::string& sql);
+    bool execute(MYSQL_STMT* stmt);
+    bool query(const char* sql);
+    void setError(unsigned int error, const std::string& message);
+    void closeStatements();
+
+    DbConnection& dbConn;
+
+    std::vector<Order> orders;
+    std::unordered_map<unsigned int, size_t> orderSlots;   // orderId -> orders 下标
+    std::vector<TradeRecord> trades;
+
+    std::map<size_t, MYSQL_STMT*> orderStatements;   // 行数 -> 预编译语句
+    std::map<size_t, MYSQL_STMT*> tradeStatements;
+    Params params;
+    unsigned int errorCode = 0;     // 最近一次提交失败的 MySQL 错误码，0 表示非 MySQL 错误
+    std::string errorMessage;
+};
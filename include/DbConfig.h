@@ -1,5 +1,6 @@
 #pragma once
 
+#include <cstddef>
 #include <string>
 
 struct DbConfig {
@@ -10,4 +11,15 @@ struct DbConfig {
     std::string database;
 };
 
+// 持久化批量提交与分区参数
+struct PersistenceConfig {
+    size_t batchSize;           // 每批最多合并的结果消息数
+    int flushIntervalMs;        // 一批从首条消息起最长等待的毫秒数
+    size_t workerCount;         // 按订单号分区的写库线程数，每个线程独占一个连接
+    std::string deadLetterDir;  // 被数据库拒绝（非临时错误）的行写到这里，每个分区一个文件
+};
+
 DbConfig readConfig(const std::string& configFile);
+
+// 从配置文件的 "persistence" 节读取持久化参数，缺省项使用默认值
+PersistenceConfig readPersistenceConfig(const std::string& configFile);
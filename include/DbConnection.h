@@ -1,22 +1,63 @@
 #pragma once
 
 #include <mysql.h>
+#include <cstdint>
+#include <functional>
 #include <string>
-#include <vector>
-#include <map>
+#include <string_view>
 #include "DbConfig.h"
+#include "FixedPoint.h"
+#include "Timestamp.h"
 #include "Logger.h"
 
+// 结果集中的一行，按 SELECT 中的列序号访问，直接解析 libmysqlclient 的行缓冲，不复制也不分配
+// 只在 queryRows 的回调内有效；数值列格式不合法或为 NULL 时抛出 std::invalid_argument
+class DbRow {
+public:
+    DbRow(MYSQL_ROW row, const unsigned long* lengths, unsigned int columnCount)
+            : row(row), lengths(lengths), columns(columnCount) {}
+
+    unsigned int columnCount() const { return columns; }
+    bool isNull(unsigned int column) const { return row[column] == nullptr; }
+    std::string_view asText(unsigned int column) const;     // NULL 返回空串
+    int64_t asInt64(unsigned int column) const;
+    uint64_t asUInt64(unsigned int column) const;
+    int64_t asFixed(unsigned int column, int decimals) const;
+    Timestamp asTimestamp(unsigned int column) const;
+
+private:
+    const char* notNull(unsigned int column) const;
+
+    MYSQL_ROW row;
+    const unsigned long* lengths;
+    unsigned int columns;
+};
+
 class DbConnection {
 public:
     DbConnection(const DbConfig& config);
     ~DbConnection();
 
+    DbConnection(const DbConnection&) = delete;
+    DbConnection& operator=(const DbConnection&) = delete;
+
+    // 连接不可用（建立或重连失败）时返回 nullptr
     MYSQL* getConnection() { return conn; }
     bool executeQuery(const std::string& query);
-    std::vector<std::map<std::string, std::string>> executeQueryWithResult(const std::string& query);
+    // 流式读取查询结果（mysql_use_result），逐行回调，不把整个结果集读入内存；
+    // 回调期间连接被结果集占用，不能在回调里再执行其它语句。查询或读取失败时返回 false
+    bool queryRows(const std::string& query, const std::function<void(const DbRow&)>& onRow);
+    std::string escape(const std::string& value);
+    // 关闭旧连接后按原配置重新建立；失败时抛出 std::runtime_error，连接保持不可用
     void reconnect();
+    // 关闭连接之前调用，用于先关闭依附于该连接的预编译语句；传入空函数即取消
+    void setCloseHandler(std::function<void()> handler) { closeHandler = std::move(handler); }
 
 private:
+    MYSQL* connect();
+    void close();
+
+    DbConfig config;
     MYSQL* conn;
+    std::function<void()> closeHandler;
 };
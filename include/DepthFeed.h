@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include "OrderBook.h"
+#include "WireProtocol.h"
+
+class DepthBook;
+
+// 发布端：记录每个交易对上次发布的前 N 档，按需生成快照或只含变化价位的增量
+// 只读取各价位的聚合数量，单次发布为 O(N)，与订单簿中的挂单总数无关
+class DepthPublisher {
+public:
+    explicit DepthPublisher(size_t depth);
+
+    // 当前前 N 档的全量快照，同时作为之后增量的比较基准
+    DepthUpdate snapshot(const OrderBook& orderBook);
+    // 与上次发布相比变化的价位；没有变化时返回 false，不消耗序号
+    bool delta(const OrderBook& orderBook, DepthUpdate& update);
+    // 网关按客户端订阅的档数从完整的 DepthBook 裁剪出前 N 档，单独编号、单独求增量
+    DepthUpdate snapshot(const DepthBook& depthBook);
+    bool delta(const DepthBook& depthBook, DepthUpdate& update);
+
+    // 上次发布的状态，不改变序号和比较基准，供新订阅者初始化
+    DepthUpdate published() const;
+    size_t levels() const { return depth; }
+
+private:
+    template <typename Book>
+    DepthUpdate snapshotOf(const Book& book);
+    template <typename Book>
+    bool deltaOf(const Book& book, DepthUpdate& update);
+    void collect(const OrderBook& orderBook, OrderSide side, std::vector<DepthLevel>& levels) const;
+    void collect(const DepthBook& depthBook, OrderSide side, std::vector<DepthLevel>& levels) const;
+
+    size_t depth;
+    uint64_t sequence;
+    std::vector<DepthLevel> publishedBids;
+    std::vector<DepthLevel> publishedAsks;
+    std::vector<DepthLevel> currentBids;
+    std::vector<DepthLevel> currentAsks;
+};
+
+// 订阅端：用快照和连续的增量维护前 N 档，序号断档时丢弃状态等待下一次快照
+class DepthBook {
+public:
+    // 返回 false 表示增量被丢弃（尚未收到快照或序号不连续）
+    bool apply(const DepthUpdate& update);
+    bool synced() const { return isSynced; }
+    uint64_t sequence() const { return lastSequence; }
+
+    // 当前状态的全量快照，供新订阅者初始化
+    DepthUpdate snapshot() const;
+    // 买价从高到低、卖价从低到高，供 formatBookTable 展示
+    std::vector<BookEntry> entries() const;
+    // 从最优价起依次访问一边的前 count 档
+    template <typename Fn>
+    void forEachBestLevel(OrderSide side, size_t count, Fn&& fn) const {
+        if (side == OrderSide::BUY) {
+            visitBest(bids, count, fn);
+        } else {
+            visitBest(asks, count, fn);
+        }
+    }
+
+private:
+    template <typename Map, typename Fn>
+    static void visitBest(const Map& levels, size_t count, Fn& fn) {
+        for (auto it = levels.begin(); it != levels.end() && count > 0; ++it, --count) {
+            fn(it->first, it->second);
+        }
+    }
+
+    std::map<Price, Quantity, std::greater<Price>> bids;
+    std::map<Price, Quantity> asks;
+    uint64_t lastSequence = 0;
+    bool isSynced = false;
+};
+
+// 解析二进制或 JSON 格式的订单簿行情消息
+DepthUpdate parseDepthMessage(const void* data, size_t size);
+
+// JSON 调试格式：{"type", "symbol", "sequence", "bids": [[price, quantity]...], "asks": [...]}
+std::string serializeDepthUpdate(const std::string& symbol, const DepthUpdate& update);
@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include "WireProtocol.h"
+
+constexpr size_t DEFAULT_ORDER_BATCH_SIZE = 256;
+constexpr int64_t DEFAULT_MAX_BATCH_DELAY_MICROS = 100;
+constexpr uint64_t DEFAULT_SNAPSHOT_INTERVAL = 100000;
+constexpr size_t DEFAULT_DEPTH_LEVELS = 20;
+constexpr int64_t DEFAULT_DEPTH_SNAPSHOT_INTERVAL_MS = 1000;
+constexpr size_t DEFAULT_PIPELINE_QUEUE_SIZE = 65536;
+
+// 防自成交：主动单遇到同一用户的挂单时不成交，按模式处理
+enum class SelfTradePrevention {
+    NONE,               // 不检查，同一用户的订单照常成交
+    CANCEL_NEWEST,      // 撤销主动单的剩余部分，挂单保留
+    CANCEL_OLDEST,      // 撤销挂单，主动单继续撮合
+    DECREMENT           // 双方各减去较小的剩余数量，减到 0 的一方撤销；主动单的下单数量不变，入簿时才扣除
+};
+
+SelfTradePrevention stringToSelfTradePrevention(const std::string& str);
+
+// 输入日志的刷盘策略
+enum class JournalSync {
+    NONE,       // 只写进页缓存，进程崩溃不丢，掉电可能丢失最近的输入
+    BATCH       // 每批撮合结束、发布结果之前刷盘，已发布的结果在掉电后都能由日志重建
+};
+
+JournalSync stringToJournalSync(const std::string& str);
+
+struct EngineConfig {
+    size_t orderPoolSize;       // 每个交易对的订单池预分配的挂单节点数
+    size_t priceWindowLevels;   // 单边价格窗口的价位数，窗口外的远端价位放进溢出区
+    WireFormat wireFormat;      // 消息编码：binary 为默认，json 用于调试
+    size_t orderBatchSize = DEFAULT_ORDER_BATCH_SIZE;       // 每次唤醒最多取出的订单数，1 表示逐条处理
+    int64_t maxBatchDelayMicros = DEFAULT_MAX_BATCH_DELAY_MICROS;  // 一批订单从首条到达起的最长收取时间
+    size_t shardCount = 0;      // 撮合分片数，0 表示每个交易对一个分片（不超过 CPU 数）
+    bool pinThreads = true;     // 是否把分片的撮合线程绑定到独立的 CPU 核心
+    bool pinPipelineStages = false;     // 是否把分片的解码、发布线程也各自绑定到独立的 CPU 核心
+    size_t pipelineQueueSize = DEFAULT_PIPELINE_QUEUE_SIZE;    // 分片内各阶段之间环形队列的槽位数
+    std::string journalDir;     // 输入日志和快照目录，每个交易对一组文件；为空时不记日志
+    JournalSync journalSync = JournalSync::BATCH;
+    // 启动时由各分片直接从数据库批量恢复挂单，与 journalDir 互斥；两者都不用时由订单生成器重新发送挂单
+    bool loadOpenOrdersFromDatabase = true;
+    // 回放日志时按当前模式重新撮合，修改模式前应先写快照（正常停机即会写）
+    SelfTradePrevention selfTradePrevention = SelfTradePrevention::NONE;
+    uint64_t snapshotInterval = DEFAULT_SNAPSHOT_INTERVAL;     // 每个交易对每记录多少条输入写一次快照
+    size_t depthLevels = DEFAULT_DEPTH_LEVELS;      // L2 行情每边发布的档数
+    int64_t depthSnapshotIntervalMs = DEFAULT_DEPTH_SNAPSHOT_INTERVAL_MS;  // 两次全量行情快照的间隔，其间只发增量
+};
+
+// 从配置文件的 "engine" 节读取撮合引擎参数，缺省项使用默认值
+EngineConfig readEngineConfig(const std::string& configFile);
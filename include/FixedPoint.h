@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 定点数表示：价格、数量、费率、金额都用按固定小数位放大的 int64 存储
+// 小数位与数据库字段精度保持一致：price decimal(18,8)，quantity decimal(10,6)，fee_rate decimal(8,6)
+using Price = int64_t;
+using Quantity = int64_t;
+using FeeRate = int64_t;
+using Amount = int64_t;
+
+constexpr int PRICE_DECIMALS = 8;
+constexpr int QUANTITY_DECIMALS = 6;
+constexpr int FEE_RATE_DECIMALS = 6;
+constexpr int AMOUNT_DECIMALS = 8;
+
+constexpr Price PRICE_SCALE = 100000000;
+constexpr Quantity QUANTITY_SCALE = 1000000;
+constexpr FeeRate FEE_RATE_SCALE = 1000000;
+
+// 定点数与十进制字符串互转，不经过浮点；解析时格式不合法抛出 std::invalid_argument，超出 int64_t 范围抛出 std::out_of_range
+std::string formatFixed(int64_t value, int decimals);
+int64_t parseFixed(const std::string& str, int decimals);
+int64_t parseFixed(const char* str, size_t length, int decimals);
+
+// 手续费 = 价格 * 数量 * 费率，结果为 AMOUNT_DECIMALS 位定点金额（四舍五入）
+Amount calculateFee(Price price, Quantity quantity, FeeRate feeRate);
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+constexpr size_t DEFAULT_GATEWAY_MAX_DEPTH = 20;
+constexpr size_t DEFAULT_GATEWAY_MAX_QUEUED_MESSAGES = 1024;
+constexpr size_t DEFAULT_GATEWAY_MAX_BUFFERED_BYTES = 1 << 20;
+constexpr int64_t DEFAULT_GATEWAY_RETRY_INTERVAL_MS = 10;
+
+// WebSocket 行情网关参数
+struct GatewayConfig {
+    size_t maxDepth = DEFAULT_GATEWAY_MAX_DEPTH;                    // 客户端可订阅的最大档数
+    size_t maxQueuedMessages = DEFAULT_GATEWAY_MAX_QUEUED_MESSAGES; // 每个连接待发送队列的上限，超出后按丢弃/合并策略处理
+    size_t maxBufferedBytes = DEFAULT_GATEWAY_MAX_BUFFERED_BYTES;   // 连接的发送缓冲超过该字节数时暂停向其写入
+    int64_t retryIntervalMs = DEFAULT_GATEWAY_RETRY_INTERVAL_MS;    // 有连接积压时重试发送的间隔
+};
+
+// 从配置文件的 "gateway" 节读取行情网关参数，缺省项使用默认值
+GatewayConfig readGatewayConfig(const std::string& configFile);
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <map>
 #include <string>
 #include <zmq.hpp>
 #include <thread>
@@ -7,6 +8,7 @@
 #include "httplib.h"
 #include "Order.h"
 #include "TradeRecord.h"
+#include "DepthFeed.h"
 #include "Logger.h"
 
 class HealthCheckServer {
@@ -18,6 +20,7 @@ public:
 
 private:
     void receiveOrderBook();
+    static std::string renderOrderBook(const std::string& symbol, const DepthBook& book);
 
     httplib::Server svr_;
     std::string host_;
@@ -26,6 +29,6 @@ private:
     bool running_;
 
     std::thread receiveThread_;
-    std::string latestOrderBook_;
-    std::mutex orderBookMutex_; // 保护 latestOrderBook_ 的互斥锁
+    std::map<std::string, DepthBook> orderBooks_; // 各交易对由快照和增量维护的前 N 档，请求时再渲染
+    std::mutex orderBookMutex_; // 保护 orderBooks_ 的互斥锁
 };
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "FixedPoint.h"
+#include "Order.h"
+
+// 交易对名称的最大长度，二进制协议中按定长字段存放
+constexpr size_t MAX_SYMBOL_LENGTH = 15;
+
+// 成交号 = 交易对编号（高 12 位）| 该交易对内的成交序号（低 52 位）
+// 各分片独立递增即可全局唯一，不需要跨分片的计数器，也不依赖数据库自增
+constexpr unsigned TRADE_SEQUENCE_BITS = 52;
+constexpr uint32_t MAX_INSTRUMENT_ID = (1u << (64 - TRADE_SEQUENCE_BITS)) - 1;
+constexpr uint64_t TRADE_SEQUENCE_MASK = (uint64_t(1) << TRADE_SEQUENCE_BITS) - 1;
+
+inline uint64_t makeTradeId(uint32_t instrumentId, uint64_t sequence) {
+    return (static_cast<uint64_t>(instrumentId) << TRADE_SEQUENCE_BITS) | (sequence & TRADE_SEQUENCE_MASK);
+}
+
+// 交易对参数：tickSize / lotSize 均为定点单位（例如 0.01 的 tickSize 存为 1000000）
+// instrumentId 取值 1..MAX_INSTRUMENT_ID，各交易对互不相同，一经使用不可更改
+struct Instrument {
+    std::string symbol;
+    Price tickSize;
+    Quantity lotSize;
+    uint32_t instrumentId = 1;
+
+    bool isValidPrice(Price price) const { return price > 0 && price % tickSize == 0; }
+    bool isValidQuantity(Quantity quantity) const { return quantity > 0 && quantity % lotSize == 0; }
+};
+
+// 未配置时使用的默认交易对：BTC_USDT，tick 0.01，lot 0.000001
+Instrument defaultInstrument();
+
+// 从配置文件的 "instruments" 数组读取交易对，缺省时返回默认交易对
+std::vector<Instrument> readInstruments(const std::string& configFile);
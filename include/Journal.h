@@ -0,0 +1,71 @@
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <string>
+
+// 撮合输入的预写日志：内存映射的追加文件，每条记录带递增序号
+// 日志分段存放，段文件为 <path>.<段号>；写快照时切换到新段，快照落盘后删除此前的段
+// 记录格式：[uint32 长度][uint32 保留][uint64 序号][负载，补齐到 8 字节]
+// 长度最后写入，进程崩溃时写了一半的记录长度仍为 0，回放到此为止
+// 追加只写进页缓存，sync() 之后记录才能在掉电后保留
+class Journal {
+public:
+    static constexpr size_t GROW_BYTES = 64 * 1024 * 1024;   // 段文件每次扩展的字节数
+
+    // 打开（不存在则创建）日志，扫描已有的段定位追加位置和下一个序号
+    explicit Journal(const std::string& path);
+    ~Journal();
+
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+
+    // 追加一条记录，返回分配的序号
+    uint64_t append(const void* data, uint32_t size);
+
+    // 按顺序回放所有段中序号大于 afterSequence 的记录
+    void replay(uint64_t afterSequence, const std::function<void(uint64_t, const void*, size_t)>& handler) const;
+
+    // 把上次 sync 之后追加的记录刷到磁盘
+    void sync();
+
+    // 切换到下一个段并返回其段号；旧段中未 sync 的记录只留在页缓存，由随后的快照覆盖
+    uint64_t rotate();
+
+    // 保证后续序号大于 sequence（旧段在快照后被删除时由快照序号接续）
+    void resumeAfter(uint64_t sequence);
+
+    uint64_t lastSequence() const { return nextSequence - 1; }
+    const std::string& basePath() const { return path; }
+
+    // 以下只操作文件，不访问 Journal 对象
+    // 只读打开各段，按顺序处理序号大于 afterSequence 的记录；不创建、不修改任何文件，可用于正在写入的日志
+    static void read(const std::string& path, uint64_t afterSequence, const std::function<void(uint64_t, const void*, size_t)>& handler);
+    // 以下两个由写快照线程调用
+    // 删除段号小于 segment 的段
+    static void removeSegmentsBefore(const std::string& path, uint64_t segment);
+    // 预先创建并扩展段文件、刷目录，切换到该段时撮合线程不必再刷目录
+    static void prepareSegment(const std::string& path, uint64_t segment);
+
+private:
+    void openSegment(uint64_t index);
+    void closeSegment();
+    void map(size_t size);
+    void unmap();
+
+    std::string path;
+    uint64_t firstSegment;      // 打开时最早的段，回放从这里开始
+    uint64_t segment;           // 正在追加的段
+    int fd;
+    char* base;
+    size_t mappedSize;
+    size_t writeOffset;
+    size_t syncedOffset;        // 此前的记录已刷到磁盘
+    bool resized;               // 文件长度变化后还需刷一次元数据
+    bool created;               // 段文件是新建的，还需刷一次目录
+    uint64_t nextSequence;
+};
+
+// 把目录项的变化（新建、改名、删除）刷到磁盘，path 为目录中的文件
+void syncParentDirectory(const std::string& path);
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+#include "FixedPoint.h"
+#include "WireProtocol.h"
+
+// 一根 K 线（OHLCV），openTime 为所在周期起点的毫秒时间戳
+struct KlineBar {
+    int64_t openTime;
+    Price open;
+    Price high;
+    Price low;
+    Price close;
+    Quantity volume;
+    uint32_t tradeCount;
+};
+
+// 单个周期的 K 线序列：固定容量的环形缓冲，随成交增量更新，只保留最近 capacity 根
+class KlineSeries {
+public:
+    KlineSeries(const std::string& name, int64_t intervalMillis, size_t capacity);
+
+    // 计入一笔成交，返回被更新的 K 线；早于缓冲区范围或落在空缺周期里的迟到成交返回 nullptr
+    const KlineBar* add(int64_t timeMillis, Price price, Quantity quantity);
+
+    const std::string& name() const { return intervalName; }
+    int64_t intervalMillis() const { return interval; }
+    size_t size() const { return count; }
+    // i = 0 为最早的一根
+    const KlineBar& at(size_t i) const { return bars[(head + bars.size() - count + 1 + i) % bars.size()]; }
+    const KlineBar* latest() const { return count == 0 ? nullptr : &bars[head]; }
+
+private:
+    std::string intervalName;
+    int64_t interval;
+    std::vector<KlineBar> bars;
+    size_t head;        // 最新一根的下标
+    size_t count;
+};
+
+// 按交易对维护 1s / 1m / 5m / 1h 四个周期的 K 线
+class KlineAggregator {
+public:
+    static constexpr size_t HISTORY_BARS = 1440;
+
+    // 计入一批成交，返回该交易对各周期的序列
+    const std::vector<KlineSeries>& addTrades(const std::string& symbol, const std::vector<TradePrint>& trades);
+
+    const std::map<std::string, std::vector<KlineSeries>>& allSeries() const { return series; }
+    // 某个交易对某个周期的序列，尚无成交时返回 nullptr
+    const KlineSeries* find(const std::string& symbol, const std::string& intervalName) const;
+
+private:
+    std::vector<KlineSeries>& seriesFor(const std::string& symbol);
+
+    std::map<std::string, std::vector<KlineSeries>> series;
+};
+
+// 是否为支持的周期名（"1s"、"1m"、"5m"、"1h"）
+bool isKlineInterval(const std::string& intervalName);
+
+// JSON 推送格式：{"type": "KLINE", "symbol", "interval", "openTime", "open", "high", "low", "close", "volume", "trades"}
+std::string serializeKline(const std::string& symbol, const KlineSeries& series, const KlineBar& bar);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+#include "DbConnectionPool.h"
+#include "Instrument.h"
+#include "Metrics.h"
+#include "Order.h"
+#include "WireProtocol.h"
+
+enum class ArrivalProcess {
+    CONSTANT,   // 等间隔发送
+    POISSON     // 间隔服从指数分布
+};
+
+ArrivalProcess stringToArrivalProcess(const std::string& str);
+
+constexpr double DEFAULT_LOAD_RATE_PER_SECOND = 10000;
+constexpr size_t DEFAULT_LOAD_PRODUCER_THREADS = 2;
+constexpr int64_t DEFAULT_LOAD_DURATION_SECONDS = 60;
+constexpr double DEFAULT_LOAD_CANCEL_RATIO = 0.1;
+constexpr double DEFAULT_LOAD_MARKET_RATIO = 0.05;
+constexpr int64_t DEFAULT_LOAD_PRICE_SPREAD_TICKS = 50;
+constexpr int64_t DEFAULT_LOAD_MID_VOLATILITY_TICKS = 1;
+constexpr uint64_t DEFAULT_LOAD_USER_COUNT = 1000;
+constexpr uint32_t DEFAULT_LOAD_FIRST_ORDER_ID = 1000000000;
+const std::string DEFAULT_LOAD_MID_PRICE = "1000";
+
+// 压测负载参数
+struct LoadConfig {
+    double ratePerSecond = DEFAULT_LOAD_RATE_PER_SECOND;     // 所有发送线程合计的目标速率
+    ArrivalProcess arrival = ArrivalProcess::POISSON;
+    size_t producerThreads = DEFAULT_LOAD_PRODUCER_THREADS;
+    int64_t durationSeconds = DEFAULT_LOAD_DURATION_SECONDS;
+    double cancelRatio = DEFAULT_LOAD_CANCEL_RATIO;          // 撤单占全部输入的比例
+    double marketRatio = DEFAULT_LOAD_MARKET_RATIO;          // 市价单占全部输入的比例
+    int64_t priceSpreadTicks = DEFAULT_LOAD_PRICE_SPREAD_TICKS;      // 限价相对中间价偏移的标准差
+    int64_t midVolatilityTicks = DEFAULT_LOAD_MID_VOLATILITY_TICKS;  // 每笔新订单中间价随机游走的步长标准差
+    std::map<std::string, Price> midPrices;                  // 各交易对的初始中间价，未配置的用 DEFAULT_LOAD_MID_PRICE
+    uint64_t userCount = DEFAULT_LOAD_USER_COUNT;            // 订单随机分配给这么多个用户
+    bool writeToDatabase = false;                            // 是否像 OrderGenerator 一样先把新订单写库
+    uint32_t firstOrderId = DEFAULT_LOAD_FIRST_ORDER_ID;     // 不写库时的起始订单号；写库时从库中最大订单号之后开始
+    // 统计往返延迟时以 PULL 方式连接撮合引擎的结果端口；结果在所有 PULL 端之间轮流分发，
+    // 因此只应在不运行持久化程序时开启；为空时不统计
+    std::string resultAddress;
+};
+
+// 从配置文件的 "load" 节读取压测参数，缺省项使用默认值
+LoadConfig readLoadConfig(const std::string& configFile);
+
+// 开环压测：多个发送线程按目标速率和到达过程安排发送时刻，不等待撮合结果；
+// 订单的 createTime 取计划发送时刻，发送端落后时排队时间也计入往返延迟，不会被掩盖
+// 价格围绕随机游走的中间价分布，部分限价单越过中间价直接成交
+class LoadGenerator {
+public:
+    // connectionPool 为空时不写库
+    LoadGenerator(zmq::context_t& context, const std::string& orderServerAddress, const std::vector<Instrument>& instruments,
+                  WireFormat wireFormat, const LoadConfig& loadConfig, DbConnectionPool* connectionPool = nullptr);
+
+    // 运行 durationSeconds 秒，期间每秒记录一次进度，结束后记录汇总
+    void run();
+
+private:
+    void produce(size_t producer);
+    void receiveResults();
+    void recordAcknowledgement(const WireOrder& order);
+    void logProgress(const char* label, double seconds);
+    unsigned int getMaxOrderId();
+
+    zmq::context_t& context;
+    std::string orderServerAddress;
+    std::vector<Instrument> instruments;
+    WireFormat wireFormat;
+    LoadConfig config;
+    DbConnectionPool* connectionPool;
+
+    std::unique_ptr<std::atomic<int64_t>[]> midTicks;   // 各交易对当前中间价（tick 数），各发送线程共同推动
+    std::atomic<unsigned int> orderIdCounter;
+    unsigned int firstOrderId = 0;
+    std::atomic<bool> running;
+    std::atomic<bool> receiving;
+
+    Counter ordersSent;
+    Counter cancelsSent;
+    Counter resultsReceived;
+    Histogram roundTripLatency;         // 新订单从计划发送到收到第一条结果
+    std::vector<bool> acknowledged;     // 下标为 orderId - firstOrderId，只由接收线程使用
+};
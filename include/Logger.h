@@ -6,7 +6,11 @@
 #include <chrono>
 #include <iomanip>
 #include <mutex>
+#include <atomic>
+#include <memory>
 #include <string>
+#include <thread>
+#include <vector>
 
 enum LogLevel {
     DEBUG,
@@ -15,6 +19,8 @@ enum LogLevel {
     ERROR
 };
 
+// 异步日志：调用线程只把日志记录放进自己的无锁环形缓冲区，
+// 由后台写线程统一格式化、批量写文件，撮合线程上不再有锁、格式化和 flush
 class Logger {
 public:
     static Logger& getInstance() {
@@ -22,78 +28,97 @@ public:
         return instance;
     }
 
-    void init(const std::string& logFilePath, LogLevel level = INFO) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        if (!logFile.is_open()) {
-            logFile.open(logFilePath, std::ios_base::app); // 以追加模式打开文件
-            if (!logFile.is_open()) {
-                std::cerr << "Failed to open log file: " << logFilePath << std::endl;
-                return;
-            }
-        }
-        currentLogLevel = level;
-    }
+    void init(const std::string& logFilePath, LogLevel level = INFO);
+    void setLogLevel(LogLevel level) { currentLogLevel.store(level, std::memory_order_relaxed); }
 
-    void setLogLevel(LogLevel level) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        currentLogLevel = level;
+    // 无锁读取当前级别，LOG 宏据此决定是否拼接日志内容
+    bool isEnabled(LogLevel level) const {
+        return level >= currentLogLevel.load(std::memory_order_relaxed);
     }
 
-    void log(const std::string& message, LogLevel level, const char* file, int line) {
-        std::lock_guard<std::mutex> lock(logMutex);
-        if (level < currentLogLevel) {
-            return;
-        }
-
-        auto now = std::chrono::system_clock::now();
-        auto now_time_t = std::chrono::system_clock::to_time_t(now);
-        auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(now.time_since_epoch()) % 1000;
+    // file 须为静态字符串（__FILE__），写线程延后读取
+    void log(std::string message, LogLevel level, const char* file, int line);
 
-        std::tm now_tm = *std::localtime(&now_time_t);
-        std::ostringstream timestamp;
-        timestamp << std::put_time(&now_tm, "%Y-%m-%d %H:%M:%S") << '.' << std::setfill('0') << std::setw(3) << now_ms.count();
+    // 等待写线程把当前已提交的日志全部写出
+    void flush();
 
-        std::string fileName = file;
-        size_t lastSlash = fileName.find_last_of("\\/");
-        if (lastSlash != std::string::npos) {
-            fileName = fileName.substr(lastSlash + 1);
-        }
-
-        std::ostringstream logMessage;
-        logMessage << "[" << timestamp.str() << "] [" << getLevelString(level) << "] [" << fileName << ":" << line << "] " << message;
-
-        if (logFile.is_open()) {
-            logFile << logMessage.str() << std::endl;
-        }
-    }
+    // 缓冲区满时丢弃的 DEBUG / INFO 日志条数
+    uint64_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
 
 private:
-    Logger() : currentLogLevel(INFO) {}
-    ~Logger() {
-        if (logFile.is_open()) {
-            logFile.close();
+    struct Record {
+        int64_t timestamp;      // 自 epoch 起的纳秒
+        LogLevel level;
+        const char* file;
+        int line;
+        std::string message;
+    };
+
+    // 单生产者（日志调用线程）单消费者（写线程）环形缓冲区
+    class ThreadBuffer {
+    public:
+        static constexpr size_t CAPACITY = 8192;   // 必须是 2 的幂
+
+        bool tryPush(Record& record);
+        bool tryPop(Record& record);
+        bool empty() const { return head.load(std::memory_order_acquire) == tail.load(std::memory_order_acquire); }
+
+        std::atomic<bool> retired{false};   // 所属线程已退出，取空后由写线程回收
+
+    private:
+        std::vector<Record> records = std::vector<Record>(CAPACITY);
+        alignas(64) std::atomic<size_t> head{0};   // 下一个读取位置，写线程独占修改
+        alignas(64) std::atomic<size_t> tail{0};   // 下一个写入位置，生产者独占修改
+    };
+
+    // 线程退出时把缓冲区标记为 retired
+    struct BufferHandle {
+        std::shared_ptr<ThreadBuffer> buffer;
+        ~BufferHandle() {
+            if (buffer) {
+                buffer->retired.store(true, std::memory_order_release);
+            }
         }
-    }
+    };
+
+    Logger();
+    ~Logger();
 
     Logger(const Logger&) = delete;
     Logger& operator=(const Logger&) = delete;
 
+    ThreadBuffer& threadBuffer();
+    void writerLoop();
+    size_t drainBuffers();
+    void formatRecord(const Record& record);
+    void writeOut();
+
+    std::atomic<LogLevel> currentLogLevel;
+    std::atomic<uint64_t> dropped;
+    std::atomic<bool> running;
+
+    std::mutex buffersMutex;        // 仅在线程首次写日志注册缓冲区时使用
+    std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+
+    // 以下成员只由写线程访问（init 时持有 fileMutex）
+    std::mutex fileMutex;
     std::ofstream logFile;
-    std::mutex logMutex;
-    LogLevel currentLogLevel;
-
-    const char* getLevelString(LogLevel level) const {
-        switch (level) {
-            case DEBUG: return "DEBUG";
-            case INFO: return "INFO";
-            case WARN: return "WARN";
-            case ERROR: return "ERROR";
-            default: return "UNKNOWN";
-        }
-    }
+    std::string pending;            // 待写出的已格式化日志
+    int64_t cachedSecond;           // 已缓存时间戳前缀对应的秒
+    char cachedTimestamp[32];       // "YYYY-MM-DD HH:MM:SS"
+
+    std::atomic<uint64_t> flushRequests;
+    std::atomic<uint64_t> flushesDone;
+    std::thread writerThread;
 };
 
-#define LOG(message, level) Logger::getInstance().log(message, level, __FILE__, __LINE__)
+// 级别未开启时不求值 message，避免热路径上无用的字符串拼接和拷贝
+#define LOG(message, level) \
+    do { \
+        if (Logger::getInstance().isEnabled(level)) { \
+            Logger::getInstance().log(message, level, __FILE__, __LINE__); \
+        } \
+    } while (0)
 #define LOG_INFO(message) LOG(message, LogLevel::INFO)
 #define LOG_ERROR(message) LOG(message, LogLevel::ERROR)
 #define LOG_DEBUG(message) LOG(message, LogLevel::DEBUG)
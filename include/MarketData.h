@@ -0,0 +1,15 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "WireProtocol.h"
+
+// 行情 PUB 端口上的消息：BOOK_SNAPSHOT / BOOK_DELTA / TRADE_PRINTS，二进制或 JSON 调试格式
+// 返回消息类型，订阅端据此分发
+WireMessageType readMarketDataType(const void* data, size_t size);
+
+// 解析二进制或 JSON 格式的成交流水消息
+std::vector<TradePrint> parseTradePrintsMessage(const void* data, size_t size);
+
+// JSON 调试格式：{"type": "TRADE_PRINTS", "symbol", "trades": [{"tradeId", "side", "price", "quantity", "time"}...]}
+std::string serializeTradePrints(const std::string& symbol, const std::vector<TradePrint>& trades);
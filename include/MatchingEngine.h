@@ -1,49 +1,248 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <functional>
 #include <thread>
 #include <map>
-#include <cmath>
 #include <zmq.hpp>
-#include <unordered_map>
+#include <memory>
+#include <vector>
 #include "Order.h"
+#include "Instrument.h"
+#include "EngineConfig.h"
+#include "WireProtocol.h"
+#include "OrderBook.h"
 #include "TradeRecord.h"
+#include "Journal.h"
+#include "Snapshot.h"
+#include "DepthFeed.h"
+#include "SpscQueue.h"
+#include "Metrics.h"
 #include "Logger.h"
 
+// 撮合引擎各阶段的运行指标，同一进程内的各分片共用
+struct EngineMetrics {
+    EngineMetrics();
+
+    Counter& commandsDecoded;
+    Counter& commandsRejected;      // 解码或校验失败被丢弃的输入
+    Counter& commandsMatched;
+    Counter& trades;
+    Counter& selfTradesPrevented;   // 因防自成交而未成交的次数
+    Counter& resultsSent;
+    Counter& marketDataSent;
+    Histogram& decodeLatency;
+    Histogram& matchLatency;        // 单条命令在撮合线程上的耗时
+    Histogram& batchSize;
+    Histogram& massOrderSize;       // 每条批量下单消息的指令数
+    Histogram& encodeLatency;
+    Histogram& sendLatency;         // 一批结果消息写入 ZeroMQ 的耗时
+};
+
+// 单个交易对的撮合状态：交易对参数、订单簿、输入日志以及 L2 行情和成交流水的发布状态
+struct SymbolBook {
+    SymbolBook(const Instrument& instrument, const EngineConfig& engineConfig);
+
+    Instrument instrument;
+    OrderBook orderBook;
+
+    DepthPublisher depthPublisher;
+    bool depthChanged = false;              // 上次发布后订单簿是否有变化
+    bool depthSnapshotRequested = false;
+    std::chrono::steady_clock::time_point lastDepthSnapshotTime;
+    std::vector<TradePrint> pendingTrades;  // 本批撮合产生、尚未发布的成交
+    uint64_t tradeSequence = 0;             // 最后分配的成交序号，与交易对编号拼成成交号
+
+    std::unique_ptr<Journal> journal;       // 未配置日志目录时为空
+    std::string snapshotPath;
+    uint64_t inputsSinceSnapshot = 0;
+};
+
+// 解码线程交给撮合线程的命令：订单、撤单、改单都解成定长的 Order，交易对已查好
+enum class EngineCommandType : uint8_t {
+    NEW_ORDER,
+    CANCEL,                     // order.orderId
+    CANCEL_ALL,                 // order.userId；order.symbol 为空时撤销本分片所有交易对
+    AMEND,                      // order.orderId / price / quantity，为 0 表示沿用原值
+    MASS_ORDER,                 // order.symbol / userId / createTime 为各条指令共用，指令在 instructions
+    BOOK_SNAPSHOT_REQUEST,
+    TICK                        // 接收超时，撮合线程借此发布到期的行情快照
+};
+
+struct EngineCommand {
+    EngineCommandType type;
+    SymbolBook* book;           // 交易对未知时为空
+    Order order;
+    std::vector<MassInstruction> instructions;      // 只用于 MASS_ORDER，槽位复用时保留容量
+};
+
+constexpr size_t MAX_RESULT_MESSAGE_SIZE = std::max({sizeof(OrderWireMessage), sizeof(TradeWireMessage), sizeof(RejectWireMessage)});
+
+// 撮合线程交给发布线程的结果：一条定长的二进制结果消息，或一批撮合结束的标记
+enum class ResultEventType : uint8_t {
+    MESSAGE,
+    FLUSH
+};
+
+struct ResultEvent {
+    ResultEventType type;
+    uint32_t size;
+    alignas(8) unsigned char data[MAX_RESULT_MESSAGE_SIZE];
+};
+
+// 撮合线程交给发布线程的行情：L2 快照或增量、一批成交流水；缓冲随槽位轮转复用
+// 每批撮合每个交易对至多两条，队列不必很长
+constexpr size_t MIN_MARKET_DATA_QUEUE_SIZE = 1024;
+
+enum class MarketDataEventType : uint8_t {
+    DEPTH,
+    TRADES
+};
+
+struct MarketDataEvent {
+    MarketDataEventType type;
+    const std::string* symbol;
+    DepthUpdate depth;
+    std::vector<TradePrint> trades;
+};
+
+// 流水线各阶段绑定的 CPU，-1 表示不绑定
+struct PipelineCpus {
+    int decoder = -1;
+    int matcher = -1;
+    int publisher = -1;
+};
+
+// 撮合引擎分片：在一组线程内负责一组互不重叠的交易对，每个交易对一本订单簿
+// 分三个阶段：解码线程收取并解码订单，撮合线程只做订单簿操作，发布线程编码并发送结果和行情；
+// 阶段之间用单生产者单消费者环形队列交接
 class MatchingEngine {
 public:
-    MatchingEngine(zmq::socket_t& orderSocket, zmq::socket_t& resultSocket, zmq::socket_t& bookSocket);
+    MatchingEngine(zmq::socket_t& orderSocket, zmq::socket_t& resultSocket, zmq::socket_t& bookSocket,
+                   const std::vector<Instrument>& instruments, const EngineConfig& engineConfig,
+                   const PipelineCpus& cpus = PipelineCpus());
+    // 启动解码和发布线程，撮合阶段在调用线程运行，直到 stop()
     void start();
     void stop();
 
+    // 所有订单簿内部（订单池、索引、价格阶梯）的累计堆分配次数，稳态下应不再增长
+    uint64_t allocationCount() const;
+    // 所有订单簿的挂单总数
+    size_t restingOrderCount() const;
+
+    // 启动时批量恢复挂单（如从数据库读出的未完成订单），须在 start() 之前按时间顺序调用；
+    // 直接放入订单簿，不经过撮合，不记日志也不产生结果。不属于本分片或无法挂单的订单返回 false
+    bool restoreOrder(Order& order);
+
+    // 进程内直接驱动（基准测试、离线回放），不能与 start() 同时使用：
+    // submit() 在调用线程完成解码和撮合，endBatch() 结束一批并产生行情，
+    // 产生的结果和行情留在队列中，须在队列写满前调用 discardOutput() 取走（不编码、不发送），恢复时重新产生的结果也一并取走
+    bool submit(const void* data, size_t size);
+    void endBatch();
+    size_t discardOutput(const std::function<void(const ResultEvent&)>& onResult = nullptr);
+
 private:
+    // 解码阶段
+    void decodeLoop();
+    bool decodeCommand(const void* data, size_t size, EngineCommand& command);
+    bool decodeBinaryCommand(const void* data, size_t size, EngineCommand& command);
+    bool resolveCommand(EngineCommand& command);
+    SymbolBook* findBook(const std::string& symbol);
+
+    // 撮合阶段
     void run();
-    void processOrder(Order& order);
-    void addOrderToBook(Order& order, std::map<double, std::map<unsigned int, Order>>& orderBook);
-    void matchOrders(Order& order, std::map<double, std::map<unsigned int, Order>>& oppositeOrders,
-                     std::map<double, std::map<unsigned int, Order>>& ownOrders, bool isBuyOrder);
-    void matchBuyOrders(Order& order, std::map<double, std::map<unsigned int, Order>>& oppositeOrders,
-                        std::map<double, std::map<unsigned int, Order>>& ownOrders);
-    void matchSellOrders(Order& order, std::map<double, std::map<unsigned int, Order>>& oppositeOrders,
-                         std::map<double, std::map<unsigned int, Order>>& ownOrders);
-    void processTrade(Order& order, Order& oppositeOrder);
+    bool processBatch();
+    void executeCommand(EngineCommand& command);
+    void journalInput(SymbolBook& book, const void* data, size_t size);
+    void recoverBook(SymbolBook& book);
+    void snapshotBook(SymbolBook& book);
+    void takeSnapshots(uint64_t minInputs);
+    void finishSnapshots();
+    void syncJournals();
+    void processOrder(SymbolBook& book, Order& order);
+    void processMassOrder(SymbolBook& book, const Order& common, const std::vector<MassInstruction>& instructions);
+    void cancelOrder(SymbolBook* book, const std::string& symbol, unsigned int orderId);
+    void cancelAllOrders(SymbolBook* book, unsigned long long userId);
+    void cancelUserOrders(SymbolBook& book, unsigned long long userId);
+    void cancelRestingOrder(SymbolBook& book, OrderHandle handle);
+    void amendOrder(SymbolBook* book, const std::string& symbol, unsigned int orderId, Price newPrice, Quantity newQuantity);
+    OrderHandle addOrderToBook(SymbolBook& book, Order& order);
+    void expireOrder(Order& order, const char* reason);
+    // amended 为 true 表示改单后重新撮合：改单已回报 AMENDED，挂入订单簿时不再回报 UNMATCHED_ORDER
+    void matchOrders(SymbolBook& book, Order& order, bool amended = false);
+    Quantity fillableQuantity(SymbolBook& book, const Order& order, Price limitPrice, Quantity needed);
+    // 以下三个函数返回 true 表示主动单因防自成交须停止撮合、剩余部分撤销
+    // selfTradeReduced 累计 DECREMENT 从主动单扣掉的数量，撮合只进行到 quantity - filledQuantity - selfTradeReduced
+    bool matchBuyOrders(SymbolBook& book, Order& buyOrder, Quantity& selfTradeReduced);
+    bool matchSellOrders(SymbolBook& book, Order& sellOrder, Quantity& selfTradeReduced);
+    bool preventSelfTrade(SymbolBook& book, Order& order, OrderHandle restingHandle, Quantity& selfTradeReduced);
+    // takerRemaining 为主动单本次还能成交的数量（已扣除防自成交减掉的部分）
+    void processTrade(SymbolBook& book, Order& order, OrderHandle oppositeHandle, Quantity takerRemaining);
+    template <typename T, typename Encode>
+    void emitResult(Encode&& encode);
+    void emitFlush();
     void generateUnmatchedOrderMessage(const Order& order);
+    void generateOrderUpdateMessage(WireMessageType type, const Order& order);
+    void generateRejectMessage(WireMessageType type, unsigned int orderId, const std::string& reason);
     void generateTradeMessage(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade);
-    TradeRecord createTradeRecord(const Order& buyOrder, const Order& sellOrder, double tradeQuantity, double tradePrice, const std::string& orderType);
-    double roundToPrecision(double value, int precision);
-    void publishOrderBook();
-    std::string formatOrderBook();
-
-    zmq::socket_t& orderSocket;
-    zmq::socket_t& resultSocket;
-    zmq::socket_t& bookSocket;
-    std::thread workerThread;
-    bool running;
-
-    std::map<double, std::map<unsigned int, Order>> buyOrders;
-    std::map<double, std::map<unsigned int, Order>> sellOrders;
-
-    // 用于控制订单簿发布频率的变量
-    std::chrono::steady_clock::time_point lastPublishTime;
+    TradeRecord createTradeRecord(uint64_t tradeId, const Order& buyOrder, const Order& sellOrder, Quantity tradeQuantity, Price tradePrice, const std::string& orderType);
+    void publishMarketData();
+    void publishTrades(SymbolBook& book);
+    void publishDepth(SymbolBook& book, std::chrono::steady_clock::time_point now);
+    MarketDataEvent& claimMarketData();
+
+    // 发布阶段
+    void publishLoop();
+    void publishRecoveredResults();
+    void publishResult(const ResultEvent& event);
+    bool drainResults();
+    bool drainMarketData();
+    zmq::message_t encodeResult(const ResultEvent& event) const;
+    void flushResults();
+    void sendMarketData(const std::string& symbol, std::string&& payload);
+
+    zmq::socket_t& orderSocket;         // 只由解码线程使用
+    zmq::socket_t& resultSocket;        // 只由发布线程使用
+    zmq::socket_t& bookSocket;          // 只由发布线程使用
+    std::thread decoderThread;
+    std::thread publisherThread;
+    std::atomic<bool> running;
+    std::atomic<bool> matcherDone;      // 撮合线程已退出，发布线程取空队列后退出
+    PipelineCpus cpus;
+
+    WireFormat wireFormat;      // 结果与订单簿消息的编码方式
+    SelfTradePrevention selfTradePrevention;
+
+    SpscQueue<EngineCommand> commands;          // 解码 -> 撮合
+    SpscQueue<ResultEvent> results;             // 撮合 -> 发布
+    SpscQueue<MarketDataEvent> marketData;      // 撮合 -> 发布
+
+    // 批量撮合与批量发布：一批命令的撮合结果只在批末的 FLUSH 标记处合并成一条多帧消息发出，
+    // 同一条批量下单的结果不会被拆到两条消息里
+    size_t orderBatchSize;
+    std::chrono::microseconds maxBatchDelay;
+    std::vector<zmq::message_t> pendingResults;     // 只由发布线程使用
+
+    // 每批撮合结束后先发布本批成交流水，再发布有变化的交易对的 L2 增量，并按间隔发布全量快照
+    std::chrono::milliseconds depthSnapshotInterval;
+
+    // 本分片负责的交易对；分片内交易对很少，按名称线性查找；创建后不再增减，解码线程只读
+    std::vector<std::unique_ptr<SymbolBook>> books;
+    EngineCommand directCommand;            // submit() 复用的命令
+
+    // 每个交易对的输入先写日志再撮合，定期写快照；启动时从快照和日志尾部恢复
+    uint64_t snapshotInterval;
+    JournalSync journalSync;
+    uint64_t flushesEmitted = 0;                // 撮合线程产生的批末标记数
+    std::atomic<uint64_t> flushesSent{0};       // 发布线程已发出的批末标记数，写快照线程据此等待结果发出
+    SnapshotJob snapshotJob;                    // 与写快照线程交换的任务，缓冲复用
+    std::unique_ptr<SnapshotWriter> snapshotWriter;     // 未配置日志目录时为空
+    bool replaying;             // 回放日志期间不再记日志，也不发布行情；结果暂存到 recoveredResults
+    std::vector<ResultEvent> recoveredResults;      // 构造时写入，发布线程启动后最先发出，随后释放
+    bool journalSuspended;      // 批量下单已整条记日志，执行其中各条指令时不再分别记录
+
+    EngineMetrics metrics;
 };
 
 // 声明外部日志函数
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "SpscQueue.h"
+
+// 进程内运行指标：计数器和直方图按线程分片，记录时只改本线程独占的分片，不加锁、不与其它线程争用缓存行；
+// 抓取时把各分片相加，按 Prometheus 文本格式导出
+
+// 前 MAX_METRIC_THREADS - 1 个用到指标的线程各占一个分片，之后的线程共用最后一个分片并改用原子加
+constexpr size_t MAX_METRIC_THREADS = 64;
+
+// 当前线程的分片下标，首次调用时分配
+size_t metricThreadSlot();
+
+inline bool isSharedMetricSlot(size_t slot) {
+    return slot == MAX_METRIC_THREADS - 1;
+}
+
+// 独占分片只有本线程写，读出再写回即可，省去带 lock 前缀的读改写；共用分片才需要 fetch_add
+inline void addToSlot(std::atomic<uint64_t>& cell, uint64_t value, bool shared) {
+    if (shared) {
+        cell.fetch_add(value, std::memory_order_relaxed);
+    } else {
+        cell.store(cell.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+    }
+}
+
+inline uint64_t elapsedNanos(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+}
+
+// 单调递增计数器
+class Counter {
+public:
+    void add(uint64_t value = 1) {
+        size_t slot = metricThreadSlot();
+        addToSlot(slots[slot].value, value, isSharedMetricSlot(slot));
+    }
+
+    uint64_t value() const;
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Slot {
+        std::atomic<uint64_t> value{0};
+    };
+
+    Slot slots[MAX_METRIC_THREADS];
+};
+
+// 对数线性分桶：每个 2 的幂区间分 32 个桶，相对误差不超过约 3%，覆盖整个 uint64 范围
+constexpr unsigned HISTOGRAM_SUB_BUCKET_BITS = 5;
+constexpr uint64_t HISTOGRAM_SUB_BUCKETS = uint64_t(1) << HISTOGRAM_SUB_BUCKET_BITS;
+constexpr size_t HISTOGRAM_BUCKET_COUNT = (64 - HISTOGRAM_SUB_BUCKET_BITS) * HISTOGRAM_SUB_BUCKETS + HISTOGRAM_SUB_BUCKETS;
+
+inline size_t histogramBucketOf(uint64_t value) {
+    if (value < HISTOGRAM_SUB_BUCKETS) {
+        return static_cast<size_t>(value);
+    }
+    unsigned shift = 63 - __builtin_clzll(value) - HISTOGRAM_SUB_BUCKET_BITS;
+    return shift * HISTOGRAM_SUB_BUCKETS + static_cast<size_t>(value >> shift);
+}
+
+// 桶内的最大值
+uint64_t histogramBucketUpperBound(size_t bucket);
+
+// 某一时刻各分片合并后的直方图
+struct HistogramSnapshot {
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(HISTOGRAM_BUCKET_COUNT, 0);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t max = 0;
+
+    // 分位数取所在桶的上界
+    uint64_t percentile(double p) const;
+    double mean() const { return count == 0 ? 0.0 : static_cast<double>(sum) / count; }
+    // 不超过 bound 的样本数，bound 落在桶内时按整桶计入上一级
+    uint64_t countAtMost(uint64_t bound) const;
+};
+
+// HDR 风格的直方图，各线程首次记录时才分配自己的分片
+class Histogram {
+public:
+    Histogram() = default;
+    ~Histogram();
+
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    void record(uint64_t value) {
+        size_t slot = metricThreadSlot();
+        Shard* shard = shards[slot].load(std::memory_order_acquire);
+        if (shard == nullptr) {
+            shard = allocateShard(slot);
+        }
+        bool shared = isSharedMetricSlot(slot);
+        addToSlot(shard->buckets[histogramBucketOf(value)], 1, shared);
+        addToSlot(shard->sum, value, shared);
+        uint64_t max = shard->max.load(std::memory_order_relaxed);
+        while (value > max && !shard->max.compare_exchange_weak(max, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    HistogramSnapshot snapshot() const;
+
+private:
+    struct alignas(CACHE_LINE_SIZE) Shard {
+        std::atomic<uint64_t> sum{0};
+        std::atomic<uint64_t> max{0};
+        std::atomic<uint64_t> buckets[HISTOGRAM_BUCKET_COUNT] = {};
+    };
+
+    Shard* allocateShard(size_t slot);
+
+    std::atomic<Shard*> shards[MAX_METRIC_THREADS] = {};
+};
+
+// 进程内的指标注册表；同名指标只创建一次，多个分片/线程拿到的是同一个对象
+// 指标在进程生命周期内不释放，调用方可以长期持有返回的引用
+class MetricsRegistry {
+public:
+    static MetricsRegistry& getInstance();
+
+    Counter& counter(const std::string& name, const std::string& help);
+    // 以纳秒记录，导出为秒，桶边界按 1-2-5 序列从 100ns 到 10s
+    Histogram& latencyHistogram(const std::string& name, const std::string& help);
+    // 批量大小等计数类分布，桶边界为 1 到 65536 的 2 的幂
+    Histogram& sizeHistogram(const std::string& name, const std::string& help);
+
+    // Prometheus 文本格式（0.0.4）
+    std::string renderPrometheus() const;
+
+private:
+    MetricsRegistry() = default;
+
+    enum class HistogramUnit { NANOSECONDS, COUNT };
+
+    struct CounterEntry {
+        std::string help;
+        std::unique_ptr<Counter> counter;
+    };
+
+    struct HistogramEntry {
+        std::string help;
+        HistogramUnit unit;
+        std::unique_ptr<Histogram> histogram;
+    };
+
+    Histogram& histogram(const std::string& name, const std::string& help, HistogramUnit unit);
+
+    mutable std::mutex mutex;
+    std::map<std::string, CounterEntry> counters;
+    std::map<std::string, HistogramEntry> histograms;
+};
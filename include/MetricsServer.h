@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include <thread>
+#include "httplib.h"
+
+constexpr int DEFAULT_MATCH_METRICS_PORT = 9101;
+constexpr int DEFAULT_PERSISTENCE_METRICS_PORT = 9102;
+constexpr int DEFAULT_GATEWAY_METRICS_PORT = 9103;
+
+// 各组件是独立进程，各自在自己的端口上导出本进程的指标；端口为 0 时不启动
+// 健康检查进程已有 HTTP 服务，直接挂在它的 /metrics 上
+struct MetricsConfig {
+    std::string host = "localhost";
+    int matchPort = DEFAULT_MATCH_METRICS_PORT;
+    int persistencePort = DEFAULT_PERSISTENCE_METRICS_PORT;
+    int gatewayPort = DEFAULT_GATEWAY_METRICS_PORT;
+};
+
+// 从配置文件的 "metrics" 节读取指标端口，缺省项使用默认值
+MetricsConfig readMetricsConfig(const std::string& configFile);
+
+// 在已有的 HTTP 服务上注册 GET /metrics
+void registerMetricsEndpoint(httplib::Server& server);
+
+// 只提供 /metrics 的 HTTP 服务，在后台线程中监听；抓取只读各线程的分片，不影响撮合线程
+class MetricsServer {
+public:
+    MetricsServer(const std::string& host, int port);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    void start();
+    void stop();
+
+private:
+    httplib::Server svr_;
+    std::string host_;
+    int port_;
+    std::thread listenThread_;
+};
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <functional>
+#include <string>
+#include <vector>
+#include "DbConnection.h"
+#include "Order.h"
+
+// 从 orders 表流式读取未完成订单（INITIAL / MATCHING / PARTIALLY_FILLED），按撮合引擎写入的入簿时间（微秒）升序、
+// 同一时间按订单号逐笔回调，同价位按原时间顺序恢复；symbols 非空时只读取这些交易对。回调拿到的订单可以移走
+// 返回读到的订单数，查询失败时抛出 std::runtime_error
+size_t loadOpenOrders(DbConnection& dbConn, const std::vector<std::string>& symbols, const std::function<void(Order&)>& onOrder);
@@ -5,6 +5,8 @@
 #include <sstream>
 #include <iomanip>
 #include <ctime>
+#include "FixedPoint.h"
+#include "Timestamp.h"
 #include "TradeRecord.h"
 
 enum class OrderSide {
@@ -19,6 +21,16 @@ enum class OrderType {
     UNKNOWN
 };
 
+// 有效方式：GTC 未成交部分挂单；IOC 立即成交、剩余撤销；FOK 全部成交否则整单撤销；
+// POST_ONLY 只挂单，会立即成交时整单撤销；市价单总是按 IOC 处理
+enum class TimeInForce {
+    GTC,
+    IOC,
+    FOK,
+    POST_ONLY,
+    UNKNOWN
+};
+
 enum class OrderStatus {
     INITIAL,
     MATCHING,
@@ -29,18 +41,23 @@ enum class OrderStatus {
     UNKNOWN
 };
 
+// 未指定交易对时的缺省值，与 orders.trading_pair 的默认值一致
+constexpr const char* DEFAULT_SYMBOL = "BTC_USDT";
+
 struct Order {
     unsigned int orderId;
     unsigned long long userId;
-    double price;
-    double quantity;
-    double feeRate;
+    std::string symbol;       // 交易对，对应 orders.trading_pair
+    Price price;              // 定点价格，PRICE_DECIMALS 位小数
+    Quantity quantity;        // 定点数量，QUANTITY_DECIMALS 位小数
+    FeeRate feeRate;          // 定点费率，FEE_RATE_DECIMALS 位小数
     OrderSide orderSide;
     OrderType orderType;
     OrderStatus status;
-    std::chrono::time_point<std::chrono::system_clock> createTime;
-    std::chrono::time_point<std::chrono::system_clock> updateTime;
-    double filledQuantity;
+    Timestamp createTime;     // 纳秒精度，同价位按时间优先
+    Timestamp updateTime;
+    Quantity filledQuantity;
+    TimeInForce timeInForce = TimeInForce::GTC;
 
     // Comparison operators for priority_queue
     bool operator<(const Order& other) const {
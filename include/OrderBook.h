@@ -0,0 +1,216 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include "Order.h"
+#include "OrderPool.h"
+
+// 单个价位：同一价格的挂单按到达顺序排成 FIFO 队列，保证时间优先
+struct PriceLevel {
+    OrderHandle head = NULL_HANDLE;
+    OrderHandle tail = NULL_HANDLE;
+    uint32_t orderCount = 0;
+    Quantity quantity = 0;      // 价位内所有挂单的剩余数量之和，供 L2 行情直接读取
+
+    bool empty() const { return head == NULL_HANDLE; }
+};
+
+// 单边价格阶梯：最优价附近固定宽度的窗口按 tick 偏移连续存放价位，配合占用位图和最优价游标；
+// 窗口外更差的价位放进有序的溢出区。价格越过窗口变优时窗口平移，窗口内挂单吃空后在下次取最优价时移到溢出区的最优价
+class PriceLadder {
+public:
+    PriceLadder(bool highestFirst, size_t windowLevels);
+
+    // 返回 tick 对应的价位，不存在时创建；窗口外更差的价位落在溢出区
+    PriceLevel* levelAt(int64_t tick);
+    // 已有价位，不存在时返回 nullptr
+    PriceLevel* findLevel(int64_t tick);
+    // 最优价位，空时返回 nullptr；窗口为空而溢出区有挂单时先把窗口移过去，保证撮合只发生在窗口内
+    PriceLevel* best();
+    bool empty() const { return bestIndex < 0 && overflow.empty(); }
+    uint64_t allocationCount() const { return allocations; }
+
+    void markOccupied(int64_t tick);
+    // 价位吃空：窗口内清除占用位，溢出区直接删除该价位
+    void markEmpty(int64_t tick);
+
+    // 从最优价位起依次遍历至多 count 个非空价位
+    template <typename Fn>
+    void forEachBestLevel(size_t count, Fn&& fn) const {
+        forEachBestLevelWhile([&count, &fn](int64_t tick, const PriceLevel& level) {
+            if (count == 0) {
+                return false;
+            }
+            fn(tick, level);
+            return --count > 0;
+        });
+    }
+
+    // 从最优价位起依次遍历非空价位，回调返回 false 时停止；溢出区的价位都比窗口内的差，排在最后
+    template <typename Fn>
+    void forEachBestLevelWhile(Fn&& fn) const {
+        for (int64_t index = bestIndex; index >= 0; ) {
+            if (!fn(baseTick + index, levels[index])) {
+                return;
+            }
+            index = highestFirst ? findPrevOccupied(index) : findNextOccupied(index);
+        }
+        if (highestFirst) {
+            for (auto it = overflow.rbegin(); it != overflow.rend(); ++it) {
+                if (!fn(it->first, it->second)) {
+                    return;
+                }
+            }
+        } else {
+            for (auto it = overflow.begin(); it != overflow.end(); ++it) {
+                if (!fn(it->first, it->second)) {
+                    return;
+                }
+            }
+        }
+    }
+
+    // 从低价到高价遍历所有非空价位
+    template <typename Fn>
+    void forEachLevel(Fn&& fn) const {
+        // 买盘的溢出区在窗口下方，卖盘的在窗口上方
+        if (highestFirst) {
+            for (const auto& entry : overflow) {
+                fn(entry.first, entry.second);
+            }
+        }
+        for (size_t word = 0; word < occupied.size(); ++word) {
+            uint64_t bits = occupied[word];
+            while (bits) {
+                int64_t index = static_cast<int64_t>(word * 64 + __builtin_ctzll(bits));
+                fn(baseTick + index, levels[index]);
+                bits &= bits - 1;
+            }
+        }
+        if (!highestFirst) {
+            for (const auto& entry : overflow) {
+                fn(entry.first, entry.second);
+            }
+        }
+    }
+
+private:
+    int64_t windowSize() const { return static_cast<int64_t>(levels.size()); }
+    bool inWindow(int64_t tick) const { return tick >= baseTick && tick - baseTick < windowSize(); }
+    // tick 是否优于窗口内的所有价位
+    bool betterThanWindow(int64_t tick) const { return highestFirst ? tick >= baseTick + windowSize() : tick < baseTick; }
+    void recenter(int64_t tick);
+    void moveLevel(int64_t from, int64_t to);
+    int64_t findNextOccupied(int64_t index) const;
+    int64_t findPrevOccupied(int64_t index) const;
+
+    bool highestFirst;      // 买单以最高价为最优，卖单以最低价为最优
+    size_t windowLevels;
+    int64_t baseTick;       // levels[0] 对应的 tick
+    int64_t bestIndex;      // 窗口内最优价位下标，-1 表示窗口内没有挂单
+    std::vector<PriceLevel> levels;
+    std::vector<uint64_t> occupied;
+    // 窗口外的价位，都比窗口内的差；只有远离盘口的挂单才会落在这里
+    std::map<int64_t, PriceLevel> overflow;
+    uint64_t allocations;
+};
+
+// 价格阶梯订单簿：买卖两边各一条 PriceLadder，撮合顺序为价格优先、时间优先
+class OrderBook {
+public:
+    static constexpr size_t DEFAULT_ORDER_CAPACITY = 1024 * 1024;
+    static constexpr size_t DEFAULT_WINDOW_LEVELS = 64 * 1024;
+
+    // tickSize 为定点价格单位，价位下标 = price / tickSize；orderCapacity 为订单池预分配的节点数，
+    // windowLevels 为每边价格窗口的价位数
+    explicit OrderBook(Price tickSize, size_t orderCapacity = DEFAULT_ORDER_CAPACITY, size_t windowLevels = DEFAULT_WINDOW_LEVELS);
+
+    OrderBook(const OrderBook&) = delete;
+    OrderBook& operator=(const OrderBook&) = delete;
+
+    // 订单能否入簿：价格为正且在 tick 上、订单号不在簿中；撮合前检查，避免成交后才发现挂不上
+    bool canRest(const Order& order) const;
+    // 挂单移入订单池并入簿，canRest() 不成立时返回 NULL_HANDLE
+    OrderHandle addOrder(Order&& order);
+    // 把挂单从所在价位摘除并归还订单池
+    void removeOrder(OrderHandle handle);
+    // 按订单号查找挂单，O(1)；不在簿中返回 NULL_HANDLE
+    OrderHandle findOrder(unsigned int orderId) const { return orderIndex.find(orderId); }
+    // 原地减少挂单数量，保留时间优先级
+    void reduceQuantity(OrderHandle handle, Quantity newQuantity);
+    // 挂单成交 quantity，同步扣减所在价位的剩余数量
+    void fillOrder(OrderHandle handle, Quantity quantity);
+
+    // 某用户在本订单簿的第一张挂单，没有时返回 NULL_HANDLE；用 nextUserOrder() 依次取其余挂单
+    OrderHandle firstUserOrder(unsigned long long userId) const { return userIndex.find(userId); }
+    OrderHandle nextUserOrder(OrderHandle handle) const { return pool.get(handle).userNext; }
+
+    Order& getOrder(OrderHandle handle) { return pool.get(handle).order; }
+    const Order& getOrder(OrderHandle handle) const { return pool.get(handle).order; }
+    OrderHandle nextInLevel(OrderHandle handle) const { return pool.get(handle).next; }
+
+    // 某一边的最优价位，空时返回 nullptr
+    PriceLevel* bestLevel(OrderSide side);
+
+    // 某一边价格不劣于 limitPrice 的剩余数量之和，累计到 needed 即停止；只读，供 FOK 预检
+    Quantity availableQuantity(OrderSide side, Price limitPrice, Quantity needed) const;
+
+    // 按价格从低到高、同价位按时间顺序遍历某一边的所有挂单
+    template <typename Fn>
+    void forEachOrder(OrderSide side, Fn&& fn) const {
+        const PriceLadder& ladder = side == OrderSide::BUY ? buyLadder : sellLadder;
+        ladder.forEachLevel([this, &fn](int64_t, const PriceLevel& level) {
+            for (OrderHandle handle = level.head; handle != NULL_HANDLE; handle = pool.get(handle).next) {
+                fn(pool.get(handle).order);
+            }
+        });
+    }
+
+    // 按撮合顺序（价格优先、时间优先）遍历某一边的挂单，回调返回 false 时停止
+    template <typename Fn>
+    void forEachBestOrderWhile(OrderSide side, Fn&& fn) const {
+        const PriceLadder& ladder = side == OrderSide::BUY ? buyLadder : sellLadder;
+        ladder.forEachBestLevelWhile([this, &fn](int64_t, const PriceLevel& level) {
+            for (OrderHandle handle = level.head; handle != NULL_HANDLE; handle = pool.get(handle).next) {
+                if (!fn(pool.get(handle).order)) {
+                    return false;
+                }
+            }
+            return true;
+        });
+    }
+
+    // 从最优价起遍历某一边至多 count 个价位，回调参数为价格和价位
+    template <typename Fn>
+    void forEachBestLevel(OrderSide side, size_t count, Fn&& fn) const {
+        const PriceLadder& ladder = side == OrderSide::BUY ? buyLadder : sellLadder;
+        ladder.forEachBestLevel(count, [this, &fn](int64_t tick, const PriceLevel& level) {
+            fn(tickToPrice(tick), level);
+        });
+    }
+
+    size_t orderCount() const { return pool.size(); }
+    Price getTickSize() const { return tickSize; }
+    Price tickToPrice(int64_t tick) const { return tick * tickSize; }
+
+    // 订单池、订单索引和价格阶梯累计的堆分配次数，稳态撮合下应保持不变
+    uint64_t allocationCount() const;
+
+private:
+    PriceLadder& ladderFor(OrderSide side) { return side == OrderSide::BUY ? buyLadder : sellLadder; }
+    PriceLevel* levelOf(const Order& order) { return ladderFor(order.orderSide).findLevel(order.price / tickSize); }
+    void linkUserOrder(OrderHandle handle);
+    void unlinkUserOrder(OrderHandle handle);
+
+    Price tickSize;
+    PriceLadder buyLadder;
+    PriceLadder sellLadder;
+    OrderPool pool;
+
+    // orderId -> 挂单句柄，随入簿、成交移除、撤单同步维护
+    OrderIndex orderIndex;
+    // userId -> 该用户挂单链表的头部，与 orderIndex 同步维护；不同用户数不超过挂单数，
+    // 按订单池容量预分配，稳态下不扩容
+    UserIndex userIndex;
+};
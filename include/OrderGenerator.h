@@ -2,15 +2,20 @@
 
 #include <random>
 #include <atomic>
+#include <vector>
 #include <zmq.hpp>
 #include "Order.h"
+#include "Instrument.h"
+#include "WireProtocol.h"
 #include "DbConnection.h"
 #include "Logger.h"
 
 class OrderGenerator {
 public:
 
-    OrderGenerator(DbConnection& dbConn, zmq::context_t& context, const std::string& orderServerAddress);
+    // reloadOpenOrders：启动时是否从数据库重新发送未完成订单；撮合引擎从自身日志恢复时应关闭
+    OrderGenerator(DbConnection& dbConn, zmq::context_t& context, const std::string& orderServerAddress, const std::vector<Instrument>& instruments,
+                   WireFormat wireFormat = WireFormat::BINARY, bool reloadOpenOrders = true);
     void generateOrders(int numOrders);
 
 private:
@@ -21,13 +26,14 @@ private:
     void writeOrderToDatabase(const Order& order);  // 新增方法
     void loadOrdersFromDatabase();
     unsigned int getMaxOrderId();
-    double roundToPrecision(double value, int precision);
 
     zmq::socket_t orderSocket;
     std::default_random_engine generator;
-    std::uniform_real_distribution<double> priceDistribution;
-    std::uniform_real_distribution<double> quantityDistribution;
-    std::uniform_real_distribution<double> feeRateDistribution;
+    std::vector<Instrument> instruments;
+    WireFormat wireFormat;
+    bool reloadOpenOrders;
+    std::uniform_int_distribution<size_t> instrumentDistribution;
+    std::uniform_int_distribution<FeeRate> feeRateDistribution;
     std::uniform_int_distribution<int> orderSideDistribution;
     std::uniform_int_distribution<int> orderTypeDistribution;
     static std::atomic<unsigned int> orderIdCounter;
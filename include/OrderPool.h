@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "Order.h"
+
+// 订单池句柄：节点在池中的下标，池扩容后依然有效
+using OrderHandle = uint32_t;
+constexpr OrderHandle NULL_HANDLE = UINT32_MAX;
+
+// 订单簿中的挂单节点，prev/next 直接内嵌在节点里（侵入式 FIFO 队列）
+// userPrev/userNext 把同一用户的挂单串成另一条链表，按用户撤单和防自成交不必扫描订单簿
+struct OrderNode {
+    Order order;
+    OrderHandle prev = NULL_HANDLE;
+    OrderHandle next = NULL_HANDLE;
+    OrderHandle userPrev = NULL_HANDLE;
+    OrderHandle userNext = NULL_HANDLE;
+};
+
+// 预分配的挂单节点池：空闲节点通过 next 串成 free list，稳态下入簿/出簿不触发堆分配
+class OrderPool {
+public:
+    explicit OrderPool(size_t capacity);
+
+    OrderHandle allocate(Order&& order);
+    void release(OrderHandle handle);
+
+    OrderNode& get(OrderHandle handle) { return nodes[handle]; }
+    const OrderNode& get(OrderHandle handle) const { return nodes[handle]; }
+
+    size_t size() const { return used; }
+    size_t capacity() const { return nodes.size(); }
+    // 池创建及扩容时的堆分配次数
+    uint64_t allocationCount() const { return allocations; }
+
+private:
+    void grow(size_t newCapacity);
+
+    std::vector<OrderNode> nodes;
+    OrderHandle freeHead;
+    size_t used;
+    uint64_t allocations;
+};
+
+// 键 -> 句柄的开放寻址哈希表（线性探测），按容量预分配，删除采用后移法不留墓碑
+template <typename Key>
+class HandleIndex {
+public:
+    explicit HandleIndex(size_t expectedEntries);
+
+    // 键已存在时不覆盖，返回 false
+    bool insert(Key key, OrderHandle handle);
+    // 键已存在时覆盖，否则插入
+    void assign(Key key, OrderHandle handle);
+    OrderHandle find(Key key) const;
+    void erase(Key key);
+
+    size_t size() const { return count; }
+    uint64_t allocationCount() const { return allocations; }
+
+private:
+    struct Slot {
+        Key key = 0;
+        OrderHandle handle = NULL_HANDLE;
+    };
+
+    size_t slotFor(Key key) const {
+        return static_cast<size_t>((key * 0x9E3779B97F4A7C15ULL) >> shift);
+    }
+    void rehash(size_t newSlotCount);
+
+    std::vector<Slot> slots;
+    size_t mask;
+    int shift;
+    size_t count;
+    uint64_t allocations;
+};
+
+// orderId -> 挂单句柄
+using OrderIndex = HandleIndex<unsigned int>;
+// userId -> 该用户链表头部挂单的句柄
+using UserIndex = HandleIndex<unsigned long long>;
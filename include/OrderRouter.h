@@ -0,0 +1,32 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <zmq.hpp>
+#include "Instrument.h"
+
+// 把交易对按轮询方式分配到 shardCount 个分片，返回每个分片负责的交易对
+std::vector<std::vector<Instrument>> assignInstrumentsToShards(const std::vector<Instrument>& instruments, size_t shardCount);
+
+// 路由阶段：从订单入口读取消息，按交易对原样转发到所属撮合分片，消息本身不拷贝
+// 不限交易对的按用户撤单例外，复制后发给每个分片
+class OrderRouter {
+public:
+    OrderRouter(zmq::socket_t& orderSocket, std::vector<zmq::socket_t>& shardSockets,
+                const std::vector<std::vector<Instrument>>& shards);
+
+    void run();
+    void stop();
+
+private:
+    void route(zmq::message_t& message);
+    std::string readSymbol(const zmq::message_t& message);
+    bool isCancelAll(const zmq::message_t& message);
+
+    zmq::socket_t& orderSocket;
+    std::vector<zmq::socket_t>& shardSockets;
+    std::unordered_map<std::string, size_t> symbolShards;   // 交易对 -> 分片下标
+    std::atomic<bool> running;
+};
@@ -3,17 +3,39 @@
 #include "Order.h"
 #include "Serialization.h"
 #include "TradeRecord.h"
+#include "WireProtocol.h"
 #include "DbConnection.h"
 #include "DbConnectionPool.h"
+#include "DbConfig.h"
+#include "BatchWriter.h"
+#include "ResultDispatcher.h"
 #include "Logger.h"
+#include "Metrics.h"
+#include <chrono>
+#include <fstream>
+#include <memory>
 #include <thread>
 #include <boost/asio.hpp>
-#include <mutex>
 #include <zmq.hpp>
 
+// 持久化各写库线程的运行指标，同一进程内共用
+struct PersistenceMetrics {
+    PersistenceMetrics();
+
+    Counter& messagesReceived;
+    Counter& batchesCommitted;
+    Counter& batchesFailed;
+    Counter& rowsDeadLettered;  // 被数据库拒绝、转入死信文件的行数
+    Histogram& queueLag;        // 撮合引擎产生事件到写库线程收到的时间
+    Histogram& batchSize;       // 每次提交包含的消息数
+    Histogram& commitLatency;
+};
+
 class PersistenceProgram {
 public:
-    PersistenceProgram(DbConnectionPool& connectionPool, zmq::context_t& context, const std::string& resultServerAddress);
+    // partition / partitionCount：本实例负责的订单分区，单实例时为 0 / 1
+    PersistenceProgram(DbConnectionPool& connectionPool, zmq::context_t& context, const std::string& resultServerAddress,
+                       const PersistenceConfig& persistenceConfig, size_t partition = 0, size_t partitionCount = 1);
     ~PersistenceProgram(); // Destructor to release connection
     void start();
     void stop();
@@ -22,12 +44,22 @@ public:
 private:
     void run();
     void reconnectResultClient();
+    void processJsonMessage(const zmq::message_t& resultMessage);
     void processMessage(const Json::Value& message);
+    void processBinaryMessage(const void* data, size_t size);
     void processUnmatchedOrderMessage(const Json::Value& message);
     void processTradeMessage(const Json::Value& message);
-    bool executeQuery(const std::string& query);
+    void persistTrade(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade);
+    void processOrderUpdateMessage(const Json::Value& message);
     void processOrder(const Order& order);
-    void processTradeRecord(const TradeRecord& trade);
+    void updateOrder(const Order& order);
+    // 提交当前批次：临时错误时重连并重试直到成功，数据错误时逐行提交，被拒绝的行转入死信文件
+    void flushBatch();
+    void deadLetter(const Order* order, const TradeRecord* trade, unsigned int error, const std::string& message);
+    // 连接可用或重连成功时返回 true
+    bool reconnectDatabase();
+    void recordQueueLag(Timestamp eventTime);
+    bool ownsOrder(uint32_t orderId) const { return persistencePartition(orderId, partitionCount) == partition; }
 
     DbConnectionPool& dbConnPool;
     DbConnection* dbConn; // Pointer to DbConnection
@@ -36,6 +68,12 @@ private:
     zmq::socket_t resultSocket;
     std::atomic<bool> running;
     std::thread workerThread;
-    std::mutex connMutex;
-    MYSQL* conn;
+    PersistenceConfig persistenceConfig;
+    size_t partition;
+    size_t partitionCount;
+    std::unique_ptr<BatchWriter> batchWriter;
+    size_t batchMessages;                                   // 当前批次已缓冲的消息数
+    std::chrono::steady_clock::time_point batchStart;       // 当前批次第一条消息的到达时间
+    std::ofstream deadLetters;                              // 首次有行被拒绝时打开
+    PersistenceMetrics metrics;
 };
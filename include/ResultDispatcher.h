@@ -0,0 +1,30 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+#include <zmq.hpp>
+
+// 订单所属的持久化分区，同一订单的所有更新都由同一个写库线程按序处理
+inline size_t persistencePartition(uint32_t orderId, size_t partitionCount) {
+    return orderId % partitionCount;
+}
+
+// 分发阶段：从撮合结果端口读取消息，按订单号转发到持久化分区
+// 成交消息同时涉及买卖两个订单，分别发往双方所在分区，由各分区只写自己的订单
+class ResultDispatcher {
+public:
+    ResultDispatcher(zmq::socket_t& resultSocket, std::vector<zmq::socket_t>& partitionSockets);
+
+    void run();
+    void stop();
+
+private:
+    void dispatch(zmq::message_t& message);
+    // 读取消息涉及的订单号，返回个数：成交消息为买卖双方两个，其余为一个
+    size_t readOrderIds(const zmq::message_t& message, uint32_t (&orderIds)[2]);
+
+    zmq::socket_t& resultSocket;
+    std::vector<zmq::socket_t>& partitionSockets;
+    std::atomic<bool> running;
+};
@@ -3,13 +3,14 @@
 #include <string>
 #include <chrono>
 #include "Order.h"
+#include "FixedPoint.h"
 #include "TradeRecord.h"
 #include "Logger.h"
 #include <json/json.h>
 
-// Helper functions for time serialization and deserialization
-std::string time_point_to_string(const std::chrono::time_point<std::chrono::system_clock>& tp);
-std::chrono::time_point<std::chrono::system_clock> string_to_time_point(const std::string& s);
+// 时间戳字段：ISO-8601 UTC 文本，纳秒精度；读写都不经过 strftime / istringstream
+Json::Value timestampToJson(Timestamp tp);
+Timestamp timestampFromJson(const Json::Value& value);
 
 // Enum to string conversion
 std::string orderSideToString(OrderSide side);
@@ -18,6 +19,9 @@ OrderSide stringToOrderSide(const std::string& str);
 std::string orderTypeToString(OrderType type);
 OrderType stringToOrderType(const std::string& str);
 
+std::string timeInForceToString(TimeInForce timeInForce);
+TimeInForce stringToTimeInForce(const std::string& str);
+
 std::string orderStatusToString(OrderStatus status);
 OrderStatus stringToOrderStatus(const std::string& str);
 
@@ -32,5 +36,9 @@ TradeRecord deserializeTradeRecord(const Json::Value& root);
 // 消息序列化
 std::string serializeMessage(const Json::Value& message);
 Json::Value deserializeMessage(const std::string& data);
+// 直接在接收缓冲区上解析，不拷贝成 std::string
+Json::Value deserializeMessage(const char* data, size_t size);
+// 解析内嵌在字符串字段里的 JSON（如 "order"），不拷贝字段内容
+Json::Value deserializeEmbeddedMessage(const Json::Value& field);
 
-double convertStringToDouble(const Json::Value& value, const std::string& key);
+int64_t convertStringToFixed(const Json::Value& value, const std::string& key, int decimals);
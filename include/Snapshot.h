@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "Order.h"
+#include "WireProtocol.h"
+
+// 订单簿快照：某个日志序号时刻的全部挂单，按价位内的时间优先顺序存放
+// 文件格式：SnapshotHeader + orderCount 个 WireOrder
+constexpr uint32_t SNAPSHOT_MAGIC = 0x4D45534E;     // "NSEM"
+constexpr uint16_t SNAPSHOT_VERSION = 3;        // 只接受当前版本
+
+struct BookSnapshot {
+    uint64_t sequence = 0;          // 快照包含的最后一条日志序号
+    uint64_t tradeSequence = 0;     // 该时刻已分配的最后一个成交序号
+    std::vector<Order> orders;
+};
+
+// 先写临时文件并刷盘再原子改名，写入中途崩溃不会破坏已有快照；返回时新快照已落盘
+void writeSnapshot(const std::string& path, uint64_t sequence, uint64_t tradeSequence, const std::vector<WireOrder>& orders);
+
+// 读取快照，文件不存在时返回 false；格式不合法时抛出 std::runtime_error
+bool readSnapshot(const std::string& path, BookSnapshot& snapshot);
+
+// 交给写快照线程的任务：撮合线程在日志切段时复制的挂单，以及快照落盘后可删除的旧日志段
+struct SnapshotJob {
+    std::string symbol;
+    std::string path;
+    uint64_t sequence = 0;
+    uint64_t tradeSequence = 0;
+    std::vector<WireOrder> orders;      // 任务在两个线程间交换，缓冲保留容量
+    std::string journalPath;
+    uint64_t journalSegment = 0;        // 复制时切换到的日志段，此前的段在快照落盘后删除
+    uint64_t flushes = 0;               // 复制时已产生的批末标记数
+};
+
+// 后台写快照：撮合线程只复制挂单，编码、写盘、刷盘和删除旧日志段都在这里完成
+// 同时至多一个任务；快照只覆盖结果已经发出的输入，等发布线程发完复制前的各批结果再写
+class SnapshotWriter {
+public:
+    // flushesSent 为发布线程已发出的批末标记数
+    explicit SnapshotWriter(const std::atomic<uint64_t>& flushesSent);
+    // 写完可以写的任务后退出；结果仍未发出的任务直接放弃，旧日志段保留，重启时照常回放
+    ~SnapshotWriter();
+
+    SnapshotWriter(const SnapshotWriter&) = delete;
+    SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+
+    bool busy() const { return pending; }
+    // 与写线程交换任务，调用方换回上一个任务的缓冲供下次复用；须在 busy() 为 false 时调用
+    void submit(SnapshotJob& job);
+    // 等待当前任务完成
+    void wait();
+
+private:
+    void run();
+    void write(SnapshotJob& job);
+
+    const std::atomic<uint64_t>& flushesSent;
+    std::mutex mutex;
+    std::condition_variable condition;
+    SnapshotJob job;
+    std::atomic<bool> pending;
+    bool stopping;
+    std::thread thread;
+};
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+constexpr size_t CACHE_LINE_SIZE = 64;
+
+// 单生产者单消费者环形队列，无锁
+// 槽位预先构造并循环复用：生产者 claim() 取得空槽原地填写后 push()，消费者 front() 读取后 pop()，
+// 元素内的 vector / string 等缓冲随槽位在两个线程间轮转，稳态下不再分配内存
+// 生产者和消费者各自的下标及其对对方下标的缓存放在独立的缓存行上，避免伪共享
+template <typename T>
+class SpscQueue {
+public:
+    explicit SpscQueue(size_t capacity) : slots(roundUpToPowerOfTwo(capacity)), mask(slots.size() - 1) {
+    }
+
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // 生产者：下一个可写的槽，队列满时返回 nullptr
+    T* claim() {
+        size_t tail = producer.index.load(std::memory_order_relaxed);
+        if (tail - producer.cachedOther == slots.size()) {
+            producer.cachedOther = consumer.index.load(std::memory_order_acquire);
+            if (tail - producer.cachedOther == slots.size()) {
+                return nullptr;
+            }
+        }
+        return &slots[tail & mask];
+    }
+
+    // 生产者：发布 claim() 取得的槽
+    void push() {
+        producer.index.store(producer.index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    // 消费者：队首元素，队列空时返回 nullptr
+    T* front() {
+        size_t head = consumer.index.load(std::memory_order_relaxed);
+        if (head == consumer.cachedOther) {
+            consumer.cachedOther = producer.index.load(std::memory_order_acquire);
+            if (head == consumer.cachedOther) {
+                return nullptr;
+            }
+        }
+        return &slots[head & mask];
+    }
+
+    // 消费者：释放 front() 返回的槽，之后该槽可被生产者复用
+    void pop() {
+        consumer.index.store(consumer.index.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    size_t capacity() const { return slots.size(); }
+
+private:
+    static size_t roundUpToPowerOfTwo(size_t value) {
+        size_t result = 1;
+        while (result < value) {
+            result <<= 1;
+        }
+        return result;
+    }
+
+    struct alignas(CACHE_LINE_SIZE) Cursor {
+        std::atomic<size_t> index{0};   // 本端的下标，只由本端写
+        size_t cachedOther = 0;         // 最近一次读到的对端下标，只由本端读写
+    };
+
+    std::vector<T> slots;
+    size_t mask;
+    Cursor producer;
+    Cursor consumer;
+};
+
+// 等待对端时的退避：先忙等，再让出 CPU，长时间空闲后短暂休眠，避免空闲分片占满核心
+class SpinWait {
+public:
+    void wait() {
+        if (spins < SPIN_LIMIT) {
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#endif
+        } else if (spins < YIELD_LIMIT) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(IDLE_SLEEP);
+            return;
+        }
+        ++spins;
+    }
+
+    void reset() { spins = 0; }
+
+private:
+    static constexpr unsigned SPIN_LIMIT = 1024;
+    static constexpr unsigned YIELD_LIMIT = SPIN_LIMIT + 64;
+    static constexpr std::chrono::microseconds IDLE_SLEEP{50};
+    unsigned spins = 0;
+};
@@ -0,0 +1,8 @@
+#pragma once
+
+// 把当前线程绑定到指定 CPU 核心，减少调度迁移带来的缓存失效
+// 仅 Linux 支持，其他平台返回 false
+bool pinCurrentThreadToCpu(int cpu);
+
+// 可用的硬件线程数，无法获取时返回 1
+int availableCpuCount();
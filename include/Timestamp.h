@@ -0,0 +1,33 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// 系统内部统一使用纳秒精度的 UTC 时间戳，底层就是自 epoch 起的 int64 纳秒数
+typedef std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds> Timestamp;
+
+inline int64_t toNanos(Timestamp tp) {
+    return tp.time_since_epoch().count();
+}
+
+inline Timestamp fromNanos(int64_t nanos) {
+    return Timestamp(std::chrono::nanoseconds(nanos));
+}
+
+inline Timestamp nowTimestamp() {
+    return std::chrono::time_point_cast<std::chrono::nanoseconds>(std::chrono::system_clock::now());
+}
+
+// ISO-8601 UTC 文本："2024-01-01T12:34:56.123456789Z"，固定 30 个字符
+constexpr size_t TIMESTAMP_TEXT_LENGTH = 30;
+
+// 写入 buffer（至少 TIMESTAMP_TEXT_LENGTH 字节，不补 '\0'），返回写入的长度；不分配内存
+// 日期部分按线程缓存，同一天内只需格式化时分秒和纳秒
+size_t formatTimestamp(Timestamp tp, char* buffer);
+std::string formatTimestamp(Timestamp tp);
+
+// 解析 "YYYY-MM-DD[T| ]HH:MM:SS[.f{1,9}][Z]"，一律按 UTC 处理；格式不合法时抛出 std::invalid_argument
+Timestamp parseTimestamp(const char* text, size_t length);
+Timestamp parseTimestamp(const std::string& text);
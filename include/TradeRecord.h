@@ -2,18 +2,20 @@
 
 #include <string>
 #include <chrono>
+#include "FixedPoint.h"
+#include "Timestamp.h"
 
 
 struct TradeRecord {
-    unsigned int tradeId;
+    uint64_t tradeId;                   // 交易对编号 + 成交序号，见 makeTradeId
     unsigned long long buyerUserId;
     unsigned long long sellerUserId;
     unsigned int buyerOrderId;
     unsigned int sellerOrderId;
     std::string orderType;
-    double tradePrice;
-    double tradeQuantity;
-    double buyerFee;
-    double sellerFee;
-    std::chrono::time_point<std::chrono::system_clock> tradeTime;
+    Price tradePrice;
+    Quantity tradeQuantity;
+    Amount buyerFee;          // 定点金额，AMOUNT_DECIMALS 位小数
+    Amount sellerFee;
+    Timestamp tradeTime;
 };
\ No newline at end of file
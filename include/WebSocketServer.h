@@ -3,35 +3,112 @@
 #include <websocketpp/config/asio_no_tls.hpp>
 #include <websocketpp/server.hpp>
 #include <zmq.hpp>
+#include <atomic>
+#include <deque>
+#include <map>
+#include <memory>
 #include <set>
 #include <mutex>
 #include <thread>
 #include <string>
+#include "DepthFeed.h"
+#include "GatewayConfig.h"
+#include "Kline.h"
+#include "Metrics.h"
 
 typedef websocketpp::server<websocketpp::config::asio> server;
 
+// 一条推送：只序列化、组帧一次，所有订阅者的队列和连接共享同一份
+struct Publication {
+    enum class Kind { DEPTH_SNAPSHOT, DEPTH_DELTA, TRADES, KLINE, CONTROL };
+
+    Kind kind;
+    std::string key;        // 订阅键，如 "depth:BTC_USDT:20"、"trades:BTC_USDT"、"kline:BTC_USDT:1m"
+    std::string payload;
+    mutable server::message_ptr frame;      // 组好帧头的消息，首次写出时创建，只在持有 m_connection_lock 时访问
+};
+
+typedef std::shared_ptr<const Publication> PublicationPtr;
+
+// 单个连接的订阅与待发送队列
+struct ClientSession {
+    std::set<std::string> subscriptions;
+    std::deque<PublicationPtr> queue;
+    std::set<std::string> resyncKeys;       // 增量被丢弃、待队列排空后补发快照的深度订阅
+    uint64_t droppedMessages = 0;
+    bool sharedFrames = true;               // hybi00 旧客户端的帧格式不同，逐连接组帧
+};
+
+// 行情网关的运行指标
+struct GatewayMetrics {
+    GatewayMetrics();
+
+    Counter& framesSent;
+    Counter& framesDropped;     // 慢连接队列满时丢弃或合并掉的推送
+    Histogram& fanOutLatency;   // 一条上游行情放进所有订阅者队列的耗时
+};
+
+// 行情网关：客户端按频道、交易对和档数订阅，ZeroMQ 接收线程只把推送放进各连接的有界队列，
+// 由 asio 线程按连接的发送缓冲水位写出，慢客户端只会丢掉或合并自己的消息，不会拖慢其他连接
+//
+// 客户端消息：{"op": "subscribe" | "unsubscribe", "channel": "depth" | "trades" | "kline", "symbol", "depth", "interval"}
 class WebSocketServer {
 public:
-    WebSocketServer(const std::string& host, int port, zmq::context_t& context, const std::string& bookServerAddress);
+    WebSocketServer(const std::string& host, int port, zmq::context_t& context, const std::string& bookServerAddress,
+                    const GatewayConfig& gatewayConfig);
     ~WebSocketServer();
     void start();
     void stop();
-    void send_to_all(const std::string& message);
 
 private:
     void receive_order_book();
+    void handle_depth(const std::string& symbol, const zmq::message_t& message);
+    void handle_trades(const std::string& symbol, const zmq::message_t& message);
     void on_open(websocketpp::connection_hdl hdl);
     void on_close(websocketpp::connection_hdl hdl);
     void on_message(websocketpp::connection_hdl hdl, server::message_ptr msg);
 
+    void subscribe(websocketpp::connection_hdl hdl, const std::string& channel, const std::string& symbol,
+                   size_t depth, const std::string& interval);
+    void unsubscribe(websocketpp::connection_hdl hdl, const std::string& key);
+    void reject(websocketpp::connection_hdl hdl, const std::string& error);
+    DepthPublisher& depth_view(const std::string& symbol, size_t depth);
+
+    void fan_out(const std::vector<PublicationPtr>& publications);
+
+    // 以下函数要求调用方持有 m_connection_lock
+    void publish(const PublicationPtr& publication);
+    void enqueue(ClientSession& session, const PublicationPtr& publication);
+    void shed(ClientSession& session);
+
+    void schedule_flush();
+    void flush();
+    void resync(const std::vector<std::pair<websocketpp::connection_hdl, std::string>>& pending);
+
+    typedef std::map<websocketpp::connection_hdl, ClientSession, std::owner_less<websocketpp::connection_hdl>> SessionMap;
+    typedef std::set<websocketpp::connection_hdl, std::owner_less<websocketpp::connection_hdl>> ConnectionSet;
+
     server m_server;
     zmq::socket_t bookSocket;
-    std::set<websocketpp::connection_hdl, std::owner_less<websocketpp::connection_hdl>> m_connections;
+    GatewayConfig config_;
+
+    // 锁顺序：orderBookMutex_ / klineMutex_ 在前，m_connection_lock 在后
     std::mutex m_connection_lock;
+    SessionMap sessions_;
+    std::map<std::string, ConnectionSet> subscribers_;  // 订阅键 -> 连接
+    std::atomic<bool> flushScheduled_;
+    bool retryScheduled_;                               // 只在 asio 线程中访问
+
     std::mutex orderBookMutex_;
+    std::map<std::string, DepthBook> orderBooks_;       // 各交易对上游发布的前 N 档
+    std::map<std::string, std::map<size_t, DepthPublisher>> depthViews_;    // 按订阅档数裁剪的视图，各自编号
+    std::mutex klineMutex_;
+    KlineAggregator klines_;                            // 由成交流水聚合出的各周期 K 线
+
+    GatewayMetrics metrics_;
+
     std::thread receiveThread_;
     bool running_;
-    std::string latestOrderBook_;
     std::string host_;
     int port_;
-};
\ No newline at end of file
+};
@@ -0,0 +1,281 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <zmq.hpp>
+#include "Order.h"
+#include "TradeRecord.h"
+#include "Instrument.h"
+
+// 二进制消息协议：固定头 + 紧凑定长结构体，字段按小端序直接内存布局
+// 接收端根据头部 magic 自动区分二进制与 JSON，JSON 仅作为调试模式保留
+enum class WireFormat {
+    JSON,
+    BINARY
+};
+
+WireFormat stringToWireFormat(const std::string& str);
+
+constexpr uint16_t WIRE_MAGIC = 0x4D45;      // "EM"
+constexpr uint8_t WIRE_VERSION = 5;       // 收发双方版本须一致
+
+enum class WireMessageType : uint8_t {
+    NEW_ORDER = 1,
+    CANCEL = 2,
+    AMEND = 3,
+    BOOK_SNAPSHOT_REQUEST = 4,
+    CANCEL_ALL = 5,             // 撤销某用户的全部挂单，交易对为空时撤销所有交易对
+    MASS_ORDER = 6,             // 同一用户、同一交易对的一组下单 / 撤单 / 改单，撮合引擎作为一个整体处理
+    TRADE = 10,
+    UNMATCHED_ORDER = 11,
+    CANCELED = 12,
+    AMENDED = 13,
+    CANCEL_REJECTED = 14,
+    AMEND_REJECTED = 15,
+    EXPIRED = 16,               // 市价、IOC、FOK、只挂单订单未能挂入订单簿的部分被撤销
+    ORDER_REJECTED = 17,        // 新订单未进入撮合（如订单号与簿中挂单重复），同号挂单不受影响
+    BOOK_SNAPSHOT = 20,
+    BOOK_DELTA = 21,
+    TRADE_PRINTS = 22
+};
+
+std::string wireMessageTypeToString(WireMessageType type);
+
+#pragma pack(push, 1)
+
+struct WireHeader {
+    uint16_t magic;
+    uint8_t version;
+    uint8_t type;           // WireMessageType
+    uint32_t length;        // 头部之后的负载字节数
+};
+
+struct WireOrder {
+    uint32_t orderId;
+    uint64_t userId;
+    char symbol[MAX_SYMBOL_LENGTH + 1];     // 以 '\0' 结尾
+    int64_t price;
+    int64_t quantity;
+    int64_t feeRate;
+    int64_t filledQuantity;
+    int64_t createTime;     // 纳秒，自 epoch 起
+    int64_t updateTime;
+    uint8_t orderSide;
+    uint8_t orderType;
+    uint8_t status;
+    uint8_t timeInForce;
+};
+
+struct WireTrade {
+    uint64_t tradeId;
+    uint64_t buyerUserId;
+    uint64_t sellerUserId;
+    uint32_t buyerOrderId;
+    uint32_t sellerOrderId;
+    uint8_t takerSide;      // TradeRecord::orderType
+    int64_t tradePrice;
+    int64_t tradeQuantity;
+    int64_t buyerFee;
+    int64_t sellerFee;
+    int64_t tradeTime;
+};
+
+// NEW_ORDER / UNMATCHED_ORDER / CANCELED / EXPIRED / AMENDED
+struct OrderWireMessage {
+    WireHeader header;
+    WireOrder order;
+};
+
+struct CancelWireMessage {
+    WireHeader header;
+    char symbol[MAX_SYMBOL_LENGTH + 1];
+    uint32_t orderId;
+};
+
+// 交易对为空表示所有交易对，由路由转发给每个分片
+struct CancelAllWireMessage {
+    WireHeader header;
+    char symbol[MAX_SYMBOL_LENGTH + 1];
+    uint64_t userId;
+};
+
+// MASS_ORDER 消息：头部 + WireMassOrderHeader + count 条 WireMassInstruction
+struct WireMassOrderHeader {
+    char symbol[MAX_SYMBOL_LENGTH + 1];
+    uint64_t userId;
+    int64_t createTime;     // 纳秒，各条新订单共用
+    uint16_t count;
+};
+
+struct WireMassInstruction {
+    uint8_t action;         // MassAction
+    uint8_t orderSide;      // 以下三项只用于 NEW
+    uint8_t orderType;
+    uint8_t timeInForce;
+    uint32_t orderId;
+    int64_t price;          // AMEND 时 price / quantity 为 0 表示沿用原值
+    int64_t quantity;
+    int64_t feeRate;
+};
+
+// price / quantity 为 0 表示沿用原值
+struct AmendWireMessage {
+    WireHeader header;
+    char symbol[MAX_SYMBOL_LENGTH + 1];
+    uint32_t orderId;
+    int64_t price;
+    int64_t quantity;
+};
+
+struct TradeWireMessage {
+    WireHeader header;
+    WireOrder buyOrder;
+    WireOrder sellOrder;
+    WireTrade trade;
+};
+
+// 请求撮合引擎在下一次行情发布时发送该交易对的全量快照
+struct BookSnapshotRequestWireMessage {
+    WireHeader header;
+    char symbol[MAX_SYMBOL_LENGTH + 1];
+};
+
+// CANCEL_REJECTED / AMEND_REJECTED / ORDER_REJECTED
+struct RejectWireMessage {
+    WireHeader header;
+    uint32_t orderId;
+    char reason[64];        // 以 '\0' 结尾，超长截断
+};
+
+// BOOK_SNAPSHOT / BOOK_DELTA 消息：头部 + WireDepthHeader + bidCount 个买价位 + askCount 个卖价位
+// 交易对放在 PUB 的主题帧里；增量中数量为 0 表示该价位已移出前 N 档
+struct WireDepthHeader {
+    uint64_t sequence;      // 每个交易对独立递增，快照与增量共用
+    uint16_t bidCount;
+    uint16_t askCount;
+};
+
+struct WireDepthLevel {
+    int64_t price;
+    int64_t quantity;
+};
+
+// TRADE_PRINTS 消息：头部 + uint32 条数 + 若干 WireTradePrint，公开成交流水，不含用户和手续费
+// 交易对放在 PUB 的主题帧里，一批撮合产生的成交合并成一条消息
+struct WireTradePrint {
+    uint64_t tradeId;
+    uint8_t takerSide;
+    int64_t price;
+    int64_t quantity;
+    int64_t tradeTime;      // 纳秒，自 epoch 起
+};
+
+#pragma pack(pop)
+
+// 单个价位的聚合数量
+struct DepthLevel {
+    Price price;
+    Quantity quantity;
+};
+
+// 一条 L2 行情：快照为前 N 档全量，增量只含变化的价位；价位按从优到劣排列
+struct DepthUpdate {
+    bool snapshot = false;
+    uint64_t sequence = 0;
+    std::vector<DepthLevel> bids;
+    std::vector<DepthLevel> asks;
+};
+
+// 一笔公开成交
+struct TradePrint {
+    uint64_t tradeId;
+    OrderSide takerSide;
+    Price price;
+    Quantity quantity;
+    Timestamp tradeTime;
+};
+
+enum class MassAction : uint8_t {
+    NEW,
+    CANCEL,
+    AMEND
+};
+
+// 一条批量指令；交易对、用户和下单时间取自所在的 MASS_ORDER 消息
+struct MassInstruction {
+    MassAction action;
+    OrderSide orderSide;
+    OrderType orderType;
+    TimeInForce timeInForce;
+    unsigned int orderId;
+    Price price;
+    Quantity quantity;
+    FeeRate feeRate;
+};
+
+// 单条 MASS_ORDER 消息最多携带的指令数
+constexpr size_t MAX_MASS_ORDER_INSTRUCTIONS = 1000;
+
+struct BookEntry {
+    OrderSide side;
+    Price price;
+    Quantity quantity;
+};
+
+bool isBinaryMessage(const void* data, size_t size);
+// 校验 magic / version / 长度，返回消息类型；格式不合法时抛出 std::runtime_error
+WireMessageType readWireHeader(const void* data, size_t size);
+// 读取 NEW_ORDER / CANCEL / CANCEL_ALL / MASS_ORDER / AMEND / BOOK_SNAPSHOT_REQUEST 消息的交易对，供路由使用，不解码其余字段
+std::string readWireSymbol(const void* data, size_t size);
+
+WireOrder toWireOrder(const Order& order);
+Order fromWireOrder(const WireOrder& wire);
+WireTrade toWireTrade(const TradeRecord& trade);
+TradeRecord fromWireTrade(const WireTrade& wire);
+
+OrderWireMessage encodeOrderMessage(WireMessageType type, const Order& order);
+CancelWireMessage encodeCancelMessage(const std::string& symbol, uint32_t orderId);
+CancelAllWireMessage encodeCancelAllMessage(const std::string& symbol, uint64_t userId);
+AmendWireMessage encodeAmendMessage(const std::string& symbol, uint32_t orderId, Price price, Quantity quantity);
+TradeWireMessage encodeTradeMessage(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade);
+BookSnapshotRequestWireMessage encodeBookSnapshotRequest(const std::string& symbol);
+RejectWireMessage encodeRejectMessage(WireMessageType type, uint32_t orderId, const std::string& reason);
+// common 提供交易对、用户和下单时间
+std::string encodeMassOrderMessage(const Order& common, const std::vector<MassInstruction>& instructions);
+std::string encodeDepthMessage(const DepthUpdate& update);
+std::string encodeTradePrintsMessage(const std::vector<TradePrint>& trades);
+
+// 从消息缓冲区按类型取出定长结构体（memcpy，不要求对齐）
+template <typename T>
+T decodeWireMessage(const void* data, size_t size) {
+    readWireHeader(data, size);
+    if (size != sizeof(T)) {
+        throw std::runtime_error("Wire message size mismatch");
+    }
+    T message;
+    std::memcpy(&message, data, sizeof(T));
+    return message;
+}
+
+// 解到调用方复用的 common / instructions 中，instructions 保留容量；指令数超过上限时抛出 std::runtime_error
+void decodeMassOrderMessage(const void* data, size_t size, Order& common, std::vector<MassInstruction>& instructions);
+DepthUpdate decodeDepthMessage(const void* data, size_t size);
+std::vector<TradePrint> decodeTradePrintsMessage(const void* data, size_t size);
+
+// 直接在 ZeroMQ 消息缓冲区里构造定长消息，不经过中间缓冲区
+template <typename T, typename Encode>
+zmq::message_t encodeToZmqMessage(Encode&& encode) {
+    zmq::message_t message(sizeof(T));
+    ::new (message.data()) T(encode());
+    return message;
+}
+
+// 把已编码的缓冲区所有权转交给 ZeroMQ，发送完成后由 ZeroMQ 释放，内容不再拷贝
+zmq::message_t toZmqMessage(std::string&& data);
+
+// 订单簿的文本表格，供健康检查页面和行情推送展示
+std::string formatBookTable(const std::string& symbol, const std::vector<BookEntry>& entries);
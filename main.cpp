@@ -1,4 +1,10 @@
 #include <thread>
+#include <memory>
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <functional>
+#include <vector>
 #include <zmq.hpp>
 #include <iostream>
 #include <fstream>
@@ -8,10 +14,19 @@
 #include "PersistenceProgram.h"
 #include "HealthCheckServer.h"
 #include "DbConfig.h"
+#include "Instrument.h"
+#include "EngineConfig.h"
+#include "OrderRouter.h"
+#include "ResultDispatcher.h"
+#include "ThreadAffinity.h"
 #include "DbConnection.h"
 #include "DbConnectionPool.h"
 #include "Logger.h"
 #include "WebSocketServer.h"
+#include "GatewayConfig.h"
+#include "MetricsServer.h"
+#include "LoadGenerator.h"
+#include "OpenOrders.h"
 
 
 // 全局日志输出流
@@ -20,7 +35,31 @@ namespace {
     std::mutex logMutex;
 }
 
-void startMessageQueueServersAndMatchingEngine() {
+// 从数据库流式读取本分片交易对的未完成订单，直接放入订单簿；各分片用各自的连接并行加载
+void restoreOpenOrders(const DbConfig& dbConfig, const std::vector<Instrument>& instruments, MatchingEngine& matchingEngine) {
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::string> symbols;
+    for (const Instrument& instrument : instruments) {
+        symbols.push_back(instrument.symbol);
+    }
+    DbConnection dbConn(dbConfig);
+    if (dbConn.getConnection() == nullptr) {
+        throw std::runtime_error("Failed to connect to database to restore open orders");
+    }
+    size_t restored = 0;
+    size_t loaded = loadOpenOrders(dbConn, symbols, [&matchingEngine, &restored](Order& order) {
+        restored += matchingEngine.restoreOrder(order);
+    });
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Restored " + std::to_string(restored) + " of " + std::to_string(loaded) + " open orders from database in " +
+             std::to_string(duration) + " ms.");
+}
+
+void startMessageQueueServersAndMatchingEngine(const std::vector<Instrument>& instruments, const EngineConfig& engineConfig,
+                                                const MetricsConfig& metricsConfig, const DbConfig& dbConfig) {
+    MetricsServer metricsServer(metricsConfig.host, metricsConfig.matchPort);
+    metricsServer.start();
+
     // 创建消息队列
     zmq::context_t context(1);
     zmq::socket_t orderSocket(context, zmq::socket_type::pull);
@@ -29,37 +68,124 @@ void startMessageQueueServersAndMatchingEngine() {
     zmq::socket_t resultSocket(context, zmq::socket_type::push);
     resultSocket.bind("tcp://*:12346");
 
-    zmq::socket_t bookSocket(context, zmq::socket_type::pub);
+    zmq::socket_t bookSocket(context, zmq::socket_type::xpub);
     bookSocket.bind("tcp://*:12347");
 
-    // 启动撮合引擎
-    MatchingEngine matchingEngine(orderSocket, resultSocket, bookSocket);
-    std::thread matchingEngineThread([&matchingEngine]() {
+    // 各分片的结果和订单簿先汇总到进程内端点，再由转发线程送到对外端口
+    zmq::socket_t resultCollector(context, zmq::socket_type::pull);
+    resultCollector.bind("inproc://results");
+    zmq::socket_t bookCollector(context, zmq::socket_type::xsub);
+    bookCollector.bind("inproc://book");
+    // 上下文关闭时 proxy 以 ETERM 退出
+    auto runProxy = [](zmq::socket_t& frontend, zmq::socket_t& backend) {
         try {
-            matchingEngine.start();
-        } catch (const std::exception& e) {
-            LOG_WARN("Error in MatchingEngine: " + std::string(e.what()));
+            zmq::proxy(frontend, backend);
+        } catch (const zmq::error_t& e) {
+            LOG_INFO("Proxy stopped: " + std::string(e.what()));
         }
-    });
+    };
+    std::thread resultProxyThread(runProxy, std::ref(resultCollector), std::ref(resultSocket));
+    std::thread bookProxyThread(runProxy, std::ref(bookCollector), std::ref(bookSocket));
+
+    // 每个分片一个线程，负责一组互不重叠的交易对
+    size_t shardCount = engineConfig.shardCount > 0
+            ? engineConfig.shardCount
+            : std::min(instruments.size(), static_cast<size_t>(availableCpuCount()));
+    std::vector<std::vector<Instrument>> shards = assignInstrumentsToShards(instruments, shardCount);
+    std::vector<zmq::socket_t> shardSockets;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shardSockets.emplace_back(context, zmq::socket_type::push);
+        shardSockets.back().bind("inproc://shard-" + std::to_string(i));
+    }
+
+    // 路由阶段在当前线程运行
+    OrderRouter router(orderSocket, shardSockets, shards);
+    std::atomic<bool> shardFailed(false);
+
+    std::vector<std::thread> shardThreads;
+    for (size_t i = 0; i < shards.size(); ++i) {
+        shardThreads.emplace_back([&context, &shards, &engineConfig, &dbConfig, &router, &shardFailed, i]() {
+            // CPU 0 留给路由和 ZeroMQ I/O 线程；各阶段也绑核时每个分片占连续的三个核心
+            PipelineCpus cpus;
+            if (engineConfig.pinThreads) {
+                int cpuCount = availableCpuCount();
+                int stride = engineConfig.pinPipelineStages ? 3 : 1;
+                int base = static_cast<int>(i) * stride + 1;
+                cpus.matcher = base % cpuCount;
+                if (engineConfig.pinPipelineStages) {
+                    cpus.decoder = (base + 1) % cpuCount;
+                    cpus.publisher = (base + 2) % cpuCount;
+                }
+            }
+            try {
+                zmq::socket_t shardOrderSocket(context, zmq::socket_type::pull);
+                shardOrderSocket.connect("inproc://shard-" + std::to_string(i));
+                zmq::socket_t shardResultSocket(context, zmq::socket_type::push);
+                shardResultSocket.connect("inproc://results");
+                zmq::socket_t shardBookSocket(context, zmq::socket_type::pub);
+                shardBookSocket.connect("inproc://book");
+
+                // 启动撮合引擎
+                MatchingEngine matchingEngine(shardOrderSocket, shardResultSocket, shardBookSocket, shards[i], engineConfig, cpus);
+                if (engineConfig.loadOpenOrdersFromDatabase) {
+                    restoreOpenOrders(dbConfig, shards[i], matchingEngine);
+                }
+                matchingEngine.start();
+            } catch (const std::exception& e) {
+                // 分片退出后路由仍会把它的交易对的订单推给无人读取的套接字，订单悄无声息地丢失，只能整个进程退出
+                LOG_ERROR("MatchingEngine shard " + std::to_string(i) + " failed: " + std::string(e.what()));
+                shardFailed = true;
+                router.stop();
+                // 让阻塞在 recv 上的路由和转发线程返回
+                context.shutdown();
+            }
+        });
+    }
+
+    router.run();
+    if (shardFailed) {
+        // 其余分片的收发随上下文关闭而失败，无法再有序停止；日志已落盘、快照先写临时文件再改名，直接退出
+        LOG_ERROR("Exiting because a matching engine shard failed.");
+        Logger::getInstance().flush();
+        std::_Exit(EXIT_FAILURE);
+    }
 
     // 等待撮合引擎线程结束
-    matchingEngineThread.join();
+    for (auto& thread : shardThreads) {
+        thread.join();
+    }
+    resultProxyThread.join();
+    bookProxyThread.join();
 }
 
-void startPersistenceProgram(const DbConfig& config) {
+void startPersistenceProgram(const DbConfig& config, const PersistenceConfig& persistenceConfig, const MetricsConfig& metricsConfig) {
+    MetricsServer metricsServer(metricsConfig.host, metricsConfig.persistencePort);
+    metricsServer.start();
+
     // 创建 ZeroMQ 上下文
     zmq::context_t context(1);
     std::vector<std::thread> threads;
 
-    // 创建数据库连接池，假设连接池大小为 8
-    DbConnectionPool connectionPool(config, 8);
+    // 每个写库线程独占连接池中的一个连接
+    size_t workerCount = persistenceConfig.workerCount;
+    DbConnectionPool connectionPool(config, workerCount);
+
+    // 结果消息按订单号分区，同一订单的更新始终由同一线程按序写入
+    zmq::socket_t resultSocket(context, zmq::socket_type::pull);
+    resultSocket.connect("tcp://localhost:12346");
+    std::vector<zmq::socket_t> partitionSockets;
+    for (size_t i = 0; i < workerCount; ++i) {
+        partitionSockets.emplace_back(context, zmq::socket_type::push);
+        partitionSockets.back().bind("inproc://persist-" + std::to_string(i));
+    }
 
     // 启动多个线程来处理消息
-    for (int i = 0; i < 1; ++i) { // 使用 8 个线程处理
-        threads.emplace_back([&]() {
+    for (size_t i = 0; i < workerCount; ++i) {
+        threads.emplace_back([&, i]() {
             try {
                 // 创建持久化程序实例，直接使用连接池
-                PersistenceProgram persistenceProgram(connectionPool, context, "tcp://localhost:12346");
+                PersistenceProgram persistenceProgram(connectionPool, context, "inproc://persist-" + std::to_string(i),
+                                                      persistenceConfig, i, workerCount);
                 persistenceProgram.start();
 
                 // 持续运行持久化程序
@@ -74,6 +200,10 @@ void startPersistenceProgram(const DbConfig& config) {
         });
     }
 
+    // 分发阶段在当前线程运行
+    ResultDispatcher dispatcher(resultSocket, partitionSockets);
+    dispatcher.run();
+
     // 等待所有线程完成
     for (auto& thread : threads) {
         if (thread.joinable()) {
@@ -83,18 +213,32 @@ void startPersistenceProgram(const DbConfig& config) {
 }
 
 
-void startOrderGenerator(const DbConfig& config) {
+void startOrderGenerator(const DbConfig& config, const std::vector<Instrument>& instruments, const EngineConfig& engineConfig) {
     DbConnection dbConn(config);
 
     // 创建 ZeroMQ 上下文
     zmq::context_t context(1);
 
-    // 启动订单生成器
-    OrderGenerator orderGenerator(dbConn, context, "tcp://localhost:12345");
+    // 启动订单生成器；撮合引擎记日志或直接从数据库加载挂单时由引擎自行恢复订单簿，不再从数据库重发挂单
+    OrderGenerator orderGenerator(dbConn, context, "tcp://localhost:12345", instruments, engineConfig.wireFormat,
+                                  engineConfig.journalDir.empty() && !engineConfig.loadOpenOrdersFromDatabase);
     orderGenerator.generateOrders(100);
 }
 
-// 启动健康检查服务器
+// 压测：按 "load" 节配置的速率持续发单，可选写库和统计往返延迟
+void startLoadGenerator(const DbConfig& config, const std::vector<Instrument>& instruments, const EngineConfig& engineConfig) {
+    LoadConfig loadConfig = readLoadConfig("config.json");
+    std::unique_ptr<DbConnectionPool> connectionPool;
+    if (loadConfig.writeToDatabase) {
+        connectionPool = std::make_unique<DbConnectionPool>(config, loadConfig.producerThreads);
+    }
+
+    zmq::context_t context(1);
+    LoadGenerator loadGenerator(context, "tcp://localhost:12345", instruments, engineConfig.wireFormat, loadConfig, connectionPool.get());
+    loadGenerator.run();
+}
+
+// 启动健康检查服务器，本进程的指标也在其 /metrics 上导出
 void startHeal() {
     zmq::context_t context(1);
     HealthCheckServer server("localhost", 8080, context, "tcp://localhost:12347");
@@ -102,9 +246,12 @@ void startHeal() {
 }
 
 // Kline行情服务
-void start_websocket_server() {
+void start_websocket_server(const MetricsConfig& metricsConfig) {
+    MetricsServer metricsServer(metricsConfig.host, metricsConfig.gatewayPort);
+    metricsServer.start();
+
     zmq::context_t context(1);
-    WebSocketServer wsServer("localhost", 9001, context, "tcp://localhost:12347");
+    WebSocketServer wsServer("localhost", 9001, context, "tcp://localhost:12347", readGatewayConfig("config.json"));
     wsServer.start();
 }
 
@@ -112,7 +259,7 @@ void start_websocket_server() {
 int main(int argc, char* argv[]) {
     if (argc < 2) {
         std::cerr << "Usage: " << argv[0] << " <component> <log_file>" << std::endl;
-        std::cerr << "Components: message_queue_servers, persistence_program, order_generator, matching_engine, health_check_server" << std::endl;
+        std::cerr << "Components: match, persis, order, load, heal, kline" << std::endl;
         return 1;
     }
 
@@ -130,17 +277,20 @@ int main(int argc, char* argv[]) {
     try {
         // 读取数据库配置
         DbConfig config = readConfig("config.json");
+        std::vector<Instrument> instruments = readInstruments("config.json");
 
         if (component == "match") {
-            startMessageQueueServersAndMatchingEngine();
+            startMessageQueueServersAndMatchingEngine(instruments, readEngineConfig("config.json"), readMetricsConfig("config.json"), config);
         } else if (component == "persis") {
-            startPersistenceProgram(config);
+            startPersistenceProgram(config, readPersistenceConfig("config.json"), readMetricsConfig("config.json"));
         } else if (component == "order") {
-            startOrderGenerator(config);
+            startOrderGenerator(config, instruments, readEngineConfig("config.json"));
+        } else if (component == "load") {
+            startLoadGenerator(config, instruments, readEngineConfig("config.json"));
         } else if (component == "heal") {
             startHeal();
         } else if (component == "kline") {
-            start_websocket_server();
+            start_websocket_server(readMetricsConfig("config.json"));
         } else {
             std::cerr << "Unknown component: " << component << std::endl;
             return 1;
@@ -0,0 +1,345 @@
+#include "BatchWriter.h"
+#include "Serialization.h"
+#include "Logger.h"
+#include <errmsg.h>
+#include <mysqld_error.h>
+#include <algorithm>
+
+namespace {
+    constexpr size_t ORDER_COLUMNS = 12;
+    constexpr size_t TRADE_COLUMNS = 10;
+
+    // 撤单状态由撮合引擎给出，其余状态按成交数量推导
+    std::string persistedStatus(const Order& order) {
+        if (order.status == OrderStatus::CANCELED || order.status == OrderStatus::PARTIALLY_FILLED_CANCELED) {
+            return orderStatusToString(order.status);
+        }
+        if (order.filledQuantity >= order.quantity) {
+            return "FULLY_FILLED";
+        }
+        return order.filledQuantity > 0 ? "PARTIALLY_FILLED" : "MATCHING";
+    }
+
+    // TIMESTAMP(6) 文本 "YYYY-MM-DD HH:MM:SS.ffffff"，截断到微秒；会话时区为 UTC
+    std::string databaseTimestamp(Timestamp tp) {
+        char buffer[TIMESTAMP_TEXT_LENGTH];
+        formatTimestamp(tp, buffer);
+        buffer[10] = ' ';
+        return std::string(buffer, 26);
+    }
+
+    std::string placeholders(size_t rows, size_t columns) {
+        std::string row = "(";
+        for (size_t i = 0; i < columns; ++i) {
+            row += i == 0 ? "?" : ",?";
+        }
+        row += ")";
+
+        std::string sql;
+        sql.reserve(rows * (row.size() + 1));
+        for (size_t i = 0; i < rows; ++i) {
+            if (i > 0) {
+                sql += ",";
+            }
+            sql += row;
+        }
+        return sql;
+    }
+
+    // 不超过 n 的最大 2 的幂
+    size_t chunkSize(size_t n) {
+        size_t chunk = 1;
+        while (chunk * 2 <= n) {
+            chunk *= 2;
+        }
+        return chunk;
+    }
+}
+
+void BatchWriter::Params::reset(size_t count) {
+    ints.clear();
+    texts.clear();
+    isText.clear();
+    ints.reserve(count);
+    texts.reserve(count);
+    isText.reserve(count);
+}
+
+void BatchWriter::Params::addInt(unsigned long long value) {
+    ints.push_back(value);
+    isText.push_back(false);
+}
+
+void BatchWriter::Params::addText(std::string value) {
+    texts.push_back(std::move(value));
+    isText.push_back(true);
+}
+
+std::vector<MYSQL_BIND>& BatchWriter::Params::bind() {
+    binds.assign(isText.size(), MYSQL_BIND{});
+    lengths.assign(isText.size(), 0);
+    size_t intIndex = 0;
+    size_t textIndex = 0;
+    for (size_t i = 0; i < isText.size(); ++i) {
+        MYSQL_BIND& bind = binds[i];
+        if (isText[i]) {
+            std::string& text = texts[textIndex++];
+            lengths[i] = text.size();
+            bind.buffer_type = MYSQL_TYPE_STRING;
+            bind.buffer = &text[0];
+            bind.buffer_length = text.size();
+            bind.length = &lengths[i];
+        } else {
+            bind.buffer_type = MYSQL_TYPE_LONGLONG;
+            bind.buffer = &ints[intIndex++];
+            bind.is_unsigned = true;
+        }
+    }
+    return binds;
+}
+
+BatchWriter::BatchWriter(DbConnection& dbConn) : dbConn(dbConn) {
+    // 重连会关闭旧连接，依附其上的预编译语句须先关闭，之后按需重新准备
+    dbConn.setCloseHandler([this] { closeStatements(); });
+}
+
+BatchWriter::~BatchWriter() {
+    dbConn.setCloseHandler(nullptr);
+    closeStatements();
+}
+
+bool BatchWriter::isTransientError(unsigned int error) {
+    return error == CR_SERVER_GONE_ERROR || error == CR_SERVER_LOST || error == ER_LOCK_DEADLOCK || error == ER_LOCK_WAIT_TIMEOUT;
+}
+
+void BatchWriter::addOrder(const Order& order) {
+    auto it = orderSlots.find(order.orderId);
+    if (it != orderSlots.end()) {
+        orders[it->second] = order;
+        return;
+    }
+    orderSlots.emplace(order.orderId, orders.size());
+    orders.push_back(order);
+}
+
+void BatchWriter::addTrade(const TradeRecord& trade) {
+    trades.push_back(trade);
+}
+
+bool BatchWriter::flush() {
+    if (empty()) {
+        return true;
+    }
+
+    if (!commit([this] { return writeOrders(0, orders.size()) && writeTrades(0, trades.size()); })) {
+        LOG_ERROR("Batch commit failed, rolled back and kept. orders: " + std::to_string(orders.size()) +
+                  " trades: " + std::to_string(trades.size()) + " error: " + std::to_string(errorCode) + " " + errorMessage);
+        return false;
+    }
+    LOG_DEBUG("Batch committed. orders: " + std::to_string(orders.size()) + " trades: " + std::to_string(trades.size()));
+
+    orders.clear();
+    orderSlots.clear();
+    trades.clear();
+    return true;
+}
+
+bool BatchWriter::flushRows(const RejectHandler& onRejected) {
+    // 订单按主键覆盖写入、成交按主键去重，整批失败前已执行过的行再写一次没有副作用
+    size_t orderDone = 0;
+    while (orderDone < orders.size()) {
+        if (!commit([this, orderDone] { return writeOrders(orderDone, orderDone + 1); })) {
+            if (isTransientError(errorCode)) {
+                break;
+            }
+            onRejected(&orders[orderDone], nullptr, errorCode, errorMessage);
+        }
+        ++orderDone;
+    }
+    size_t tradeDone = 0;
+    while (orderDone == orders.size() && tradeDone < trades.size()) {
+        if (!commit([this, tradeDone] { return writeTrades(tradeDone, tradeDone + 1); })) {
+            if (isTransientError(errorCode)) {
+                break;
+            }
+            onRejected(nullptr, &trades[tradeDone], errorCode, errorMessage);
+        }
+        ++tradeDone;
+    }
+
+    bool finished = orderDone == orders.size() && tradeDone == trades.size();
+    orders.erase(orders.begin(), orders.begin() + orderDone);
+    trades.erase(trades.begin(), trades.begin() + tradeDone);
+    orderSlots.clear();
+    for (size_t i = 0; i < orders.size(); ++i) {
+        orderSlots.emplace(orders[i].orderId, i);
+    }
+    return finished;
+}
+
+bool BatchWriter::commit(const std::function<bool()>& write) {
+    errorCode = 0;
+    errorMessage.clear();
+    MYSQL* conn = dbConn.getConnection();
+    if (conn == nullptr) {
+        setError(CR_SERVER_GONE_ERROR, "no database connection");
+        return false;
+    }
+    bool ok = false;
+    try {
+        ok = query("START TRANSACTION") && write() && query("COMMIT");
+    } catch (const std::exception& e) {
+        setError(0, e.what());
+    }
+    if (!ok) {
+        // 回滚失败不覆盖本次失败的原因
+        mysql_query(conn, "ROLLBACK");
+    }
+    return ok;
+}
+
+bool BatchWriter::writeOrders(size_t begin, size_t end) {
+    for (size_t offset = begin; offset < end; ) {
+        size_t rows = chunkSize(std::min(end - offset, MAX_ROWS_PER_STATEMENT));
+        MYSQL_STMT* stmt = orderStatement(rows);
+        if (stmt == nullptr) {
+            return false;
+        }
+
+        params.reset(rows * ORDER_COLUMNS);
+        for (size_t i = offset; i < offset + rows; ++i) {
+            const Order& order = orders[i];
+            params.addInt(order.orderId);
+            params.addInt(order.userId);
+            params.addText(order.symbol);
+            params.addText(formatFixed(order.price, PRICE_DECIMALS));
+            params.addText(formatFixed(order.quantity, QUANTITY_DECIMALS));
+            params.addText(formatFixed(order.feeRate, FEE_RATE_DECIMALS));
+            params.addText(orderSideToString(order.orderSide));
+            params.addText(orderTypeToString(order.orderType));
+            params.addText(timeInForceToString(order.timeInForce));
+            params.addText(persistedStatus(order));
+            params.addText(formatFixed(order.filledQuantity, QUANTITY_DECIMALS));
+            params.addText(databaseTimestamp(order.createTime));
+        }
+        if (!execute(stmt)) {
+            return false;
+        }
+        offset += rows;
+    }
+    return true;
+}
+
+bool BatchWriter::writeTrades(size_t begin, size_t end) {
+    for (size_t offset = begin; offset < end; ) {
+        size_t rows = chunkSize(std::min(end - offset, MAX_ROWS_PER_STATEMENT));
+        MYSQL_STMT* stmt = tradeStatement(rows);
+        if (stmt == nullptr) {
+            return false;
+        }
+
+        params.reset(rows * TRADE_COLUMNS);
+        for (size_t i = offset; i < offset + rows; ++i) {
+            const TradeRecord& trade = trades[i];
+            params.addInt(trade.tradeId);
+            params.addInt(trade.buyerUserId);
+            params.addInt(trade.sellerUserId);
+            params.addInt(trade.buyerOrderId);
+            params.addInt(trade.sellerOrderId);
+            params.addText(trade.orderType);
+            params.addText(formatFixed(trade.tradePrice, PRICE_DECIMALS));
+            params.addText(formatFixed(trade.tradeQuantity, QUANTITY_DECIMALS));
+            params.addText(formatFixed(trade.buyerFee, AMOUNT_DECIMALS));
+            params.addText(formatFixed(trade.sellerFee, AMOUNT_DECIMALS));
+        }
+        if (!execute(stmt)) {
+            return false;
+        }
+        offset += rows;
+    }
+    return true;
+}
+
+MYSQL_STMT* BatchWriter::orderStatement(size_t rows) {
+    auto it = orderStatements.find(rows);
+    if (it != orderStatements.end()) {
+        return it->second;
+    }
+    // create_time 为撮合引擎的入簿时间，改价或加量后重新排队时随之更新，启动恢复挂单时按它排序
+    std::string sql = "INSERT INTO orders (order_id, user_id, trading_pair, price, quantity, fee_rate, order_side, order_type, time_in_force, status, filled_quantity, create_time) VALUES " +
+                      placeholders(rows, ORDER_COLUMNS) +
+                      " ON DUPLICATE KEY UPDATE status = VALUES(status), price = VALUES(price), quantity = VALUES(quantity), filled_quantity = VALUES(filled_quantity), create_time = VALUES(create_time)";
+    MYSQL_STMT* stmt = prepare(sql);
+    if (stmt != nullptr) {
+        orderStatements[rows] = stmt;
+    }
+    return stmt;
+}
+
+MYSQL_STMT* BatchWriter::tradeStatement(size_t rows) {
+    auto it = tradeStatements.find(rows);
+    if (it != tradeStatements.end()) {
+        return it->second;
+    }
+    // 成交号由撮合引擎分配；重发的成交按主键去重，不再依赖自增主键
+    std::string sql = "INSERT INTO trade_records (trade_id, buyer_user_id, seller_user_id, buyer_order_id, seller_order_id, order_type, trade_price, trade_quantity, buyer_fee, seller_fee) VALUES " +
+                      placeholders(rows, TRADE_COLUMNS) +
+                      " ON DUPLICATE KEY UPDATE trade_id = trade_id";
+    MYSQL_STMT* stmt = prepare(sql);
+    if (stmt != nullptr) {
+        tradeStatements[rows] = stmt;
+    }
+    return stmt;
+}
+
+MYSQL_STMT* BatchWriter::prepare(const std::string& sql) {
+    MYSQL* conn = dbConn.getConnection();
+    MYSQL_STMT* stmt = mysql_stmt_init(conn);
+    if (stmt == nullptr) {
+        LOG_ERROR("mysql_stmt_init() failed.");
+        setError(mysql_errno(conn), mysql_error(conn));
+        return nullptr;
+    }
+    if (mysql_stmt_prepare(stmt, sql.c_str(), sql.size())) {
+        LOG_ERROR("Failed to prepare statement: " + std::string(mysql_stmt_error(stmt)));
+        setError(mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+        mysql_stmt_close(stmt);
+        return nullptr;
+    }
+    return stmt;
+}
+
+bool BatchWriter::execute(MYSQL_STMT* stmt) {
+    if (mysql_stmt_bind_param(stmt, params.bind().data()) || mysql_stmt_execute(stmt)) {
+        LOG_ERROR("Batch statement failed: " + std::string(mysql_stmt_error(stmt)));
+        setError(mysql_stmt_errno(stmt), mysql_stmt_error(stmt));
+        return false;
+    }
+    return true;
+}
+
+bool BatchWriter::query(const char* sql) {
+    // 不经 executeQuery：事务中途断线后在新连接上单独重试 COMMIT 会把批次当作已提交
+    MYSQL* conn = dbConn.getConnection();
+    if (mysql_query(conn, sql)) {
+        setError(mysql_errno(conn), mysql_error(conn));
+        return false;
+    }
+    return true;
+}
+
+void BatchWriter::setError(unsigned int error, const std::string& message) {
+    errorCode = error;
+    errorMessage = message;
+}
+
+void BatchWriter::closeStatements() {
+    for (auto& entry : orderStatements) {
+        mysql_stmt_close(entry.second);
+    }
+    for (auto& entry : tradeStatements) {
+        mysql_stmt_close(entry.second);
+    }
+    orderStatements.clear();
+    tradeStatements.clear();
+}
@@ -30,3 +30,31 @@ DbConfig readConfig(const std::string& configFile) {
 
     return config;
 }
+
+PersistenceConfig readPersistenceConfig(const std::string& configFile) {
+    std::ifstream file(configFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open config file: " + configFile);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        throw std::runtime_error("Failed to parse configuration file: " + errs);
+    }
+
+    const Json::Value& persistence = root["persistence"];
+    PersistenceConfig config;
+    config.batchSize = persistence.get("batchSize", 1000).asUInt64();
+    config.flushIntervalMs = persistence.get("flushIntervalMs", 10).asInt();
+    config.workerCount = persistence.get("workerCount", 8).asUInt64();
+    config.deadLetterDir = persistence.get("deadLetterDir", "dead_letters").asString();
+    if (config.batchSize == 0 || config.flushIntervalMs <= 0 || config.workerCount == 0) {
+        throw std::runtime_error("persistence.batchSize, persistence.flushIntervalMs and persistence.workerCount must be positive");
+    }
+    if (config.deadLetterDir.empty()) {
+        throw std::runtime_error("persistence.deadLetterDir must not be empty");
+    }
+    return config;
+}
@@ -1,28 +1,51 @@
 #include "DbConnection.h"
+#include <charconv>
 #include <iostream>
+#include <stdexcept>
 
-DbConnection::DbConnection(const DbConfig& config) {
-    conn = mysql_init(nullptr);
-    if (conn == nullptr) {
+DbConnection::DbConnection(const DbConfig& config) : config(config), conn(nullptr) {
+    conn = connect();
+}
+
+DbConnection::~DbConnection() {
+    close();
+}
+
+MYSQL* DbConnection::connect() {
+    MYSQL* handle = mysql_init(nullptr);
+    if (handle == nullptr) {
         LOG_WARN("mysql_init() failed.");
-        return;
+        return nullptr;
     }
+    // 会话时区固定为 UTC：TIMESTAMP 列按 UTC 读写，与 parseTimestamp 的假定一致
+    mysql_options(handle, MYSQL_INIT_COMMAND, "SET time_zone = '+00:00'");
 
-    if (mysql_real_connect(conn, config.host.c_str(), config.user.c_str(), config.password.c_str(), config.database.c_str(), 0, nullptr, 0) == nullptr) {
-        LOG_WARN("mysql_real_connect() failed.");
-        mysql_close(conn);
-        conn = nullptr;
+    if (mysql_real_connect(handle, config.host.c_str(), config.user.c_str(), config.password.c_str(), config.database.c_str(), config.port, nullptr, 0) == nullptr) {
+        LOG_WARN("mysql_real_connect() failed: " + std::string(mysql_error(handle)));
+        mysql_close(handle);
+        return nullptr;
     }
+    return handle;
 }
 
-DbConnection::~DbConnection() {
-    if (conn) {
-        mysql_close(conn);
+void DbConnection::close() {
+    if (conn == nullptr) {
+        return;
+    }
+    // 依附于连接的预编译语句须先关闭
+    if (closeHandler) {
+        closeHandler();
     }
+    mysql_close(conn);
+    conn = nullptr;
 }
 
 bool DbConnection::executeQuery(const std::string& query) {
     LOG_DEBUG("Executing query: " + query);
+    if (conn == nullptr) {
+        // 上次重连失败，先重建连接
+        reconnect();
+    }
     if (mysql_query(conn, query.c_str())) {
         LOG_DEBUG("Query failed: " + std::string(mysql_error(conn)));
         if (mysql_errno(conn) == CR_SERVER_GONE_ERROR || mysql_errno(conn) == CR_SERVER_LOST) {
@@ -38,49 +61,87 @@ bool DbConnection::executeQuery(const std::string& query) {
     return true;
 }
 
-std::vector<std::map<std::string, std::string>> DbConnection::executeQueryWithResult(const std::string& query) {
-    std::vector<std::map<std::string, std::string>> results;
-    LOG_DEBUG("Executing query with result: " + query);
-    if (mysql_query(conn, query.c_str())) {
-        LOG_DEBUG("Query failed: " + std::string(mysql_error(conn)));
-        if (mysql_errno(conn) == CR_SERVER_GONE_ERROR || mysql_errno(conn) == CR_SERVER_LOST) {
-            reconnect();
-            if (mysql_query(conn, query.c_str())) {
-                LOG_ERROR("Query failed after reconnect: " + std::string(mysql_error(conn)));
-                return results;
-            }
-        } else {
-            return results;
-        }
+bool DbConnection::queryRows(const std::string& query, const std::function<void(const DbRow&)>& onRow) {
+    if (!executeQuery(query)) {
+        return false;
     }
 
-    MYSQL_RES* res = mysql_store_result(conn);
+    MYSQL_RES* res = mysql_use_result(conn);
     if (res == nullptr) {
-        LOG_WARN("mysql_store_result() failed: " + std::string(mysql_error(conn)));
-        return results;
+        LOG_WARN("mysql_use_result() failed: " + std::string(mysql_error(conn)));
+        return false;
     }
 
-    int num_fields = mysql_num_fields(res);
+    unsigned int columns = mysql_num_fields(res);
     MYSQL_ROW row;
-    MYSQL_FIELD* fields = mysql_fetch_fields(res);
-
-    while ((row = mysql_fetch_row(res))) {
-        std::map<std::string, std::string> result_row;
-        for (int i = 0; i < num_fields; ++i) {
-            result_row[fields[i].name] = row[i] ? row[i] : "NULL";
+    try {
+        while ((row = mysql_fetch_row(res))) {
+            onRow(DbRow(row, mysql_fetch_lengths(res), columns));
         }
-        results.push_back(result_row);
+    } catch (...) {
+        // 释放时会读完并丢弃剩余的行，连接随后仍可使用
+        mysql_free_result(res);
+        throw;
     }
 
+    // 流式读取时 mysql_fetch_row 返回空既可能是读完，也可能是中途出错
+    bool ok = mysql_errno(conn) == 0;
+    if (!ok) {
+        LOG_ERROR("Failed to fetch rows: " + std::string(mysql_error(conn)));
+    }
     mysql_free_result(res);
-    return results;
+    return ok;
+}
+
+std::string DbConnection::escape(const std::string& value) {
+    std::string escaped(value.size() * 2 + 1, '\0');
+    escaped.resize(mysql_real_escape_string(conn, &escaped[0], value.data(), value.size()));
+    return escaped;
+}
+
+std::string_view DbRow::asText(unsigned int column) const {
+    return row[column] ? std::string_view(row[column], lengths[column]) : std::string_view();
+}
+
+const char* DbRow::notNull(unsigned int column) const {
+    if (row[column] == nullptr) {
+        throw std::invalid_argument("Unexpected NULL in column " + std::to_string(column));
+    }
+    return row[column];
 }
 
+int64_t DbRow::asInt64(unsigned int column) const {
+    const char* text = notNull(column);
+    int64_t value = 0;
+    auto result = std::from_chars(text, text + lengths[column], value);
+    if (result.ec != std::errc() || result.ptr != text + lengths[column]) {
+        throw std::invalid_argument("Invalid integer in column " + std::to_string(column) + ": " + std::string(text, lengths[column]));
+    }
+    return value;
+}
+
+uint64_t DbRow::asUInt64(unsigned int column) const {
+    const char* text = notNull(column);
+    uint64_t value = 0;
+    auto result = std::from_chars(text, text + lengths[column], value);
+    if (result.ec != std::errc() || result.ptr != text + lengths[column]) {
+        throw std::invalid_argument("Invalid integer in column " + std::to_string(column) + ": " + std::string(text, lengths[column]));
+    }
+    return value;
+}
+
+int64_t DbRow::asFixed(unsigned int column, int decimals) const {
+    return parseFixed(notNull(column), lengths[column], decimals);
+}
+
+Timestamp DbRow::asTimestamp(unsigned int column) const {
+    return parseTimestamp(notNull(column), lengths[column]);
+}
 
 void DbConnection::reconnect() {
     LOG_DEBUG("Reconnecting to database...");
-    mysql_close(conn);
-    conn = getConnection();
+    close();
+    conn = connect();
     if (conn == nullptr) {
         LOG_ERROR("Failed to reconnect to database.");
         throw std::runtime_error("Failed to reconnect to database");
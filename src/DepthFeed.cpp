@@ -0,0 +1,197 @@
+#include "DepthFeed.h"
+#include "Serialization.h"
+
+namespace {
+    // 两份按从优到劣排列的价位表做归并，输出新增或数量变化的价位，以及移出前 N 档的价位（数量为 0）
+    template <typename Better>
+    void diffLevels(const std::vector<DepthLevel>& published, const std::vector<DepthLevel>& current,
+                    std::vector<DepthLevel>& changes, Better better) {
+        size_t i = 0;
+        size_t j = 0;
+        while (i < published.size() || j < current.size()) {
+            if (j == current.size() || (i < published.size() && better(published[i].price, current[j].price))) {
+                changes.push_back(DepthLevel{published[i].price, 0});
+                ++i;
+            } else if (i == published.size() || better(current[j].price, published[i].price)) {
+                changes.push_back(current[j]);
+                ++j;
+            } else {
+                if (published[i].quantity != current[j].quantity) {
+                    changes.push_back(current[j]);
+                }
+                ++i;
+                ++j;
+            }
+        }
+    }
+
+    Json::Value levelsToJson(const std::vector<DepthLevel>& levels) {
+        Json::Value array(Json::arrayValue);
+        for (const DepthLevel& level : levels) {
+            Json::Value entry(Json::arrayValue);
+            entry.append(formatFixed(level.price, PRICE_DECIMALS));
+            entry.append(formatFixed(level.quantity, QUANTITY_DECIMALS));
+            array.append(entry);
+        }
+        return array;
+    }
+
+    std::vector<DepthLevel> levelsFromJson(const Json::Value& array) {
+        std::vector<DepthLevel> levels;
+        levels.reserve(array.size());
+        for (const Json::Value& entry : array) {
+            levels.push_back(DepthLevel{parseFixed(entry[0].asString(), PRICE_DECIMALS),
+                                        parseFixed(entry[1].asString(), QUANTITY_DECIMALS)});
+        }
+        return levels;
+    }
+
+    template <typename Map>
+    void applyLevels(Map& book, const std::vector<DepthLevel>& levels) {
+        for (const DepthLevel& level : levels) {
+            if (level.quantity == 0) {
+                book.erase(level.price);
+            } else {
+                book[level.price] = level.quantity;
+            }
+        }
+    }
+}
+
+DepthPublisher::DepthPublisher(size_t depth) : depth(depth), sequence(0) {
+    publishedBids.reserve(depth);
+    publishedAsks.reserve(depth);
+    currentBids.reserve(depth);
+    currentAsks.reserve(depth);
+}
+
+DepthUpdate DepthPublisher::snapshot(const OrderBook& orderBook) {
+    return snapshotOf(orderBook);
+}
+
+bool DepthPublisher::delta(const OrderBook& orderBook, DepthUpdate& update) {
+    return deltaOf(orderBook, update);
+}
+
+DepthUpdate DepthPublisher::snapshot(const DepthBook& depthBook) {
+    return snapshotOf(depthBook);
+}
+
+bool DepthPublisher::delta(const DepthBook& depthBook, DepthUpdate& update) {
+    return deltaOf(depthBook, update);
+}
+
+DepthUpdate DepthPublisher::published() const {
+    DepthUpdate update;
+    update.snapshot = true;
+    update.sequence = sequence;
+    update.bids = publishedBids;
+    update.asks = publishedAsks;
+    return update;
+}
+
+template <typename Book>
+DepthUpdate DepthPublisher::snapshotOf(const Book& book) {
+    collect(book, OrderSide::BUY, publishedBids);
+    collect(book, OrderSide::SELL, publishedAsks);
+    ++sequence;
+    return published();
+}
+
+template <typename Book>
+bool DepthPublisher::deltaOf(const Book& book, DepthUpdate& update) {
+    collect(book, OrderSide::BUY, currentBids);
+    collect(book, OrderSide::SELL, currentAsks);
+
+    update.snapshot = false;
+    update.bids.clear();
+    update.asks.clear();
+    diffLevels(publishedBids, currentBids, update.bids, [](Price a, Price b) { return a > b; });
+    diffLevels(publishedAsks, currentAsks, update.asks, [](Price a, Price b) { return a < b; });
+    if (update.bids.empty() && update.asks.empty()) {
+        return false;
+    }
+
+    update.sequence = ++sequence;
+    publishedBids.swap(currentBids);
+    publishedAsks.swap(currentAsks);
+    return true;
+}
+
+void DepthPublisher::collect(const OrderBook& orderBook, OrderSide side, std::vector<DepthLevel>& levels) const {
+    levels.clear();
+    orderBook.forEachBestLevel(side, depth, [&levels](Price price, const PriceLevel& level) {
+        levels.push_back(DepthLevel{price, level.quantity});
+    });
+}
+
+void DepthPublisher::collect(const DepthBook& depthBook, OrderSide side, std::vector<DepthLevel>& levels) const {
+    levels.clear();
+    depthBook.forEachBestLevel(side, depth, [&levels](Price price, Quantity quantity) {
+        levels.push_back(DepthLevel{price, quantity});
+    });
+}
+
+bool DepthBook::apply(const DepthUpdate& update) {
+    if (update.snapshot) {
+        bids.clear();
+        asks.clear();
+    } else if (!isSynced || update.sequence != lastSequence + 1) {
+        isSynced = false;
+        return false;
+    }
+    applyLevels(bids, update.bids);
+    applyLevels(asks, update.asks);
+    lastSequence = update.sequence;
+    isSynced = true;
+    return true;
+}
+
+DepthUpdate DepthBook::snapshot() const {
+    DepthUpdate update;
+    update.snapshot = true;
+    update.sequence = lastSequence;
+    for (const auto& level : bids) {
+        update.bids.push_back(DepthLevel{level.first, level.second});
+    }
+    for (const auto& level : asks) {
+        update.asks.push_back(DepthLevel{level.first, level.second});
+    }
+    return update;
+}
+
+std::vector<BookEntry> DepthBook::entries() const {
+    std::vector<BookEntry> entries;
+    entries.reserve(bids.size() + asks.size());
+    for (const auto& level : bids) {
+        entries.push_back(BookEntry{OrderSide::BUY, level.first, level.second});
+    }
+    for (const auto& level : asks) {
+        entries.push_back(BookEntry{OrderSide::SELL, level.first, level.second});
+    }
+    return entries;
+}
+
+DepthUpdate parseDepthMessage(const void* data, size_t size) {
+    if (isBinaryMessage(data, size)) {
+        return decodeDepthMessage(data, size);
+    }
+
+    Json::Value root = deserializeMessage(static_cast<const char*>(data), size);
+    DepthUpdate update;
+    update.snapshot = root["type"].asString() == wireMessageTypeToString(WireMessageType::BOOK_SNAPSHOT);
+    update.sequence = root["sequence"].asUInt64();
+    update.bids = levelsFromJson(root["bids"]);
+    update.asks = levelsFromJson(root["asks"]);
+    return update;
+}
+
+std::string serializeDepthUpdate(const std::string& symbol, const DepthUpdate& update) {
+    Json::Value message;
+    message["type"] = wireMessageTypeToString(update.snapshot ? WireMessageType::BOOK_SNAPSHOT : WireMessageType::BOOK_DELTA);
+    message["symbol"] = symbol;
+    message["sequence"] = static_cast<Json::UInt64>(update.sequence);
+    message["bids"] = levelsToJson(update.bids);
+    message["asks"] = levelsToJson(update.asks);
+    return serializeMessage(message);
+}
@@ -0,0 +1,64 @@
+#include "EngineConfig.h"
+#include "OrderBook.h"
+#include <fstream>
+#include <stdexcept>
+#include <json/json.h>
+
+SelfTradePrevention stringToSelfTradePrevention(const std::string& str) {
+    if (str == "none" || str == "NONE") return SelfTradePrevention::NONE;
+    if (str == "cancelNewest" || str == "CANCEL_NEWEST") return SelfTradePrevention::CANCEL_NEWEST;
+    if (str == "cancelOldest" || str == "CANCEL_OLDEST") return SelfTradePrevention::CANCEL_OLDEST;
+    if (str == "decrement" || str == "DECREMENT") return SelfTradePrevention::DECREMENT;
+    throw std::invalid_argument("Unknown self-trade prevention mode: " + str);
+}
+
+JournalSync stringToJournalSync(const std::string& str) {
+    if (str == "none" || str == "NONE") return JournalSync::NONE;
+    if (str == "batch" || str == "BATCH") return JournalSync::BATCH;
+    throw std::invalid_argument("Unknown journal sync policy: " + str);
+}
+
+EngineConfig readEngineConfig(const std::string& configFile) {
+    std::ifstream file(configFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open config file: " + configFile);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        throw std::runtime_error("Failed to parse configuration file: " + errs);
+    }
+
+    const Json::Value& engine = root["engine"];
+    EngineConfig config;
+    config.orderPoolSize = engine.get("orderPoolSize", static_cast<Json::UInt64>(OrderBook::DEFAULT_ORDER_CAPACITY)).asUInt64();
+    config.priceWindowLevels = engine.get("priceWindowLevels", static_cast<Json::UInt64>(OrderBook::DEFAULT_WINDOW_LEVELS)).asUInt64();
+    config.wireFormat = stringToWireFormat(engine.get("wireFormat", "binary").asString());
+    config.orderBatchSize = engine.get("orderBatchSize", static_cast<Json::UInt64>(DEFAULT_ORDER_BATCH_SIZE)).asUInt64();
+    config.maxBatchDelayMicros = engine.get("maxBatchDelayMicros", static_cast<Json::Int64>(DEFAULT_MAX_BATCH_DELAY_MICROS)).asInt64();
+    config.shardCount = engine.get("shardCount", 0).asUInt64();
+    config.pinThreads = engine.get("pinThreads", true).asBool();
+    config.pinPipelineStages = engine.get("pinPipelineStages", false).asBool();
+    config.pipelineQueueSize = engine.get("pipelineQueueSize", static_cast<Json::UInt64>(DEFAULT_PIPELINE_QUEUE_SIZE)).asUInt64();
+    config.journalDir = engine.get("journalDir", "").asString();
+    config.journalSync = stringToJournalSync(engine.get("journalSync", "batch").asString());
+    // 日志恢复与数据库恢复互斥：配置了日志目录时缺省不从数据库加载，显式同时开启视为配置错误
+    config.loadOpenOrdersFromDatabase = engine.get("loadOpenOrdersFromDatabase", config.journalDir.empty()).asBool();
+    if (config.loadOpenOrdersFromDatabase && !config.journalDir.empty()) {
+        throw std::runtime_error("engine.journalDir and engine.loadOpenOrdersFromDatabase are mutually exclusive recovery modes");
+    }
+    config.selfTradePrevention = stringToSelfTradePrevention(engine.get("selfTradePrevention", "none").asString());
+    config.snapshotInterval = engine.get("snapshotInterval", static_cast<Json::UInt64>(DEFAULT_SNAPSHOT_INTERVAL)).asUInt64();
+    config.depthLevels = engine.get("depthLevels", static_cast<Json::UInt64>(DEFAULT_DEPTH_LEVELS)).asUInt64();
+    config.depthSnapshotIntervalMs = engine.get("depthSnapshotIntervalMs", static_cast<Json::Int64>(DEFAULT_DEPTH_SNAPSHOT_INTERVAL_MS)).asInt64();
+    if (config.orderBatchSize == 0 || config.snapshotInterval == 0 ||
+        config.depthLevels == 0 || config.depthSnapshotIntervalMs <= 0 || config.pipelineQueueSize == 0) {
+        throw std::runtime_error("engine.orderBatchSize, engine.snapshotInterval, engine.depthLevels, engine.depthSnapshotIntervalMs and engine.pipelineQueueSize must be positive");
+    }
+    if (config.depthLevels > UINT16_MAX) {
+        throw std::runtime_error("engine.depthLevels is too large");
+    }
+    return config;
+}
@@ -0,0 +1,96 @@
+#include "FixedPoint.h"
+#include <limits>
+#include <stdexcept>
+
+namespace {
+    constexpr int64_t POW10[] = {
+        1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL,
+        1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL
+    };
+}
+
+std::string formatFixed(int64_t value, int decimals) {
+    char buffer[32];
+    char* end = buffer + sizeof(buffer);
+    char* p = end;
+    bool negative = value < 0;
+    uint64_t magnitude = negative ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+
+    for (int i = 0; i < decimals; ++i) {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    }
+    if (decimals > 0) {
+        *--p = '.';
+    }
+    do {
+        *--p = static_cast<char>('0' + magnitude % 10);
+        magnitude /= 10;
+    } while (magnitude > 0);
+    if (negative) {
+        *--p = '-';
+    }
+    return std::string(p, end);
+}
+
+int64_t parseFixed(const char* str, size_t length, int decimals) {
+    size_t i = 0;
+    bool negative = false;
+    if (i < length && (str[i] == '-' || str[i] == '+')) {
+        negative = str[i] == '-';
+        ++i;
+    }
+
+    int64_t integerPart = 0;
+    int64_t fractionPart = 0;
+    int fractionDigits = 0;
+    bool seenDigit = false;
+    bool roundUp = false;
+    // 整数部分放大 10^decimals 后仍须在 int64_t 范围内，每累加一位之前检查
+    const int64_t maxIntegerPart = std::numeric_limits<int64_t>::max() / POW10[decimals];
+
+    for (; i < length && str[i] >= '0' && str[i] <= '9'; ++i) {
+        int digit = str[i] - '0';
+        if (integerPart > (maxIntegerPart - digit) / 10) {
+            throw std::out_of_range("Fixed-point number out of range: " + std::string(str, length));
+        }
+        integerPart = integerPart * 10 + digit;
+        seenDigit = true;
+    }
+    if (i < length && str[i] == '.') {
+        for (++i; i < length && str[i] >= '0' && str[i] <= '9'; ++i) {
+            if (fractionDigits < decimals) {
+                fractionPart = fractionPart * 10 + (str[i] - '0');
+                ++fractionDigits;
+            } else if (fractionDigits == decimals) {
+                // 超出精度的部分四舍五入
+                roundUp = str[i] >= '5';
+                ++fractionDigits;
+            }
+            seenDigit = true;
+        }
+    }
+    if (!seenDigit || i != length) {
+        throw std::invalid_argument("Invalid fixed-point number: " + std::string(str, length));
+    }
+
+    int scaleDigits = fractionDigits < decimals ? fractionDigits : decimals;
+    int64_t scaledInteger = integerPart * POW10[decimals];
+    int64_t scaledFraction = fractionPart * POW10[decimals - scaleDigits] + (roundUp ? 1 : 0);
+    if (scaledInteger > std::numeric_limits<int64_t>::max() - scaledFraction) {
+        throw std::out_of_range("Fixed-point number out of range: " + std::string(str, length));
+    }
+    int64_t value = scaledInteger + scaledFraction;
+    return negative ? -value : value;
+}
+
+int64_t parseFixed(const std::string& str, int decimals) {
+    return parseFixed(str.data(), str.size(), decimals);
+}
+
+Amount calculateFee(Price price, Quantity quantity, FeeRate feeRate) {
+    // price * quantity * feeRate 的小数位为 8 + 6 + 6 = 20，缩回 AMOUNT_DECIMALS 位
+    constexpr int64_t divisor = POW10[PRICE_DECIMALS + QUANTITY_DECIMALS + FEE_RATE_DECIMALS - AMOUNT_DECIMALS];
+    __int128 product = static_cast<__int128>(price) * quantity * feeRate;
+    return static_cast<Amount>((product + divisor / 2) / divisor);
+}
@@ -0,0 +1,29 @@
+#include "GatewayConfig.h"
+#include <fstream>
+#include <stdexcept>
+#include <json/json.h>
+
+GatewayConfig readGatewayConfig(const std::string& configFile) {
+    std::ifstream file(configFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open config file: " + configFile);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        throw std::runtime_error("Failed to parse configuration file: " + errs);
+    }
+
+    const Json::Value& gateway = root["gateway"];
+    GatewayConfig config;
+    config.maxDepth = gateway.get("maxDepth", static_cast<Json::UInt64>(DEFAULT_GATEWAY_MAX_DEPTH)).asUInt64();
+    config.maxQueuedMessages = gateway.get("maxQueuedMessages", static_cast<Json::UInt64>(DEFAULT_GATEWAY_MAX_QUEUED_MESSAGES)).asUInt64();
+    config.maxBufferedBytes = gateway.get("maxBufferedBytes", static_cast<Json::UInt64>(DEFAULT_GATEWAY_MAX_BUFFERED_BYTES)).asUInt64();
+    config.retryIntervalMs = gateway.get("retryIntervalMs", static_cast<Json::Int64>(DEFAULT_GATEWAY_RETRY_INTERVAL_MS)).asInt64();
+    if (config.maxDepth == 0 || config.maxQueuedMessages == 0 || config.maxBufferedBytes == 0 || config.retryIntervalMs <= 0) {
+        throw std::runtime_error("gateway.maxDepth, gateway.maxQueuedMessages, gateway.maxBufferedBytes and gateway.retryIntervalMs must be positive");
+    }
+    return config;
+}
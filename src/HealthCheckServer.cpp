@@ -1,5 +1,8 @@
 #include "HealthCheckServer.h"
 #include "Serialization.h"
+#include "WireProtocol.h"
+#include "MarketData.h"
+#include "MetricsServer.h"
 #include <iostream>
 #include <sstream>
 #include <mutex>
@@ -24,7 +27,9 @@ void HealthCheckServer::start() {
 
         try {
             std::lock_guard<std::mutex> lock(orderBookMutex_);
-            oss << "<pre>" << latestOrderBook_ << "</pre>"; // 输出最新的 orderBook
+            for (const auto& entry : orderBooks_) {
+                oss << "<pre>" << renderOrderBook(entry.first, entry.second) << "</pre>"; // 输出各交易对最新的 orderBook
+            }
 
             oss << "</body></html>";
 
@@ -37,6 +42,8 @@ void HealthCheckServer::start() {
         }
     });
 
+    registerMetricsEndpoint(svr_);
+
     LOG_DEBUG("Starting server at " + host_ + ":" + std::to_string(port_));
     svr_.listen(host_.c_str(), port_);
 }
@@ -49,19 +56,34 @@ void HealthCheckServer::stop() {
     svr_.stop();
 }
 
+std::string HealthCheckServer::renderOrderBook(const std::string& symbol, const DepthBook& book) {
+    if (!book.synced()) {
+        return "Symbol: " + symbol + "\nWaiting for book snapshot\n";
+    }
+    return formatBookTable(symbol, book.entries());
+}
+
 void HealthCheckServer::receiveOrderBook() {
     LOG_DEBUG("OrderBook receiver started.");
     while (running_) {
         try {
+            // 订单簿消息为两帧：交易对主题 + 订单簿内容
+            zmq::message_t topic;
             zmq::message_t message;
-            auto result = bookSocket.recv(message, zmq::recv_flags::none);
-            if (result) {
-                std::string orderBookData(static_cast<char*>(message.data()), message.size());
-                LOG_DEBUG("Received order book data");
-                LOG_DEBUG("Received order book data: " + orderBookData);
+            if (bookSocket.recv(topic, zmq::recv_flags::none) && topic.more() &&
+                bookSocket.recv(message, zmq::recv_flags::none)) {
+                // 同一端口上的成交流水在这里不需要
+                if (readMarketDataType(message.data(), message.size()) == WireMessageType::TRADE_PRINTS) {
+                    continue;
+                }
+                std::string symbol(static_cast<const char*>(topic.data()), topic.size());
+                DepthUpdate update = parseDepthMessage(message.data(), message.size());
+                LOG_DEBUG("Received order book data. symbol: " + symbol + " sequence: " + std::to_string(update.sequence));
 
                 std::lock_guard<std::mutex> lock(orderBookMutex_);
-                latestOrderBook_ = orderBookData;
+                if (!orderBooks_[symbol].apply(update)) {
+                    LOG_DEBUG("Dropped out-of-sequence book update for " + symbol + ", waiting for snapshot");
+                }
             }
         } catch (const zmq::error_t& e) {
             LOG_ERROR("ZeroMQ error in receiveOrderBook: " + std::string(e.what()));
@@ -0,0 +1,49 @@
+#include "Instrument.h"
+#include <fstream>
+#include <set>
+#include <sstream>
+#include <stdexcept>
+#include <json/json.h>
+
+Instrument defaultInstrument() {
+    return Instrument{DEFAULT_SYMBOL, PRICE_SCALE / 100, 1, 1};
+}
+
+std::vector<Instrument> readInstruments(const std::string& configFile) {
+    std::ifstream file(configFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open config file: " + configFile);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        throw std::runtime_error("Failed to parse configuration file: " + errs);
+    }
+
+    std::vector<Instrument> instruments;
+    std::set<uint32_t> instrumentIds;
+    for (const auto& item : root["instruments"]) {
+        Instrument instrument;
+        instrument.symbol = item["symbol"].asString();
+        instrument.tickSize = parseFixed(item["tickSize"].asString(), PRICE_DECIMALS);
+        instrument.lotSize = parseFixed(item["lotSize"].asString(), QUANTITY_DECIMALS);
+        // 未配置编号时按配置顺序从 1 编起
+        Json::UInt64 id = item.get("id", static_cast<Json::UInt64>(instruments.size() + 1)).asUInt64();
+        if (instrument.symbol.empty() || instrument.symbol.size() > MAX_SYMBOL_LENGTH ||
+            instrument.tickSize <= 0 || instrument.lotSize <= 0 || id == 0 || id > MAX_INSTRUMENT_ID) {
+            throw std::runtime_error("Invalid instrument configuration: " + instrument.symbol);
+        }
+        instrument.instrumentId = static_cast<uint32_t>(id);
+        if (!instrumentIds.insert(instrument.instrumentId).second) {
+            throw std::runtime_error("Duplicate instrument id: " + std::to_string(id));
+        }
+        instruments.push_back(instrument);
+    }
+
+    if (instruments.empty()) {
+        instruments.push_back(defaultInstrument());
+    }
+    return instruments;
+}
@@ -0,0 +1,303 @@
+#include "Journal.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    struct RecordHeader {
+        uint32_t length;
+        uint32_t reserved;
+        uint64_t sequence;
+    };
+
+    constexpr size_t RECORD_ALIGNMENT = 8;
+
+    size_t recordSize(size_t payloadSize) {
+        return (sizeof(RecordHeader) + payloadSize + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+    }
+
+    std::string systemError(const std::string& what, const std::string& path) {
+        return what + " " + path + ": " + std::strerror(errno);
+    }
+
+    std::string segmentPath(const std::string& path, uint64_t segment) {
+        return path + "." + std::to_string(segment);
+    }
+
+    // 按段号升序列出已有的段
+    std::vector<uint64_t> listSegments(const std::string& path) {
+        std::filesystem::path prefix(path);
+        std::filesystem::path directory = prefix.has_parent_path() ? prefix.parent_path() : std::filesystem::path(".");
+        std::string stem = prefix.filename().string() + ".";
+        std::vector<uint64_t> segments;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(directory, error)) {
+            std::string name = entry.path().filename().string();
+            if (name.size() <= stem.size() || name.compare(0, stem.size(), stem) != 0 ||
+                name.find_first_not_of("0123456789", stem.size()) != std::string::npos) {
+                continue;
+            }
+            segments.push_back(std::stoull(name.substr(stem.size())));
+        }
+        std::sort(segments.begin(), segments.end());
+        return segments;
+    }
+
+    // 依次处理一段映射内存中的完整记录，返回最后一条完整记录之后的偏移
+    template <typename Handler>
+    size_t scanRecords(const char* base, size_t size, Handler&& handler) {
+        size_t offset = 0;
+        while (offset + sizeof(RecordHeader) <= size) {
+            const RecordHeader* header = reinterpret_cast<const RecordHeader*>(base + offset);
+            if (header->length == 0 || offset + recordSize(header->length) > size) {
+                break;
+            }
+            handler(header->sequence, base + offset + sizeof(RecordHeader), header->length);
+            offset += recordSize(header->length);
+        }
+        return offset;
+    }
+
+    // 只读映射一个已关闭的段并处理其中的记录；段已被删除时跳过
+    template <typename Handler>
+    void scanSegmentFile(const std::string& file, Handler&& handler) {
+        int fd = ::open(file.c_str(), O_RDONLY);
+        if (fd < 0) {
+            if (errno == ENOENT) {
+                return;
+            }
+            throw std::runtime_error(systemError("Failed to open journal", file));
+        }
+        struct stat st;
+        if (::fstat(fd, &st) != 0) {
+            std::string message = systemError("Failed to stat journal", file);
+            ::close(fd);
+            throw std::runtime_error(message);
+        }
+        size_t size = static_cast<size_t>(st.st_size);
+        if (size == 0) {
+            ::close(fd);
+            return;
+        }
+        void* address = ::mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (address == MAP_FAILED) {
+            throw std::runtime_error(systemError("Failed to map journal", file));
+        }
+        scanRecords(static_cast<const char*>(address), size, handler);
+        ::munmap(address, size);
+    }
+}
+
+Journal::Journal(const std::string& path)
+        : path(path), firstSegment(0), segment(0), fd(-1), base(nullptr), mappedSize(0), writeOffset(0), syncedOffset(0),
+          resized(false), created(false), nextSequence(1) {
+    // 最后一段用于追加，此前的段只在回放时读取；追加段可能是刚切换或预先创建的空段，序号由旧段接续
+    std::vector<uint64_t> segments = listSegments(path);
+    if (!segments.empty()) {
+        firstSegment = segments.front();
+        segment = segments.back();
+    }
+    for (uint64_t index = firstSegment; index < segment; ++index) {
+        scanSegmentFile(segmentPath(path, index), [this](uint64_t sequence, const void*, size_t) {
+            nextSequence = sequence + 1;
+        });
+    }
+    openSegment(segment);
+    if (created) {
+        syncParentDirectory(path);
+        created = false;
+    }
+}
+
+Journal::~Journal() {
+    closeSegment();
+}
+
+uint64_t Journal::append(const void* data, uint32_t size) {
+    size_t needed = recordSize(size);
+    if (writeOffset + needed + sizeof(RecordHeader) > mappedSize) {
+        map(mappedSize + std::max(GROW_BYTES, needed));
+    }
+
+    RecordHeader* header = reinterpret_cast<RecordHeader*>(base + writeOffset);
+    uint64_t sequence = nextSequence++;
+    header->reserved = 0;
+    header->sequence = sequence;
+    std::memcpy(base + writeOffset + sizeof(RecordHeader), data, size);
+    // 负载写完后再写长度，回放时长度非 0 即表示记录完整
+    std::atomic_thread_fence(std::memory_order_release);
+    header->length = size;
+    writeOffset += needed;
+    return sequence;
+}
+
+void Journal::replay(uint64_t afterSequence, const std::function<void(uint64_t, const void*, size_t)>& handler) const {
+    auto replayRecord = [afterSequence, &handler](uint64_t sequence, const void* data, size_t size) {
+        if (sequence > afterSequence) {
+            handler(sequence, data, size);
+        }
+    };
+    for (uint64_t index = firstSegment; index < segment; ++index) {
+        scanSegmentFile(segmentPath(path, index), replayRecord);
+    }
+    scanRecords(base, writeOffset, replayRecord);
+}
+
+void Journal::read(const std::string& path, uint64_t afterSequence, const std::function<void(uint64_t, const void*, size_t)>& handler) {
+    for (uint64_t index : listSegments(path)) {
+        scanSegmentFile(segmentPath(path, index), [afterSequence, &handler](uint64_t sequence, const void* data, size_t size) {
+            if (sequence > afterSequence) {
+                handler(sequence, data, size);
+            }
+        });
+    }
+}
+
+void Journal::sync() {
+    if (syncedOffset == writeOffset && !resized && !created) {
+        return;
+    }
+    // msync 要求起始地址按页对齐，从已落盘位置所在的页开始刷
+    static const size_t pageSize = static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+    size_t start = syncedOffset & ~(pageSize - 1);
+    if (writeOffset > start && ::msync(base + start, writeOffset - start, MS_SYNC) != 0) {
+        throw std::runtime_error(systemError("Failed to sync journal", segmentPath(path, segment)));
+    }
+    if (resized && ::fdatasync(fd) != 0) {
+        throw std::runtime_error(systemError("Failed to sync journal", segmentPath(path, segment)));
+    }
+    if (created) {
+        syncParentDirectory(path);
+    }
+    syncedOffset = writeOffset;
+    resized = false;
+    created = false;
+}
+
+uint64_t Journal::rotate() {
+    closeSegment();
+    openSegment(segment + 1);
+    return segment;
+}
+
+void Journal::resumeAfter(uint64_t sequence) {
+    if (sequence >= nextSequence) {
+        nextSequence = sequence + 1;
+    }
+}
+
+void Journal::removeSegmentsBefore(const std::string& path, uint64_t segment) {
+    for (uint64_t index : listSegments(path)) {
+        if (index >= segment) {
+            break;
+        }
+        std::string file = segmentPath(path, index);
+        if (::unlink(file.c_str()) != 0 && errno != ENOENT) {
+            throw std::runtime_error(systemError("Failed to remove journal", file));
+        }
+    }
+}
+
+void Journal::prepareSegment(const std::string& path, uint64_t segment) {
+    std::string file = segmentPath(path, segment);
+    int segmentFd = ::open(file.c_str(), O_RDWR | O_CREAT | O_EXCL, 0644);
+    if (segmentFd < 0) {
+        if (errno == EEXIST) {
+            return;
+        }
+        throw std::runtime_error(systemError("Failed to create journal", file));
+    }
+    if (::ftruncate(segmentFd, static_cast<off_t>(GROW_BYTES)) != 0 || ::fsync(segmentFd) != 0) {
+        std::string message = systemError("Failed to resize journal", file);
+        ::close(segmentFd);
+        throw std::runtime_error(message);
+    }
+    ::close(segmentFd);
+    syncParentDirectory(path);
+}
+
+void Journal::openSegment(uint64_t index) {
+    segment = index;
+    std::string file = segmentPath(path, index);
+    fd = ::open(file.c_str(), O_RDWR | O_CREAT, 0644);
+    if (fd < 0) {
+        throw std::runtime_error(systemError("Failed to open journal", file));
+    }
+
+    struct stat st;
+    try {
+        if (::fstat(fd, &st) != 0) {
+            throw std::runtime_error(systemError("Failed to stat journal", file));
+        }
+        map(st.st_size > 0 ? static_cast<size_t>(st.st_size) : GROW_BYTES);
+    } catch (...) {
+        ::close(fd);
+        fd = -1;
+        throw;
+    }
+    // 预先创建的段已刷过长度和目录
+    created = st.st_size == 0;
+    resized = created;
+
+    // 扫描已有记录，定位追加位置和下一个序号
+    writeOffset = scanRecords(base, mappedSize, [this](uint64_t sequence, const void*, size_t) {
+        nextSequence = sequence + 1;
+    });
+    syncedOffset = writeOffset;
+}
+
+void Journal::closeSegment() {
+    unmap();
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+void Journal::map(size_t size) {
+    unmap();
+    if (::ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        throw std::runtime_error(systemError("Failed to resize journal", segmentPath(path, segment)));
+    }
+    void* address = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) {
+        throw std::runtime_error(systemError("Failed to map journal", segmentPath(path, segment)));
+    }
+    base = static_cast<char*>(address);
+    mappedSize = size;
+    resized = true;
+}
+
+void Journal::unmap() {
+    if (base != nullptr) {
+        ::munmap(base, mappedSize);
+        base = nullptr;
+        mappedSize = 0;
+    }
+}
+
+void syncParentDirectory(const std::string& path) {
+    std::string directory = std::filesystem::path(path).parent_path().string();
+    if (directory.empty()) {
+        directory = ".";
+    }
+    int dirFd = ::open(directory.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirFd < 0) {
+        throw std::runtime_error(systemError("Failed to open directory", directory));
+    }
+    if (::fsync(dirFd) != 0) {
+        std::string message = systemError("Failed to sync directory", directory);
+        ::close(dirFd);
+        throw std::runtime_error(message);
+    }
+    ::close(dirFd);
+}
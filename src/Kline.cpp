@@ -0,0 +1,119 @@
+#include <algorithm>
+#include <chrono>
+#include "Kline.h"
+#include "Serialization.h"
+
+namespace {
+    struct KlineInterval {
+        const char* name;
+        int64_t millis;
+    };
+
+    constexpr KlineInterval KLINE_INTERVALS[] = {
+        {"1s", 1000},
+        {"1m", 60 * 1000},
+        {"5m", 5 * 60 * 1000},
+        {"1h", 60 * 60 * 1000},
+    };
+
+    void mergeTrade(KlineBar& bar, Price price, Quantity quantity) {
+        bar.high = std::max(bar.high, price);
+        bar.low = std::min(bar.low, price);
+        bar.close = price;
+        bar.volume += quantity;
+        ++bar.tradeCount;
+    }
+}
+
+KlineSeries::KlineSeries(const std::string& name, int64_t intervalMillis, size_t capacity)
+        : intervalName(name), interval(intervalMillis), bars(capacity), head(capacity - 1), count(0) {
+}
+
+const KlineBar* KlineSeries::add(int64_t timeMillis, Price price, Quantity quantity) {
+    int64_t openTime = timeMillis - timeMillis % interval;
+
+    // 常见情况：落在最新一根或开启新的一根
+    if (count == 0 || openTime > bars[head].openTime) {
+        head = (head + 1) % bars.size();
+        bars[head] = KlineBar{openTime, price, price, price, price, quantity, 1};
+        count = std::min(count + 1, bars.size());
+        return &bars[head];
+    }
+    if (openTime == bars[head].openTime) {
+        mergeTrade(bars[head], price, quantity);
+        return &bars[head];
+    }
+
+    // 迟到的成交：向前查找所在周期的 K 线
+    for (size_t i = count; i-- > 0; ) {
+        KlineBar& bar = bars[(head + bars.size() - count + 1 + i) % bars.size()];
+        if (bar.openTime == openTime) {
+            mergeTrade(bar, price, quantity);
+            return &bar;
+        }
+        if (bar.openTime < openTime) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+const std::vector<KlineSeries>& KlineAggregator::addTrades(const std::string& symbol, const std::vector<TradePrint>& trades) {
+    std::vector<KlineSeries>& symbolSeries = seriesFor(symbol);
+    for (const TradePrint& trade : trades) {
+        int64_t timeMillis = std::chrono::duration_cast<std::chrono::milliseconds>(trade.tradeTime.time_since_epoch()).count();
+        for (KlineSeries& klines : symbolSeries) {
+            klines.add(timeMillis, trade.price, trade.quantity);
+        }
+    }
+    return symbolSeries;
+}
+
+std::vector<KlineSeries>& KlineAggregator::seriesFor(const std::string& symbol) {
+    auto it = series.find(symbol);
+    if (it == series.end()) {
+        std::vector<KlineSeries> symbolSeries;
+        for (const KlineInterval& interval : KLINE_INTERVALS) {
+            symbolSeries.emplace_back(interval.name, interval.millis, HISTORY_BARS);
+        }
+        it = series.emplace(symbol, std::move(symbolSeries)).first;
+    }
+    return it->second;
+}
+
+const KlineSeries* KlineAggregator::find(const std::string& symbol, const std::string& intervalName) const {
+    auto it = series.find(symbol);
+    if (it == series.end()) {
+        return nullptr;
+    }
+    for (const KlineSeries& klines : it->second) {
+        if (klines.name() == intervalName) {
+            return &klines;
+        }
+    }
+    return nullptr;
+}
+
+bool isKlineInterval(const std::string& intervalName) {
+    for (const KlineInterval& interval : KLINE_INTERVALS) {
+        if (intervalName == interval.name) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string serializeKline(const std::string& symbol, const KlineSeries& series, const KlineBar& bar) {
+    Json::Value message;
+    message["type"] = "KLINE";
+    message["symbol"] = symbol;
+    message["interval"] = series.name();
+    message["openTime"] = static_cast<Json::Int64>(bar.openTime);
+    message["open"] = formatFixed(bar.open, PRICE_DECIMALS);
+    message["high"] = formatFixed(bar.high, PRICE_DECIMALS);
+    message["low"] = formatFixed(bar.low, PRICE_DECIMALS);
+    message["close"] = formatFixed(bar.close, PRICE_DECIMALS);
+    message["volume"] = formatFixed(bar.volume, QUANTITY_DECIMALS);
+    message["trades"] = bar.tradeCount;
+    return serializeMessage(message);
+}
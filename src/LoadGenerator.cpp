@@ -0,0 +1,336 @@
+#include "LoadGenerator.h"
+#include "BatchWriter.h"
+#include "Logger.h"
+#include "Serialization.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <stdexcept>
+#include <thread>
+#include <json/json.h>
+
+namespace {
+    constexpr size_t RECENT_ORDER_CAPACITY = 4096;       // 每个发送线程记住的最近挂单数，撤单从中随机挑选
+    constexpr int RESULT_RECEIVE_TIMEOUT_MS = 100;
+    constexpr std::chrono::seconds RESULT_DRAIN_TIME{2};  // 发送结束后继续接收结果的时间
+
+    Price parseMidPrice(const std::string& symbol, const std::string& text) {
+        Price price = parseFixed(text, PRICE_DECIMALS);
+        if (price <= 0) {
+            throw std::runtime_error("load.midPrices." + symbol + " must be positive");
+        }
+        return price;
+    }
+}
+
+ArrivalProcess stringToArrivalProcess(const std::string& str) {
+    if (str == "constant") return ArrivalProcess::CONSTANT;
+    if (str == "poisson") return ArrivalProcess::POISSON;
+    throw std::runtime_error("Unknown arrival process: " + str);
+}
+
+LoadConfig readLoadConfig(const std::string& configFile) {
+    std::ifstream file(configFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open config file: " + configFile);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        throw std::runtime_error("Failed to parse configuration file: " + errs);
+    }
+
+    const Json::Value& load = root["load"];
+    LoadConfig config;
+    config.ratePerSecond = load.get("ratePerSecond", DEFAULT_LOAD_RATE_PER_SECOND).asDouble();
+    config.arrival = stringToArrivalProcess(load.get("arrival", "poisson").asString());
+    config.producerThreads = load.get("producerThreads", static_cast<Json::UInt64>(DEFAULT_LOAD_PRODUCER_THREADS)).asUInt64();
+    config.durationSeconds = load.get("durationSeconds", static_cast<Json::Int64>(DEFAULT_LOAD_DURATION_SECONDS)).asInt64();
+    config.cancelRatio = load.get("cancelRatio", DEFAULT_LOAD_CANCEL_RATIO).asDouble();
+    config.marketRatio = load.get("marketRatio", DEFAULT_LOAD_MARKET_RATIO).asDouble();
+    config.priceSpreadTicks = load.get("priceSpreadTicks", static_cast<Json::Int64>(DEFAULT_LOAD_PRICE_SPREAD_TICKS)).asInt64();
+    config.midVolatilityTicks = load.get("midVolatilityTicks", static_cast<Json::Int64>(DEFAULT_LOAD_MID_VOLATILITY_TICKS)).asInt64();
+    config.userCount = load.get("userCount", static_cast<Json::UInt64>(DEFAULT_LOAD_USER_COUNT)).asUInt64();
+    config.writeToDatabase = load.get("writeToDatabase", false).asBool();
+    config.firstOrderId = load.get("firstOrderId", DEFAULT_LOAD_FIRST_ORDER_ID).asUInt();
+    config.resultAddress = load.get("resultAddress", "").asString();
+    const Json::Value& midPrices = load["midPrices"];
+    for (const std::string& symbol : midPrices.getMemberNames()) {
+        config.midPrices[symbol] = parseMidPrice(symbol, midPrices[symbol].asString());
+    }
+
+    if (config.ratePerSecond <= 0 || config.producerThreads == 0 || config.durationSeconds <= 0 ||
+        config.priceSpreadTicks <= 0 || config.midVolatilityTicks < 0 || config.userCount == 0) {
+        throw std::runtime_error("load.ratePerSecond, load.producerThreads, load.durationSeconds, load.priceSpreadTicks and load.userCount must be positive");
+    }
+    if (config.cancelRatio < 0 || config.marketRatio < 0 || config.cancelRatio + config.marketRatio > 1) {
+        throw std::runtime_error("load.cancelRatio and load.marketRatio must be non-negative and sum to at most 1");
+    }
+    return config;
+}
+
+LoadGenerator::LoadGenerator(zmq::context_t& context, const std::string& orderServerAddress, const std::vector<Instrument>& instruments,
+                             WireFormat wireFormat, const LoadConfig& loadConfig, DbConnectionPool* connectionPool)
+        : context(context), orderServerAddress(orderServerAddress), instruments(instruments), wireFormat(wireFormat),
+          config(loadConfig), connectionPool(connectionPool), midTicks(new std::atomic<int64_t>[instruments.size()]),
+          orderIdCounter(0), running(false), receiving(false) {
+    if (instruments.empty()) {
+        throw std::runtime_error("Load generator needs at least one instrument");
+    }
+    for (size_t i = 0; i < instruments.size(); ++i) {
+        auto mid = config.midPrices.find(instruments[i].symbol);
+        Price midPrice = mid != config.midPrices.end() ? mid->second : parseFixed(DEFAULT_LOAD_MID_PRICE, PRICE_DECIMALS);
+        midTicks[i] = std::max<int64_t>(midPrice / instruments[i].tickSize, 1);
+    }
+}
+
+void LoadGenerator::run() {
+    firstOrderId = connectionPool ? getMaxOrderId() + 1 : config.firstOrderId;
+    orderIdCounter = firstOrderId;
+    LOG_INFO("Load generator starting: " + std::to_string(std::llround(config.ratePerSecond)) + " orders/s for " +
+             std::to_string(config.durationSeconds) + "s on " + std::to_string(config.producerThreads) +
+             " threads, first orderId " + std::to_string(firstOrderId));
+
+    running = true;
+    receiving = !config.resultAddress.empty();
+    std::thread receiver;
+    if (receiving) {
+        receiver = std::thread(&LoadGenerator::receiveResults, this);
+    }
+    std::vector<std::thread> producers;
+    for (size_t i = 0; i < config.producerThreads; ++i) {
+        producers.emplace_back(&LoadGenerator::produce, this, i);
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t second = 1; second <= config.durationSeconds; ++second) {
+        std::this_thread::sleep_until(start + std::chrono::seconds(second));
+        logProgress("progress", static_cast<double>(second));
+    }
+    for (auto& producer : producers) {
+        producer.join();
+    }
+    running = false;
+
+    if (receiver.joinable()) {
+        std::this_thread::sleep_for(RESULT_DRAIN_TIME);
+        receiving = false;
+        receiver.join();
+    }
+    logProgress("done", std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+}
+
+void LoadGenerator::produce(size_t producer) {
+    zmq::socket_t orderSocket(context, zmq::socket_type::push);
+    orderSocket.connect(orderServerAddress);
+
+    std::unique_ptr<BatchWriter> batchWriter;
+    DbConnection* dbConn = nullptr;
+    if (connectionPool) {
+        dbConn = connectionPool->getConnection();
+        batchWriter = std::make_unique<BatchWriter>(*dbConn);
+    }
+
+    std::random_device seed;
+    std::mt19937_64 rng(seed() + producer);
+    std::uniform_real_distribution<double> action(0.0, 1.0);
+    std::exponential_distribution<double> interArrival(config.ratePerSecond / config.producerThreads / 1e9);
+    std::normal_distribution<double> priceOffset(config.priceSpreadTicks / 2.0, static_cast<double>(config.priceSpreadTicks));
+    std::normal_distribution<double> midStep(0.0, static_cast<double>(config.midVolatilityTicks));
+    std::uniform_int_distribution<size_t> instrumentDistribution(0, instruments.size() - 1);
+    std::uniform_int_distribution<uint64_t> userDistribution(1, config.userCount);
+    std::uniform_int_distribution<FeeRate> feeRateDistribution(FEE_RATE_SCALE / 1000, FEE_RATE_SCALE * 5 / 1000);
+    double intervalNanos = 1e9 * config.producerThreads / config.ratePerSecond;
+
+    std::vector<std::pair<size_t, unsigned int>> recentOrders;  // (交易对下标, 订单号)
+    recentOrders.reserve(RECENT_ORDER_CAPACITY);
+    size_t recentCursor = 0;
+
+    // 开环：发送时刻只由到达过程决定，与撮合引擎的响应无关
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(config.durationSeconds);
+    Timestamp startTimestamp = nowTimestamp();
+    double offsetNanos = 0;
+    Order order;
+    while (running) {
+        offsetNanos += config.arrival == ArrivalProcess::CONSTANT ? intervalNanos : interArrival(rng);
+        auto due = start + std::chrono::nanoseconds(static_cast<int64_t>(offsetNanos));
+        if (due >= end) {
+            break;
+        }
+        if (due > std::chrono::steady_clock::now()) {
+            std::this_thread::sleep_until(due);
+        }
+
+        try {
+            double roll = action(rng);
+            if (roll < config.cancelRatio && !recentOrders.empty()) {
+                // 随机撤掉一笔最近的挂单，可能已经成交，走撤单拒绝路径
+                const auto& target = recentOrders[std::uniform_int_distribution<size_t>(0, recentOrders.size() - 1)(rng)];
+                zmq::message_t message = encodeToZmqMessage<CancelWireMessage>([&]() {
+                    return encodeCancelMessage(instruments[target.first].symbol, target.second);
+                });
+                orderSocket.send(message, zmq::send_flags::none);
+                cancelsSent.add();
+                continue;
+            }
+
+            size_t index = instrumentDistribution(rng);
+            const Instrument& instrument = instruments[index];
+            int64_t mid = midTicks[index].load(std::memory_order_relaxed);
+            if (config.midVolatilityTicks > 0) {
+                mid = std::max<int64_t>(mid + std::llround(midStep(rng)), config.priceSpreadTicks * 4);
+                midTicks[index].store(mid, std::memory_order_relaxed);
+            }
+            std::uniform_int_distribution<int64_t> lots(std::max<int64_t>(QUANTITY_SCALE / 10 / instrument.lotSize, 1),
+                                                        std::max<int64_t>(10 * QUANTITY_SCALE / instrument.lotSize, 1));
+
+            order.orderId = orderIdCounter.fetch_add(1, std::memory_order_relaxed);
+            order.userId = userDistribution(rng);
+            order.symbol = instrument.symbol;
+            order.orderSide = action(rng) < 0.5 ? OrderSide::BUY : OrderSide::SELL;
+            order.quantity = lots(rng) * instrument.lotSize;
+            order.feeRate = feeRateDistribution(rng);
+            order.filledQuantity = 0;
+            order.status = OrderStatus::INITIAL;
+            order.timeInForce = TimeInForce::GTC;
+            order.createTime = startTimestamp + std::chrono::duration_cast<std::chrono::nanoseconds>(due - start);
+            order.updateTime = order.createTime;
+            if (roll < config.cancelRatio + config.marketRatio) {
+                order.orderType = OrderType::MARKET;
+                order.price = 0;
+            } else {
+                // 偏移均值为半个标准差，约三成限价单越过中间价成为主动单，其余挂在中间价两侧
+                int64_t offset = std::llround(priceOffset(rng));
+                int64_t ticks = order.orderSide == OrderSide::BUY ? mid - offset : mid + offset;
+                order.orderType = OrderType::LIMIT;
+                order.price = std::max<int64_t>(ticks, 1) * instrument.tickSize;
+                if (recentOrders.size() < RECENT_ORDER_CAPACITY) {
+                    recentOrders.emplace_back(index, order.orderId);
+                } else {
+                    recentOrders[recentCursor++ % RECENT_ORDER_CAPACITY] = {index, order.orderId};
+                }
+            }
+
+            if (batchWriter) {
+                batchWriter->addOrder(order);
+                if (batchWriter->orderCount() >= BatchWriter::MAX_ROWS_PER_STATEMENT) {
+                    batchWriter->flush();
+                }
+            }
+
+            if (wireFormat == WireFormat::BINARY) {
+                zmq::message_t message = encodeToZmqMessage<OrderWireMessage>([&order]() {
+                    return encodeOrderMessage(WireMessageType::NEW_ORDER, order);
+                });
+                orderSocket.send(message, zmq::send_flags::none);
+            } else {
+                Json::Value message;
+                message["type"] = "ORDER";
+                message["order"] = serializeOrder(order);
+                zmq::message_t zmqMessage = toZmqMessage(serializeMessage(message));
+                orderSocket.send(zmqMessage, zmq::send_flags::none);
+            }
+            ordersSent.add();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Load producer " + std::to_string(producer) + " failed to send: " + std::string(e.what()));
+        }
+    }
+
+    if (batchWriter) {
+        batchWriter->flush();
+        batchWriter.reset();    // 预编译语句须在归还连接前关闭
+        connectionPool->returnConnection(dbConn);
+    }
+}
+
+void LoadGenerator::receiveResults() {
+    zmq::socket_t resultSocket(context, zmq::socket_type::pull);
+    resultSocket.set(zmq::sockopt::rcvtimeo, RESULT_RECEIVE_TIMEOUT_MS);
+    resultSocket.connect(config.resultAddress);
+
+    zmq::message_t message;
+    while (receiving) {
+        try {
+            if (!resultSocket.recv(message, zmq::recv_flags::none)) {
+                continue;
+            }
+            resultsReceived.add();
+            // 只解析二进制结果；JSON 调试模式下只计数
+            if (!isBinaryMessage(message.data(), message.size())) {
+                continue;
+            }
+            switch (readWireHeader(message.data(), message.size())) {
+                case WireMessageType::UNMATCHED_ORDER:
+                case WireMessageType::EXPIRED:
+                    recordAcknowledgement(decodeWireMessage<OrderWireMessage>(message.data(), message.size()).order);
+                    break;
+                case WireMessageType::TRADE: {
+                    // 被动方挂单时已经确认过，这里只会记下主动方
+                    TradeWireMessage trade = decodeWireMessage<TradeWireMessage>(message.data(), message.size());
+                    recordAcknowledgement(trade.buyOrder);
+                    recordAcknowledgement(trade.sellOrder);
+                    break;
+                }
+                default:
+                    break;
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Load result receiver error: " + std::string(e.what()));
+        }
+    }
+}
+
+void LoadGenerator::recordAcknowledgement(const WireOrder& order) {
+    // 只统计本次压测发出的订单，每笔只取第一条结果
+    if (order.orderId < firstOrderId) {
+        return;
+    }
+    size_t index = order.orderId - firstOrderId;
+    if (index >= acknowledged.size()) {
+        acknowledged.resize(std::max(index + 1, acknowledged.size() * 2));
+    }
+    if (acknowledged[index]) {
+        return;
+    }
+    acknowledged[index] = true;
+    int64_t latency = toNanos(nowTimestamp()) - order.createTime;
+    roundTripLatency.record(static_cast<uint64_t>(std::max<int64_t>(latency, 0)));
+}
+
+void LoadGenerator::logProgress(const char* label, double seconds) {
+    uint64_t orders = ordersSent.value();
+    uint64_t cancels = cancelsSent.value();
+    std::string line = std::string("Load ") + label + ": " + std::to_string(static_cast<int64_t>(seconds)) + "s, orders " +
+                       std::to_string(orders) + ", cancels " + std::to_string(cancels) + ", rate " +
+                       std::to_string(static_cast<int64_t>((orders + cancels) / std::max(seconds, 1e-9))) + "/s";
+    if (!config.resultAddress.empty()) {
+        HistogramSnapshot latency = roundTripLatency.snapshot();
+        line += ", results " + std::to_string(resultsReceived.value()) + ", acked " + std::to_string(latency.count) +
+                ", round trip us p50 " + std::to_string(latency.percentile(50) / 1000) +
+                " p99 " + std::to_string(latency.percentile(99) / 1000) +
+                " p99.9 " + std::to_string(latency.percentile(99.9) / 1000) +
+                " max " + std::to_string(latency.max / 1000);
+    }
+    LOG_INFO(line);
+}
+
+unsigned int LoadGenerator::getMaxOrderId() {
+    DbConnection* dbConn = connectionPool->getConnection();
+    unsigned int maxOrderId = config.firstOrderId;
+    try {
+        dbConn->queryRows("SELECT MAX(order_id) FROM orders", [&maxOrderId](const DbRow& row) {
+            if (!row.isNull(0)) {
+                maxOrderId = static_cast<unsigned int>(row.asUInt64(0));
+            }
+        });
+    } catch (const std::exception& e) {
+        LOG_WARN("Failed to read max order id, starting from load.firstOrderId: " + std::string(e.what()));
+    }
+    connectionPool->returnConnection(dbConn);
+    return maxOrderId;
+}
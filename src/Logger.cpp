@@ -0,0 +1,215 @@
+#include "Logger.h"
+#include <cstring>
+#include <ctime>
+
+namespace {
+    constexpr size_t WRITE_BATCH_BYTES = 64 * 1024;
+
+    const char* levelString(LogLevel level) {
+        switch (level) {
+            case DEBUG: return "DEBUG";
+            case INFO: return "INFO";
+            case WARN: return "WARN";
+            case ERROR: return "ERROR";
+            default: return "UNKNOWN";
+        }
+    }
+
+    const char* baseName(const char* file) {
+        const char* slash = std::strrchr(file, '/');
+        const char* backslash = std::strrchr(file, '\\');
+        const char* last = slash > backslash ? slash : backslash;
+        return last != nullptr ? last + 1 : file;
+    }
+}
+
+bool Logger::ThreadBuffer::tryPush(Record& record) {
+    size_t currentTail = tail.load(std::memory_order_relaxed);
+    if (currentTail - head.load(std::memory_order_acquire) >= CAPACITY) {
+        return false;
+    }
+    records[currentTail & (CAPACITY - 1)] = std::move(record);
+    tail.store(currentTail + 1, std::memory_order_release);
+    return true;
+}
+
+bool Logger::ThreadBuffer::tryPop(Record& record) {
+    size_t currentHead = head.load(std::memory_order_relaxed);
+    if (currentHead == tail.load(std::memory_order_acquire)) {
+        return false;
+    }
+    // 交换而不是移动，消息字符串的内存在写线程上释放
+    std::swap(record, records[currentHead & (CAPACITY - 1)]);
+    head.store(currentHead + 1, std::memory_order_release);
+    return true;
+}
+
+Logger::Logger()
+        : currentLogLevel(INFO), dropped(0), running(true), cachedSecond(-1),
+          flushRequests(0), flushesDone(0) {
+    cachedTimestamp[0] = '\0';
+    pending.reserve(WRITE_BATCH_BYTES * 2);
+    writerThread = std::thread(&Logger::writerLoop, this);
+}
+
+Logger::~Logger() {
+    running.store(false, std::memory_order_release);
+    if (writerThread.joinable()) {
+        writerThread.join();
+    }
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (logFile.is_open()) {
+        logFile.close();
+    }
+}
+
+void Logger::init(const std::string& logFilePath, LogLevel level) {
+    {
+        std::lock_guard<std::mutex> lock(fileMutex);
+        if (!logFile.is_open()) {
+            logFile.open(logFilePath, std::ios_base::app); // 以追加模式打开文件
+            if (!logFile.is_open()) {
+                std::cerr << "Failed to open log file: " << logFilePath << std::endl;
+                return;
+            }
+        }
+    }
+    setLogLevel(level);
+}
+
+Logger::ThreadBuffer& Logger::threadBuffer() {
+    thread_local BufferHandle handle;
+    if (!handle.buffer) {
+        handle.buffer = std::make_shared<ThreadBuffer>();
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        buffers.push_back(handle.buffer);
+    }
+    return *handle.buffer;
+}
+
+void Logger::log(std::string message, LogLevel level, const char* file, int line) {
+    if (level < currentLogLevel.load(std::memory_order_relaxed)) {
+        return;
+    }
+
+    Record record;
+    record.timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    record.level = level;
+    record.file = file;
+    record.line = line;
+    record.message = std::move(message);
+
+    ThreadBuffer& buffer = threadBuffer();
+    if (buffer.tryPush(record)) {
+        return;
+    }
+    // 缓冲区满：DEBUG / INFO 直接丢弃并计数，WARN / ERROR 等待写线程腾出空间
+    if (level < WARN) {
+        dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    while (!buffer.tryPush(record)) {
+        std::this_thread::yield();
+    }
+}
+
+void Logger::flush() {
+    uint64_t ticket = flushRequests.fetch_add(1) + 1;
+    while (flushesDone.load() < ticket && writerThread.joinable()) {
+        std::this_thread::yield();
+    }
+}
+
+void Logger::writerLoop() {
+    uint64_t reportedDrops = 0;
+    while (true) {
+        uint64_t requested = flushRequests.load();
+        bool stopping = !running.load(std::memory_order_acquire);
+
+        // 一直取到所有缓冲区为空，再批量写出
+        size_t drained = 0;
+        for (size_t count; (count = drainBuffers()) > 0; ) {
+            drained += count;
+        }
+
+        uint64_t drops = dropped.load(std::memory_order_relaxed);
+        if (drops != reportedDrops) {
+            pending += "[logger] dropped " + std::to_string(drops - reportedDrops) + " messages, buffer full\n";
+            reportedDrops = drops;
+        }
+
+        writeOut();
+        flushesDone.store(requested);
+        if (stopping) {
+            break;
+        }
+        if (drained == 0) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+}
+
+size_t Logger::drainBuffers() {
+    std::vector<std::shared_ptr<ThreadBuffer>> snapshot;
+    {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        snapshot = buffers;
+    }
+
+    size_t count = 0;
+    Record record;
+    for (const auto& buffer : snapshot) {
+        while (buffer->tryPop(record)) {
+            formatRecord(record);
+            ++count;
+            if (pending.size() >= WRITE_BATCH_BYTES) {
+                writeOut();
+            }
+        }
+    }
+
+    // 回收已退出且取空的线程缓冲区
+    std::lock_guard<std::mutex> lock(buffersMutex);
+    for (auto it = buffers.begin(); it != buffers.end(); ) {
+        if ((*it)->retired.load(std::memory_order_acquire) && (*it)->empty()) {
+            it = buffers.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return count;
+}
+
+void Logger::formatRecord(const Record& record) {
+    int64_t second = record.timestamp / 1000000000;
+    int millis = static_cast<int>((record.timestamp / 1000000) % 1000);
+
+    // 同一秒内复用已格式化的日期时间，只追加毫秒
+    if (second != cachedSecond) {
+        std::time_t time = static_cast<std::time_t>(second);
+        std::tm localTime;
+        localtime_r(&time, &localTime);
+        std::strftime(cachedTimestamp, sizeof(cachedTimestamp), "%Y-%m-%d %H:%M:%S", &localTime);
+        cachedSecond = second;
+    }
+
+    char prefix[96];
+    int length = std::snprintf(prefix, sizeof(prefix), "[%s.%03d] [%s] [", cachedTimestamp, millis, levelString(record.level));
+    pending.append(prefix, static_cast<size_t>(length));
+    pending += baseName(record.file);
+    pending += ':';
+    pending += std::to_string(record.line);
+    pending += "] ";
+    pending += record.message;
+    pending += '\n';
+}
+
+void Logger::writeOut() {
+    std::lock_guard<std::mutex> lock(fileMutex);
+    if (!pending.empty() && logFile.is_open()) {
+        logFile.write(pending.data(), static_cast<std::streamsize>(pending.size()));
+        logFile.flush();
+    }
+    pending.clear();
+}
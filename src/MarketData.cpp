@@ -0,0 +1,55 @@
+#include "MarketData.h"
+#include "Serialization.h"
+
+WireMessageType readMarketDataType(const void* data, size_t size) {
+    if (isBinaryMessage(data, size)) {
+        return readWireHeader(data, size);
+    }
+
+    std::string type = deserializeMessage(static_cast<const char*>(data), size)["type"].asString();
+    for (WireMessageType candidate : {WireMessageType::BOOK_SNAPSHOT, WireMessageType::BOOK_DELTA, WireMessageType::TRADE_PRINTS}) {
+        if (type == wireMessageTypeToString(candidate)) {
+            return candidate;
+        }
+    }
+    throw std::runtime_error("Unknown market data message type: " + type);
+}
+
+std::vector<TradePrint> parseTradePrintsMessage(const void* data, size_t size) {
+    if (isBinaryMessage(data, size)) {
+        return decodeTradePrintsMessage(data, size);
+    }
+
+    Json::Value root = deserializeMessage(static_cast<const char*>(data), size);
+    const Json::Value& array = root["trades"];
+    std::vector<TradePrint> trades;
+    trades.reserve(array.size());
+    for (const Json::Value& entry : array) {
+        TradePrint trade;
+        trade.tradeId = entry["tradeId"].asUInt64();
+        trade.takerSide = stringToOrderSide(entry["side"].asString());
+        trade.price = convertStringToFixed(entry, "price", PRICE_DECIMALS);
+        trade.quantity = convertStringToFixed(entry, "quantity", QUANTITY_DECIMALS);
+        trade.tradeTime = timestampFromJson(entry["time"]);
+        trades.push_back(trade);
+    }
+    return trades;
+}
+
+std::string serializeTradePrints(const std::string& symbol, const std::vector<TradePrint>& trades) {
+    Json::Value message;
+    message["type"] = wireMessageTypeToString(WireMessageType::TRADE_PRINTS);
+    message["symbol"] = symbol;
+    Json::Value array(Json::arrayValue);
+    for (const TradePrint& trade : trades) {
+        Json::Value entry;
+        entry["tradeId"] = static_cast<Json::UInt64>(trade.tradeId);
+        entry["side"] = orderSideToString(trade.takerSide);
+        entry["price"] = formatFixed(trade.price, PRICE_DECIMALS);
+        entry["quantity"] = formatFixed(trade.quantity, QUANTITY_DECIMALS);
+        entry["time"] = timestampToJson(trade.tradeTime);
+        array.append(entry);
+    }
+    message["trades"] = array;
+    return serializeMessage(message);
+}
@@ -1,210 +1,1121 @@
 #include "MatchingEngine.h"
 #include "Serialization.h"
+#include "MarketData.h"
+#include "ThreadAffinity.h"
+#include <filesystem>
 #include <iostream>
+#include <limits>
 #include <string>
 #include <zmq.hpp>
 
-MatchingEngine::MatchingEngine(zmq::socket_t& orderSocket, zmq::socket_t& resultSocket, zmq::socket_t& bookSocket)
-        : orderSocket(orderSocket), resultSocket(resultSocket), bookSocket(bookSocket), running(false) {
-    std::chrono::steady_clock::time_point lastPublishTime;
+namespace {
+    // 自 2024-01-01 UTC 起的微秒数，52 位序号可用约 140 年
+    // 只要平均每微秒成交不超过一笔，重启后派生的序号就不会落到已分配的范围内
+    constexpr int64_t TRADE_SEQUENCE_EPOCH_MICROS = 1704067200LL * 1000000;
+
+    uint64_t tradeSequenceSeed() {
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+        return static_cast<uint64_t>(std::max<int64_t>(now - TRADE_SEQUENCE_EPOCH_MICROS, 0));
+    }
+
+    // 主动单可接受的最差成交价：市价买单不设上限，市价卖单不设下限
+    Price takerLimitPrice(const Order& order) {
+        if (order.orderType != OrderType::MARKET) {
+            return order.price;
+        }
+        return order.orderSide == OrderSide::BUY ? std::numeric_limits<Price>::max() : 0;
+    }
+
+    // 未成交部分是否挂进订单簿：市价单和 IOC、FOK 的剩余部分直接撤销
+    bool restsRemainder(const Order& order) {
+        return order.orderType == OrderType::LIMIT &&
+               (order.timeInForce == TimeInForce::GTC || order.timeInForce == TimeInForce::POST_ONLY);
+    }
+
+    // 新订单的类型、有效方式和 tick / lot 校验，单条下单和批量下单共用
+    bool isValidNewOrder(const Instrument& instrument, unsigned int orderId, OrderSide orderSide, OrderType orderType,
+                         TimeInForce timeInForce, Price price, Quantity quantity) {
+        if (orderSide == OrderSide::UNKNOWN) {
+            LOG_ERROR("processOrder rejected order with unknown side. OrderId: " + std::to_string(orderId));
+            return false;
+        }
+        if (orderType == OrderType::UNKNOWN || timeInForce == TimeInForce::UNKNOWN ||
+            (orderType == OrderType::MARKET && timeInForce == TimeInForce::POST_ONLY)) {
+            LOG_ERROR("processOrder rejected order with unsupported type. OrderId: " + std::to_string(orderId) +
+                      " type: " + orderTypeToString(orderType) + " timeInForce: " + timeInForceToString(timeInForce));
+            return false;
+        }
+        // 市价单不看价格，只校验数量
+        if ((orderType != OrderType::MARKET && !instrument.isValidPrice(price)) || !instrument.isValidQuantity(quantity)) {
+            LOG_ERROR("processOrder rejected order off tick/lot. OrderId: " + std::to_string(orderId) +
+                      " price: " + formatFixed(price, PRICE_DECIMALS) + " quantity: " + formatFixed(quantity, QUANTITY_DECIMALS));
+            return false;
+        }
+        return true;
+    }
+
+    MassAction stringToMassAction(const std::string& str) {
+        if (str == "NEW") return MassAction::NEW;
+        if (str == "CANCEL") return MassAction::CANCEL;
+        if (str == "AMEND") return MassAction::AMEND;
+        throw std::invalid_argument("Unknown mass order action: " + str);
+    }
+
+    // JSON 调试模式的批量下单：{"type":"MASS_ORDER","symbol":...,"userId":...,"orders":[{"action":"NEW",...},...]}
+    // 各条指令的字段名与订单相同，AMEND 的 price / quantity 缺省时沿用原值
+    void readJsonMassOrder(const Json::Value& message, Order& common, std::vector<MassInstruction>& instructions) {
+        const Json::Value& orders = message["orders"];
+        if (orders.size() > MAX_MASS_ORDER_INSTRUCTIONS) {
+            throw std::runtime_error("Too many instructions in MASS_ORDER: " + std::to_string(orders.size()));
+        }
+        common.symbol = message.get("symbol", DEFAULT_SYMBOL).asString();
+        common.userId = message["userId"].asUInt64();
+        common.createTime = message.isMember("createTime") ? timestampFromJson(message["createTime"]) : nowTimestamp();
+        instructions.resize(orders.size());
+        for (Json::ArrayIndex i = 0; i < orders.size(); ++i) {
+            const Json::Value& entry = orders[i];
+            MassInstruction& instruction = instructions[i];
+            instruction.action = stringToMassAction(entry["action"].asString());
+            instruction.orderId = entry["orderId"].asUInt();
+            instruction.orderSide = stringToOrderSide(entry.get("orderSide", "").asString());
+            instruction.orderType = stringToOrderType(entry.get("orderType", "LIMIT").asString());
+            instruction.timeInForce = stringToTimeInForce(entry.get("timeInForce", "GTC").asString());
+            instruction.price = entry.isMember("price") ? convertStringToFixed(entry, "price", PRICE_DECIMALS) : 0;
+            instruction.quantity = entry.isMember("quantity") ? convertStringToFixed(entry, "quantity", QUANTITY_DECIMALS) : 0;
+            instruction.feeRate = entry.isMember("feeRate") ? convertStringToFixed(entry, "feeRate", FEE_RATE_DECIMALS) : 0;
+        }
+    }
+}
+
+EngineMetrics::EngineMetrics()
+        : commandsDecoded(MetricsRegistry::getInstance().counter("engine_commands_decoded_total", "Commands decoded and queued for matching")),
+          commandsRejected(MetricsRegistry::getInstance().counter("engine_commands_rejected_total", "Inputs dropped by the decoder")),
+          commandsMatched(MetricsRegistry::getInstance().counter("engine_commands_matched_total", "Commands executed by the matcher")),
+          trades(MetricsRegistry::getInstance().counter("engine_trades_total", "Trades executed")),
+          selfTradesPrevented(MetricsRegistry::getInstance().counter("engine_self_trades_prevented_total", "Crosses between orders of the same user that were not traded")),
+          resultsSent(MetricsRegistry::getInstance().counter("engine_results_sent_total", "Result messages sent to persistence")),
+          marketDataSent(MetricsRegistry::getInstance().counter("engine_market_data_sent_total", "Depth and trade print messages published")),
+          decodeLatency(MetricsRegistry::getInstance().latencyHistogram("engine_decode_seconds", "Time to decode and validate one input")),
+          matchLatency(MetricsRegistry::getInstance().latencyHistogram("engine_match_seconds", "Matcher time per command")),
+          batchSize(MetricsRegistry::getInstance().sizeHistogram("engine_batch_commands", "Commands per matcher batch")),
+          massOrderSize(MetricsRegistry::getInstance().sizeHistogram("engine_mass_order_instructions", "Instructions per mass order message")),
+          encodeLatency(MetricsRegistry::getInstance().latencyHistogram("engine_encode_seconds", "Time to encode one result message")),
+          sendLatency(MetricsRegistry::getInstance().latencyHistogram("engine_send_seconds", "Time to send one batch of result messages")) {
+}
+
+SymbolBook::SymbolBook(const Instrument& instrument, const EngineConfig& engineConfig)
+        : instrument(instrument), orderBook(instrument.tickSize, engineConfig.orderPoolSize, engineConfig.priceWindowLevels),
+          depthPublisher(engineConfig.depthLevels) {
+    pendingTrades.reserve(engineConfig.orderBatchSize);
+    if (!engineConfig.journalDir.empty()) {
+        std::filesystem::create_directories(engineConfig.journalDir);
+        journal = std::make_unique<Journal>(engineConfig.journalDir + "/" + instrument.symbol + ".journal");
+        snapshotPath = engineConfig.journalDir + "/" + instrument.symbol + ".snapshot";
+    }
+}
+
+MatchingEngine::MatchingEngine(zmq::socket_t& orderSocket, zmq::socket_t& resultSocket, zmq::socket_t& bookSocket,
+                               const std::vector<Instrument>& instruments, const EngineConfig& engineConfig,
+                               const PipelineCpus& cpus)
+        : orderSocket(orderSocket), resultSocket(resultSocket), bookSocket(bookSocket), running(false), matcherDone(false),
+          cpus(cpus), wireFormat(engineConfig.wireFormat), selfTradePrevention(engineConfig.selfTradePrevention),
+          commands(engineConfig.pipelineQueueSize), results(engineConfig.pipelineQueueSize),
+          marketData(std::max<size_t>(MIN_MARKET_DATA_QUEUE_SIZE, instruments.size() * 4)),
+          orderBatchSize(engineConfig.orderBatchSize),
+          maxBatchDelay(engineConfig.maxBatchDelayMicros),
+          depthSnapshotInterval(engineConfig.depthSnapshotIntervalMs),
+          snapshotInterval(engineConfig.snapshotInterval), journalSync(engineConfig.journalSync), replaying(false), journalSuspended(false) {
+    pendingResults.reserve(orderBatchSize);
+    // 没有订单时也按快照间隔醒来，保证行情快照按时发布
+    orderSocket.set(zmq::sockopt::rcvtimeo, static_cast<int>(engineConfig.depthSnapshotIntervalMs));
+    for (const Instrument& instrument : instruments) {
+        books.push_back(std::make_unique<SymbolBook>(instrument, engineConfig));
+        if (books.back()->journal) {
+            recoverBook(*books.back());
+        } else {
+            // 没有日志可回放时，从启动时刻派生成交序号，保证重启后的成交号大于此前分配过的
+            books.back()->tradeSequence = tradeSequenceSeed();
+        }
+    }
+    if (!engineConfig.journalDir.empty()) {
+        snapshotWriter = std::make_unique<SnapshotWriter>(flushesSent);
+    }
+}
+
+uint64_t MatchingEngine::allocationCount() const {
+    uint64_t count = 0;
+    for (const auto& book : books) {
+        count += book->orderBook.allocationCount();
+    }
+    return count;
+}
+
+size_t MatchingEngine::restingOrderCount() const {
+    size_t count = 0;
+    for (const auto& book : books) {
+        count += book->orderBook.orderCount();
+    }
+    return count;
+}
+
+bool MatchingEngine::restoreOrder(Order& order) {
+    SymbolBook* book = findBook(order.symbol);
+    if (book == nullptr) {
+        return false;
+    }
+    if (!restsRemainder(order) || order.filledQuantity >= order.quantity || order.price <= 0) {
+        LOG_WARN("Skipped restoring order that cannot rest. OrderId: " + std::to_string(order.orderId));
+        return false;
+    }
+    return addOrderToBook(*book, order) != NULL_HANDLE;
+}
+
+bool MatchingEngine::submit(const void* data, size_t size) {
+    if (!decodeCommand(data, size, directCommand)) {
+        return false;
+    }
+    executeCommand(directCommand);
+    return true;
+}
+
+void MatchingEngine::endBatch() {
+    // 本批输入落盘后才放行本批结果，已发布的结果都能由日志重建
+    syncJournals();
+    emitFlush();
+    publishMarketData();
+    takeSnapshots(snapshotInterval);
+}
+
+size_t MatchingEngine::discardOutput(const std::function<void(const ResultEvent&)>& onResult) {
+    size_t count = 0;
+    for (const ResultEvent& event : recoveredResults) {
+        if (event.type == ResultEventType::MESSAGE) {
+            if (onResult) {
+                onResult(event);
+            }
+            ++count;
+        }
+    }
+    std::vector<ResultEvent>().swap(recoveredResults);
+    while (ResultEvent* event = results.front()) {
+        if (event->type == ResultEventType::MESSAGE) {
+            if (onResult) {
+                onResult(*event);
+            }
+            ++count;
+        } else {
+            flushesSent.fetch_add(1, std::memory_order_release);
+        }
+        results.pop();
+    }
+    while (MarketDataEvent* event = marketData.front()) {
+        event->trades.clear();
+        marketData.pop();
+    }
+    return count;
 }
 
 void MatchingEngine::start() {
     LOG_INFO("MatchingEngine starting.");
     running = true;
+    matcherDone = false;
+    decoderThread = std::thread(&MatchingEngine::decodeLoop, this);
+    publisherThread = std::thread(&MatchingEngine::publishLoop, this);
+    if (cpus.matcher >= 0 && !pinCurrentThreadToCpu(cpus.matcher)) {
+        LOG_WARN("Failed to pin matcher stage to CPU " + std::to_string(cpus.matcher));
+    }
+
     run();
-    LOG_INFO("MatchingEngine started.");
+
+    // 解码线程退出后取空剩余命令，再让发布线程发完剩余结果
+    decoderThread.join();
+    while (processBatch()) {
+    }
+    matcherDone = true;
+    publisherThread.join();
+    finishSnapshots();
+    LOG_INFO("MatchingEngine stopped.");
 }
 
 void MatchingEngine::stop() {
     running = false;
 }
 
-void MatchingEngine::run() {
-    LOG_INFO("MatchingEngine run.");
+void MatchingEngine::decodeLoop() {
+    if (cpus.decoder >= 0 && !pinCurrentThreadToCpu(cpus.decoder)) {
+        LOG_WARN("Failed to pin decoder stage to CPU " + std::to_string(cpus.decoder));
+    }
+    zmq::message_t orderMessage;
+    SpinWait backoff;
     while (running) {
         try {
-            zmq::message_t orderMessage;
             auto result = orderSocket.recv(orderMessage, zmq::recv_flags::none);
-            if (result.has_value()) {
-                std::string orderData(static_cast<char*>(orderMessage.data()), orderMessage.size());
-                LOG_DEBUG("Order received: " + orderData);
-                if (!orderData.empty()) {
-                    Json::Value message = deserializeMessage(orderData);
-                    Json::Value nestedOrderMessage = deserializeMessage(message["order"].asString());
-                    Order order = deserializeOrder(nestedOrderMessage);
-                    processOrder(order);
-                }
+
+            // 撮合跟不上时在这里等待，背压经 ZeroMQ 的高水位传回上游
+            EngineCommand* command;
+            while ((command = commands.claim()) == nullptr && running) {
+                backoff.wait();
+            }
+            backoff.reset();
+            if (command == nullptr) {
+                break;
+            }
+
+            if (!result.has_value()) {
+                // 接收超时：让撮合线程发布到期的行情快照
+                command->type = EngineCommandType::TICK;
+                commands.push();
             } else {
-                LOG_ERROR("No message received.");
+                auto decodeStart = std::chrono::steady_clock::now();
+                bool decoded = decodeCommand(orderMessage.data(), orderMessage.size(), *command);
+                metrics.decodeLatency.record(elapsedNanos(decodeStart, std::chrono::steady_clock::now()));
+                if (decoded) {
+                    commands.push();
+                    metrics.commandsDecoded.add();
+                } else {
+                    metrics.commandsRejected.add();
+                }
             }
         } catch (const zmq::error_t& e) {
             LOG_ERROR("ZeroMQ error: " + std::string(e.what()));
+        }
+    }
+}
+
+bool MatchingEngine::decodeCommand(const void* data, size_t size, EngineCommand& command) {
+    // 单条消息出错只丢弃该条，不影响其它订单
+    try {
+        if (isBinaryMessage(data, size)) {
+            if (!decodeBinaryCommand(data, size, command)) {
+                return false;
+            }
+        } else {
+            // JSON 调试模式，直接在消息缓冲区上解析
+            const char* orderData = static_cast<const char*>(data);
+            LOG_DEBUG("Order received: " + std::string(orderData, size));
+            if (size == 0) {
+                return false;
+            }
+
+            Json::Value message = deserializeMessage(orderData, size);
+            std::string messageType = message["type"].asString();
+            Order& order = command.order;
+            if (messageType == "BOOK_SNAPSHOT_REQUEST") {
+                command.type = EngineCommandType::BOOK_SNAPSHOT_REQUEST;
+                order.symbol = message.get("symbol", DEFAULT_SYMBOL).asString();
+            } else if (messageType == "CANCEL") {
+                command.type = EngineCommandType::CANCEL;
+                order.symbol = message.get("symbol", DEFAULT_SYMBOL).asString();
+                order.orderId = message["orderId"].asUInt();
+            } else if (messageType == "CANCEL_ALL") {
+                // symbol 缺省时撤销所有交易对
+                command.type = EngineCommandType::CANCEL_ALL;
+                order.symbol = message.get("symbol", "").asString();
+                order.userId = message["userId"].asUInt64();
+            } else if (messageType == "MASS_ORDER") {
+                command.type = EngineCommandType::MASS_ORDER;
+                readJsonMassOrder(message, order, command.instructions);
+            } else if (messageType == "AMEND") {
+                // price / quantity 缺省时沿用原值
+                command.type = EngineCommandType::AMEND;
+                order.symbol = message.get("symbol", DEFAULT_SYMBOL).asString();
+                order.orderId = message["orderId"].asUInt();
+                order.price = message.isMember("price") ? convertStringToFixed(message, "price", PRICE_DECIMALS) : 0;
+                order.quantity = message.isMember("quantity") ? convertStringToFixed(message, "quantity", QUANTITY_DECIMALS) : 0;
+            } else {
+                command.type = EngineCommandType::NEW_ORDER;
+                order = deserializeOrder(deserializeEmbeddedMessage(message["order"]));
+            }
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error processing order message: " + std::string(e.what()));
+        return false;
+    }
+    return resolveCommand(command);
+}
+
+bool MatchingEngine::decodeBinaryCommand(const void* data, size_t size, EngineCommand& command) {
+    WireMessageType type = readWireHeader(data, size);
+    Order& order = command.order;
+    switch (type) {
+        case WireMessageType::NEW_ORDER:
+            command.type = EngineCommandType::NEW_ORDER;
+            order = fromWireOrder(decodeWireMessage<OrderWireMessage>(data, size).order);
+            return true;
+        case WireMessageType::CANCEL: {
+            CancelWireMessage message = decodeWireMessage<CancelWireMessage>(data, size);
+            command.type = EngineCommandType::CANCEL;
+            order.symbol = readWireSymbol(data, size);
+            order.orderId = message.orderId;
+            return true;
+        }
+        case WireMessageType::CANCEL_ALL: {
+            CancelAllWireMessage message = decodeWireMessage<CancelAllWireMessage>(data, size);
+            command.type = EngineCommandType::CANCEL_ALL;
+            order.symbol = readWireSymbol(data, size);
+            order.userId = message.userId;
+            return true;
+        }
+        case WireMessageType::MASS_ORDER:
+            command.type = EngineCommandType::MASS_ORDER;
+            decodeMassOrderMessage(data, size, order, command.instructions);
+            return true;
+        case WireMessageType::AMEND: {
+            AmendWireMessage message = decodeWireMessage<AmendWireMessage>(data, size);
+            command.type = EngineCommandType::AMEND;
+            order.symbol = readWireSymbol(data, size);
+            order.orderId = message.orderId;
+            order.price = message.price;
+            order.quantity = message.quantity;
+            return true;
+        }
+        case WireMessageType::BOOK_SNAPSHOT_REQUEST:
+            command.type = EngineCommandType::BOOK_SNAPSHOT_REQUEST;
+            order.symbol = readWireSymbol(data, size);
+            return true;
+        default:
+            LOG_ERROR("Unexpected wire message type on order socket: " + std::to_string(static_cast<int>(type)));
+            return false;
+    }
+}
+
+bool MatchingEngine::resolveCommand(EngineCommand& command) {
+    // 交易对查找和 tick / lot 校验只读交易对参数，放在解码阶段完成
+    const Order& order = command.order;
+    command.book = findBook(order.symbol);
+    switch (command.type) {
+        case EngineCommandType::NEW_ORDER:
+            if (command.book == nullptr) {
+                LOG_ERROR("processOrder rejected order for unknown symbol. OrderId: " + std::to_string(order.orderId) + " symbol: " + order.symbol);
+                return false;
+            }
+            return isValidNewOrder(command.book->instrument, order.orderId, order.orderSide, order.orderType, order.timeInForce,
+                                   order.price, order.quantity);
+        case EngineCommandType::MASS_ORDER:
+            if (command.book == nullptr) {
+                LOG_ERROR("Mass order rejected for unknown symbol: " + order.symbol + " userId: " + std::to_string(order.userId));
+                return false;
+            }
+            if (command.instructions.empty()) {
+                LOG_WARN("Mass order without instructions ignored. userId: " + std::to_string(order.userId));
+                return false;
+            }
+            // 任何一条指令不合法时整条消息丢弃，其余指令也不执行
+            for (const MassInstruction& instruction : command.instructions) {
+                if (instruction.action != MassAction::NEW) {
+                    continue;
+                }
+                if (!isValidNewOrder(command.book->instrument, instruction.orderId, instruction.orderSide, instruction.orderType,
+                                     instruction.timeInForce, instruction.price, instruction.quantity)) {
+                    return false;
+                }
+            }
+            return true;
+        case EngineCommandType::BOOK_SNAPSHOT_REQUEST:
+            if (command.book == nullptr) {
+                LOG_WARN("Book snapshot requested for unknown symbol: " + order.symbol);
+                return false;
+            }
+            return true;
+        case EngineCommandType::CANCEL_ALL:
+            if (command.book == nullptr && !order.symbol.empty()) {
+                LOG_WARN("Cancel-all requested for unknown symbol: " + order.symbol + " userId: " + std::to_string(order.userId));
+                return false;
+            }
+            return true;
+        default:
+            // 撤单、改单的未知交易对由撮合阶段回复拒绝
+            return true;
+    }
+}
+
+SymbolBook* MatchingEngine::findBook(const std::string& symbol) {
+    for (const auto& book : books) {
+        if (book->instrument.symbol == symbol) {
+            return book.get();
+        }
+    }
+    return nullptr;
+}
+
+void MatchingEngine::run() {
+    LOG_INFO("MatchingEngine run.");
+    SpinWait idle;
+    while (running) {
+        try {
+            if (processBatch()) {
+                idle.reset();
+            } else {
+                idle.wait();
+            }
         } catch (const std::exception& e) {
             LOG_ERROR("Error in MatchingEngine run loop: " + std::string(e.what()));
         }
     }
 }
 
-void MatchingEngine::processOrder(Order& order) {
-    auto start = std::chrono::high_resolution_clock::now();
+bool MatchingEngine::processBatch() {
+    EngineCommand* command = commands.front();
+    if (command == nullptr) {
+        return false;
+    }
 
-    // 处理撮合订单（后续还可以处理订单取消的情况）
-    if (order.orderSide == OrderSide::BUY) {
-        matchOrders(order, sellOrders, buyOrders, true);
-    } else {
-        matchOrders(order, buyOrders, sellOrders, false);
+    // 取出已解码的命令，直到队列取空、达到批量上限或延迟上限
+    // 判断延迟上限时本来就要取时间，顺带记录每条命令的撮合耗时
+    auto batchStart = std::chrono::steady_clock::now();
+    auto commandStart = batchStart;
+    size_t processed = 1;
+    for (; ; ++processed) {
+        executeCommand(*command);
+        commands.pop();
+        auto now = std::chrono::steady_clock::now();
+        metrics.matchLatency.record(elapsedNanos(commandStart, now));
+        commandStart = now;
+        if (processed >= orderBatchSize || now - batchStart >= maxBatchDelay) {
+            break;
+        }
+        if ((command = commands.front()) == nullptr) {
+            break;
+        }
+    }
+    metrics.commandsMatched.add(processed);
+    metrics.batchSize.record(processed);
+
+    endBatch();
+    return true;
+}
+
+void MatchingEngine::executeCommand(EngineCommand& command) {
+    // 单条命令出错只丢弃该条，不影响同一批中其它订单的结果发布
+    try {
+        switch (command.type) {
+            case EngineCommandType::NEW_ORDER:
+                processOrder(*command.book, command.order);
+                break;
+            case EngineCommandType::CANCEL:
+                cancelOrder(command.book, command.order.symbol, command.order.orderId);
+                break;
+            case EngineCommandType::CANCEL_ALL:
+                cancelAllOrders(command.book, command.order.userId);
+                break;
+            case EngineCommandType::MASS_ORDER:
+                processMassOrder(*command.book, command.order, command.instructions);
+                break;
+            case EngineCommandType::AMEND:
+                amendOrder(command.book, command.order.symbol, command.order.orderId, command.order.price, command.order.quantity);
+                break;
+            case EngineCommandType::BOOK_SNAPSHOT_REQUEST:
+                command.book->depthSnapshotRequested = true;
+                break;
+            case EngineCommandType::TICK:
+                break;
+        }
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error processing order message: " + std::string(e.what()));
+    }
+}
+
+void MatchingEngine::journalInput(SymbolBook& book, const void* data, size_t size) {
+    if (replaying || journalSuspended || !book.journal) {
+        return;
+    }
+    book.journal->append(data, static_cast<uint32_t>(size));
+    ++book.inputsSinceSnapshot;
+}
+
+void MatchingEngine::recoverBook(SymbolBook& book) {
+    auto start = std::chrono::steady_clock::now();
+
+    // 快照中的挂单按价位内的时间顺序直接放回订单簿，不经过撮合
+    // 成交序号先恢复到快照时刻，回放时按原顺序重新分配，成交号与崩溃前发布的一致
+    BookSnapshot snapshot;
+    if (readSnapshot(book.snapshotPath, snapshot)) {
+        for (Order& order : snapshot.orders) {
+            addOrderToBook(book, order);
+        }
+        book.tradeSequence = snapshot.tradeSequence;
+    }
+
+    // 回放快照之后的输入，重建撮合状态；这些输入的结果在崩溃前未必发出，按原顺序重新产生，
+    // 每条输入的结果合成一条消息，下游按成交号和订单号去重
+    size_t replayed = 0;
+    replaying = true;
+    EngineCommand command;
+    book.journal->replay(snapshot.sequence, [this, &replayed, &command](uint64_t sequence, const void* data, size_t size) {
+        if (decodeCommand(data, size, command)) {
+            executeCommand(command);
+            emitFlush();
+        } else {
+            LOG_ERROR("Failed to replay journal record " + std::to_string(sequence));
+        }
+        ++replayed;
+    });
+    replaying = false;
+    book.journal->resumeAfter(snapshot.sequence);
+    book.inputsSinceSnapshot = replayed;
+
+    auto duration = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - start).count();
+    LOG_INFO("Recovered " + book.instrument.symbol + " from snapshot sequence " + std::to_string(snapshot.sequence) +
+             ". snapshot orders: " + std::to_string(snapshot.orders.size()) + " replayed inputs: " + std::to_string(replayed) +
+             " results to republish: " + std::to_string(recoveredResults.size()) +
+             " resting orders: " + std::to_string(book.orderBook.orderCount()) + " in " + std::to_string(duration) + " ms.");
+}
+
+void MatchingEngine::snapshotBook(SymbolBook& book) {
+    // 撮合线程只复制挂单并切换日志段，写盘在写快照线程完成
+    // 快照落盘前崩溃则沿用旧快照和全部日志段，落盘后删除旧段前崩溃则按序号跳过已包含的记录
+    snapshotJob.symbol = book.instrument.symbol;
+    snapshotJob.path = book.snapshotPath;
+    snapshotJob.sequence = book.journal->lastSequence();
+    snapshotJob.tradeSequence = book.tradeSequence;
+    snapshotJob.orders.clear();
+    auto collect = [this](const Order& order) { snapshotJob.orders.push_back(toWireOrder(order)); };
+    book.orderBook.forEachOrder(OrderSide::BUY, collect);
+    book.orderBook.forEachOrder(OrderSide::SELL, collect);
+    snapshotJob.journalPath = book.journal->basePath();
+    snapshotJob.journalSegment = book.journal->rotate();
+    snapshotJob.flushes = flushesEmitted;
+    snapshotWriter->submit(snapshotJob);
+    book.inputsSinceSnapshot = 0;
+}
+
+void MatchingEngine::takeSnapshots(uint64_t minInputs) {
+    for (const auto& book : books) {
+        if (!book->journal || book->inputsSinceSnapshot < minInputs) {
+            continue;
+        }
+        // 同时只写一个快照，其余交易对留到下一批
+        if (snapshotWriter->busy()) {
+            return;
+        }
+        try {
+            snapshotBook(*book);
+        } catch (const std::exception& e) {
+            // 快照失败时保留日志，下次再试
+            LOG_ERROR("Failed to snapshot " + book->instrument.symbol + ": " + std::string(e.what()));
+        }
+    }
+}
+
+void MatchingEngine::finishSnapshots() {
+    // 正常退出时为所有有新输入的交易对写快照并等待落盘，下次启动无需回放
+    for (const auto& book : books) {
+        if (!book->journal || book->inputsSinceSnapshot == 0) {
+            continue;
+        }
+        snapshotWriter->wait();
+        try {
+            snapshotBook(*book);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to snapshot " + book->instrument.symbol + ": " + std::string(e.what()));
+        }
+    }
+    if (snapshotWriter) {
+        snapshotWriter->wait();
+    }
+}
+
+void MatchingEngine::syncJournals() {
+    if (journalSync != JournalSync::BATCH) {
+        return;
+    }
+    for (const auto& book : books) {
+        if (!book->journal) {
+            continue;
+        }
+        try {
+            book->journal->sync();
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to sync journal of " + book->instrument.symbol + ": " + std::string(e.what()));
+        }
     }
+}
+
+void MatchingEngine::processOrder(SymbolBook& book, Order& order) {
+    auto start = std::chrono::high_resolution_clock::now();
+
+    OrderWireMessage input = encodeOrderMessage(WireMessageType::NEW_ORDER, order);
+    journalInput(book, &input, sizeof(input));
+
+    // 处理撮合订单（撤单、改单走 cancelOrder / amendOrder）
+    matchOrders(book, order);
 
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
-    LOG_INFO("processOrder executed in " + std::to_string(duration) + " μs.");
+    LOG_DEBUG("processOrder executed in " + std::to_string(duration) + " μs.");
+}
+
+void MatchingEngine::processMassOrder(SymbolBook& book, const Order& common, const std::vector<MassInstruction>& instructions) {
+    // 整条消息记一条日志，回放时同样整体执行；各条指令在撮合线程上连续执行，中间不插入其它命令，
+    // 结果进入同一批发布，订单簿变化合并成一次 L2 增量
+    if (!replaying) {
+        metrics.massOrderSize.record(instructions.size());
+        if (book.journal) {
+            std::string input = encodeMassOrderMessage(common, instructions);
+            journalInput(book, input.data(), input.size());
+        }
+    }
+
+    journalSuspended = true;
+    try {
+        for (const MassInstruction& instruction : instructions) {
+            switch (instruction.action) {
+                case MassAction::NEW: {
+                    Order order;
+                    order.orderId = instruction.orderId;
+                    order.userId = common.userId;
+                    order.symbol = book.instrument.symbol;
+                    order.price = instruction.orderType == OrderType::MARKET ? 0 : instruction.price;
+                    order.quantity = instruction.quantity;
+                    order.feeRate = instruction.feeRate;
+                    order.orderSide = instruction.orderSide;
+                    order.orderType = instruction.orderType;
+                    order.status = OrderStatus::INITIAL;
+                    order.createTime = common.createTime;
+                    order.updateTime = common.createTime;
+                    order.filledQuantity = 0;
+                    order.timeInForce = instruction.timeInForce;
+                    matchOrders(book, order);
+                    break;
+                }
+                case MassAction::CANCEL:
+                    cancelOrder(&book, book.instrument.symbol, instruction.orderId);
+                    break;
+                case MassAction::AMEND:
+                    amendOrder(&book, book.instrument.symbol, instruction.orderId, instruction.price, instruction.quantity);
+                    break;
+            }
+        }
+    } catch (...) {
+        journalSuspended = false;
+        throw;
+    }
+    journalSuspended = false;
 }
 
-void MatchingEngine::addOrderToBook(Order& order, std::map<double, std::map<unsigned int, Order>>& orderBook) {
-    orderBook[order.price][order.orderId] = order;
+void MatchingEngine::cancelOrder(SymbolBook* book, const std::string& symbol, unsigned int orderId) {
+    if (book == nullptr) {
+        generateRejectMessage(WireMessageType::CANCEL_REJECTED, orderId, "unknown symbol " + symbol);
+        return;
+    }
+    CancelWireMessage input = encodeCancelMessage(symbol, orderId);
+    journalInput(*book, &input, sizeof(input));
+
+    OrderBook& orderBook = book->orderBook;
+    OrderHandle handle = orderBook.findOrder(orderId);
+    if (handle == NULL_HANDLE) {
+        generateRejectMessage(WireMessageType::CANCEL_REJECTED, orderId, "order not found in book");
+        return;
+    }
+
+    cancelRestingOrder(*book, handle);
 }
 
-void MatchingEngine::matchOrders(Order& order, std::map<double, std::map<unsigned int, Order>>& oppositeOrders,
-                                 std::map<double, std::map<unsigned int, Order>>& ownOrders, bool isBuyOrder) {
-    if (isBuyOrder) {
-        matchBuyOrders(order, oppositeOrders, ownOrders);
-    } else {
-        matchSellOrders(order, oppositeOrders, ownOrders);
+void MatchingEngine::cancelAllOrders(SymbolBook* book, unsigned long long userId) {
+    if (book != nullptr) {
+        cancelUserOrders(*book, userId);
+        return;
+    }
+    for (const auto& each : books) {
+        cancelUserOrders(*each, userId);
+    }
+}
+
+void MatchingEngine::cancelUserOrders(SymbolBook& book, unsigned long long userId) {
+    // 沿用户链表逐个撤销，代价只与该用户的挂单数有关
+    OrderBook& orderBook = book.orderBook;
+    OrderHandle handle = orderBook.firstUserOrder(userId);
+    if (handle == NULL_HANDLE) {
+        return;
+    }
+    // 日志按交易对记录，撤销所有交易对时每个有挂单的交易对各记一条
+    CancelAllWireMessage input = encodeCancelAllMessage(book.instrument.symbol, userId);
+    journalInput(book, &input, sizeof(input));
+
+    size_t canceled = 0;
+    while (handle != NULL_HANDLE) {
+        OrderHandle next = orderBook.nextUserOrder(handle);
+        cancelRestingOrder(book, handle);
+        handle = next;
+        ++canceled;
+    }
+    LOG_DEBUG("cancelUserOrders canceled " + std::to_string(canceled) + " orders. symbol: " + book.instrument.symbol + " userId: " + std::to_string(userId));
+}
+
+void MatchingEngine::cancelRestingOrder(SymbolBook& book, OrderHandle handle) {
+    Order order = book.orderBook.getOrder(handle);
+    book.orderBook.removeOrder(handle);
+    order.status = order.filledQuantity > 0 ? OrderStatus::PARTIALLY_FILLED_CANCELED : OrderStatus::CANCELED;
+    order.updateTime = nowTimestamp();
+    LOG_DEBUG("cancelOrder Update Order Status. " + orderStatusToString(order.status) + " OrderId : " + std::to_string(order.orderId));
+
+    generateOrderUpdateMessage(WireMessageType::CANCELED, order);
+    book.depthChanged = true;
+}
+
+void MatchingEngine::amendOrder(SymbolBook* book, const std::string& symbol, unsigned int orderId, Price newPrice, Quantity newQuantity) {
+    if (book == nullptr) {
+        generateRejectMessage(WireMessageType::AMEND_REJECTED, orderId, "unknown symbol " + symbol);
+        return;
+    }
+    AmendWireMessage input = encodeAmendMessage(symbol, orderId, newPrice, newQuantity);
+    journalInput(*book, &input, sizeof(input));
+
+    OrderBook& orderBook = book->orderBook;
+    const Instrument& instrument = book->instrument;
+    OrderHandle handle = orderBook.findOrder(orderId);
+    if (handle == NULL_HANDLE) {
+        generateRejectMessage(WireMessageType::AMEND_REJECTED, orderId, "order not found in book");
+        return;
+    }
+
+    // price / quantity 为 0 时沿用原值
+    Order& resting = orderBook.getOrder(handle);
+    if (newPrice == 0) {
+        newPrice = resting.price;
+    }
+    if (newQuantity == 0) {
+        newQuantity = resting.quantity;
+    }
+    if (!instrument.isValidPrice(newPrice) || !instrument.isValidQuantity(newQuantity)) {
+        generateRejectMessage(WireMessageType::AMEND_REJECTED, orderId, "price or quantity off tick/lot");
+        return;
+    }
+    if (newQuantity <= resting.filledQuantity) {
+        generateRejectMessage(WireMessageType::AMEND_REJECTED, orderId, "quantity must exceed filled quantity");
+        return;
+    }
+
+    Timestamp now = nowTimestamp();
+
+    // 价格不变且只减量：原地修改，保留时间优先级
+    if (newPrice == resting.price && newQuantity <= resting.quantity) {
+        orderBook.reduceQuantity(handle, newQuantity);
+        resting.updateTime = now;
+        generateOrderUpdateMessage(WireMessageType::AMENDED, resting);
+        book->depthChanged = true;
+        return;
+    }
+
+    // 改价或加量：撤出订单簿，按新参数重新进入撮合，失去原有时间优先级
+    Order order = resting;
+    orderBook.removeOrder(handle);
+    order.price = newPrice;
+    order.quantity = newQuantity;
+    order.createTime = now;
+    order.updateTime = now;
+    generateOrderUpdateMessage(WireMessageType::AMENDED, order);
+    matchOrders(*book, order, true);
+}
+
+OrderHandle MatchingEngine::addOrderToBook(SymbolBook& book, Order& order) {
+    // 订单移入订单池，不再拷贝；入簿失败时 order 保持原样
+    OrderHandle handle = book.orderBook.addOrder(std::move(order));
+    if (handle == NULL_HANDLE) {
+        LOG_ERROR("addOrderToBook rejected order. OrderId: " + std::to_string(order.orderId) + " price: " + formatFixed(order.price, PRICE_DECIMALS));
+    }
+    return handle;
+}
+
+void MatchingEngine::matchOrders(SymbolBook& book, Order& order, bool amended) {
+    OrderSide oppositeSide = order.orderSide == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY;
+    Price limitPrice = takerLimitPrice(order);
+    Quantity remaining = order.quantity - order.filledQuantity;
+
+    // 撮合前确认订单最终能挂进订单簿，不能时不产生任何成交
+    if (book.orderBook.findOrder(order.orderId) != NULL_HANDLE) {
+        // 不能回报 EXPIRED：下游会按订单号覆盖簿中同号挂单的状态；拒绝回报只带订单号和原因
+        LOG_ERROR("matchOrders rejected order with duplicate order id. OrderId: " + std::to_string(order.orderId));
+        generateRejectMessage(WireMessageType::ORDER_REJECTED, order.orderId, "duplicate order id");
+        return;
+    }
+    if (restsRemainder(order) && !book.orderBook.canRest(order)) {
+        expireOrder(order, "price cannot rest in book");
+        return;
+    }
+
+    // 只挂单会立即成交、FOK 对手盘深度不足时整单撤销；两者都只读订单簿，不产生成交
+    if (order.timeInForce == TimeInForce::POST_ONLY && book.orderBook.availableQuantity(oppositeSide, limitPrice, 1) > 0) {
+        expireOrder(order, "post-only order would take liquidity");
+        return;
+    }
+    if (order.timeInForce == TimeInForce::FOK && fillableQuantity(book, order, limitPrice, remaining) < remaining) {
+        expireOrder(order, "insufficient liquidity to fill FOK order");
+        return;
+    }
+
+    // 防自成交 DECREMENT 减掉的数量单独记账，主动单的 quantity 保持下单时的数量
+    Quantity selfTradeReduced = 0;
+    bool selfTradeStopped = order.orderSide == OrderSide::BUY ? matchBuyOrders(book, order, selfTradeReduced)
+                                                               : matchSellOrders(book, order, selfTradeReduced);
+    if (order.filledQuantity > 0) {
+        book.depthChanged = true;
+    }
+    // 减掉的数量之外已全部成交时同样以防自成交撤销结束，不再入簿
+    if (selfTradeStopped || (selfTradeReduced > 0 && order.quantity - order.filledQuantity <= selfTradeReduced)) {
+        expireOrder(order, "self-trade prevention");
+        return;
     }
 
     // 记录主动担的所有状态变化
-    if (order.filledQuantity == 0) {
-        generateUnmatchedOrderMessage(order);
-        LOG_DEBUG("matchOrders Update Order Status. MATCHING OrderId : " + std::to_string(order.orderId));
-        addOrderToBook(order, ownOrders);
-    }else{
-        if (order.quantity > order.filledQuantity) {
-            LOG_DEBUG("matchOrders Update Order Status. PARTIALLY_FILLED OrderId: " + std::to_string(order.orderId) + " filledQuantity: " + std::to_string(order.filledQuantity));
-            addOrderToBook(order, ownOrders);
-        }else{
-            LOG_DEBUG("matchOrders Update Order Status. FULLY_FILLED OrderId : " + std::to_string(order.orderId));
+    if (order.filledQuantity >= order.quantity) {
+        LOG_DEBUG("matchOrders Update Order Status. FULLY_FILLED OrderId : " + std::to_string(order.orderId));
+        return;
+    }
+    // 市价单和 IOC 的剩余部分直接撤销，不进订单簿
+    if (!restsRemainder(order)) {
+        expireOrder(order, "unfilled remainder of immediate order");
+        return;
+    }
+    OrderHandle handle = addOrderToBook(book, order);
+    if (handle == NULL_HANDLE) {
+        expireOrder(order, "order cannot rest in book");
+        return;
+    }
+    book.depthChanged = true;
+
+    // 入簿成功后才回报挂单；部分成交的订单已由成交回报带出状态，改单已回报过 AMENDED
+    const Order& resting = book.orderBook.getOrder(handle);
+    if (resting.filledQuantity == 0) {
+        if (!amended) {
+            generateUnmatchedOrderMessage(resting);
         }
+        LOG_DEBUG("matchOrders Update Order Status. MATCHING OrderId : " + std::to_string(resting.orderId));
+    } else {
+        LOG_DEBUG("matchOrders Update Order Status. PARTIALLY_FILLED OrderId: " + std::to_string(resting.orderId) + " filledQuantity: " + formatFixed(resting.filledQuantity, QUANTITY_DECIMALS));
+    }
+    // 剩余部分入簿后才扣除防自成交减掉的数量，与挂单原地减量一样以 AMENDED 回报
+    if (selfTradeReduced > 0) {
+        book.orderBook.reduceQuantity(handle, resting.quantity - selfTradeReduced);
+        generateOrderUpdateMessage(WireMessageType::AMENDED, resting);
     }
+}
 
-    // 发送 orderBook 消息
-    publishOrderBook();
+void MatchingEngine::expireOrder(Order& order, const char* reason) {
+    order.status = order.filledQuantity > 0 ? OrderStatus::PARTIALLY_FILLED_CANCELED : OrderStatus::CANCELED;
+    order.updateTime = nowTimestamp();
+    LOG_DEBUG("matchOrders Expired Order. " + orderStatusToString(order.status) + " OrderId : " + std::to_string(order.orderId) + " reason: " + reason);
+    generateOrderUpdateMessage(WireMessageType::EXPIRED, order);
+}
 
+Quantity MatchingEngine::fillableQuantity(SymbolBook& book, const Order& order, Price limitPrice, Quantity needed) {
+    OrderSide oppositeSide = order.orderSide == OrderSide::BUY ? OrderSide::SELL : OrderSide::BUY;
+    if (selfTradePrevention == SelfTradePrevention::NONE) {
+        return book.orderBook.availableQuantity(oppositeSide, limitPrice, needed);
+    }
+    // 开启防自成交时按撮合顺序逐笔累计：撤销挂单的模式跳过自己的挂单，其余模式撮合到自己的挂单即停止
+    Quantity available = 0;
+    book.orderBook.forEachBestOrderWhile(oppositeSide, [&](const Order& resting) {
+        if (oppositeSide == OrderSide::BUY ? resting.price < limitPrice : resting.price > limitPrice) {
+            return false;
+        }
+        if (resting.userId == order.userId) {
+            return selfTradePrevention == SelfTradePrevention::CANCEL_OLDEST;
+        }
+        available += resting.quantity - resting.filledQuantity;
+        return available < needed;
+    });
+    return available;
 }
 
-void MatchingEngine::matchBuyOrders(Order& buyOrder, std::map<double, std::map<unsigned int, Order>>& sellOrders,
-                                    std::map<double, std::map<unsigned int, Order>>& buyOrders) {
-    // 遍历卖订单，优先匹配最低的卖价
-    for (auto it = sellOrders.begin(); it != sellOrders.end() && buyOrder.quantity > buyOrder.filledQuantity; ) {
-        double sellPrice = it->first;
+bool MatchingEngine::matchBuyOrders(SymbolBook& book, Order& buyOrder, Quantity& selfTradeReduced) {
+    OrderBook& orderBook = book.orderBook;
+    Price limitPrice = takerLimitPrice(buyOrder);
+    // 从最低卖价开始匹配，同价位内按 FIFO 顺序
+    while (buyOrder.quantity - buyOrder.filledQuantity > selfTradeReduced) {
+        PriceLevel* level = orderBook.bestLevel(OrderSide::SELL);
+        if (level == nullptr) {
+            break;
+        }
 
-        // 如果买单价格小于卖单价格，停止匹配
-        if (buyOrder.price < sellPrice) {
+        // 如果买单价格小于卖单价格，停止匹配（市价单的限价为最大值）
+        if (limitPrice < orderBook.getOrder(level->head).price) {
             break;
         }
 
-        auto& ordersAtPrice = it->second;
-        for (auto orderIt = ordersAtPrice.begin(); orderIt != ordersAtPrice.end() && buyOrder.quantity > buyOrder.filledQuantity; ) {
-            Order& sellOrder = orderIt->second;
+        while (!level->empty() && buyOrder.quantity - buyOrder.filledQuantity > selfTradeReduced) {
+            OrderHandle sellHandle = level->head;
+            Order& sellOrder = orderBook.getOrder(sellHandle);
+
+            if (selfTradePrevention != SelfTradePrevention::NONE && sellOrder.userId == buyOrder.userId) {
+                if (preventSelfTrade(book, buyOrder, sellHandle, selfTradeReduced)) {
+                    return true;
+                }
+                continue;
+            }
 
             // 进行交易处理
-            processTrade(buyOrder, sellOrder);
+            processTrade(book, buyOrder, sellHandle, buyOrder.quantity - buyOrder.filledQuantity - selfTradeReduced);
 
-            // 如果卖单已完全成交，移除该卖单
+            // 如果卖单已完全成交，移除该卖单（价位吃空时最优价游标自动后移）
             if (sellOrder.filledQuantity >= sellOrder.quantity) {
-                orderIt = ordersAtPrice.erase(orderIt);
-            } else {
-                // 卖单部分成交，更新后继续
-                ++orderIt;
+                orderBook.removeOrder(sellHandle);
             }
         }
-
-        // 如果该价格下的所有卖单都已处理完，移除该价格节点
-        if (ordersAtPrice.empty()) {
-            it = sellOrders.erase(it);
-        } else {
-            ++it;
-        }
     }
+    return false;
 }
 
-void MatchingEngine::matchSellOrders(Order& sellOrder, std::map<double, std::map<unsigned int, Order>>& buyOrders,
-                                     std::map<double, std::map<unsigned int, Order>>& sellOrders) {
-    // 使用反向迭代器，从最高买价开始匹配
-    for (auto it = buyOrders.rbegin(); it != buyOrders.rend() && sellOrder.quantity > sellOrder.filledQuantity; ) {
-        double buyPrice = it->first;
+bool MatchingEngine::matchSellOrders(SymbolBook& book, Order& sellOrder, Quantity& selfTradeReduced) {
+    OrderBook& orderBook = book.orderBook;
+    Price limitPrice = takerLimitPrice(sellOrder);
+    // 从最高买价开始匹配，同价位内按 FIFO 顺序
+    while (sellOrder.quantity - sellOrder.filledQuantity > selfTradeReduced) {
+        PriceLevel* level = orderBook.bestLevel(OrderSide::BUY);
+        if (level == nullptr) {
+            break;
+        }
 
-        // 如果卖单价格高于买单价格，停止匹配
-        if (sellOrder.price > buyPrice) {
+        // 如果卖单价格高于买单价格，停止匹配（市价单的限价为 0）
+        if (limitPrice > orderBook.getOrder(level->head).price) {
             break;
         }
 
-        auto& ordersAtPrice = it->second;
-        for (auto orderIt = ordersAtPrice.begin(); orderIt != ordersAtPrice.end() && sellOrder.quantity > sellOrder.filledQuantity; ) {
-            Order& buyOrder = orderIt->second;
+        while (!level->empty() && sellOrder.quantity - sellOrder.filledQuantity > selfTradeReduced) {
+            OrderHandle buyHandle = level->head;
+            Order& buyOrder = orderBook.getOrder(buyHandle);
+
+            if (selfTradePrevention != SelfTradePrevention::NONE && buyOrder.userId == sellOrder.userId) {
+                if (preventSelfTrade(book, sellOrder, buyHandle, selfTradeReduced)) {
+                    return true;
+                }
+                continue;
+            }
 
             // 执行交易
-            processTrade(sellOrder, buyOrder);
+            processTrade(book, sellOrder, buyHandle, sellOrder.quantity - sellOrder.filledQuantity - selfTradeReduced);
 
-            // 如果买单已完全成交，移除该买单
+            // 如果买单已完全成交，移除该买单（价位吃空时最优价游标自动后移）
             if (buyOrder.filledQuantity >= buyOrder.quantity) {
-                orderIt = ordersAtPrice.erase(orderIt);
-            } else {
-                // 买单部分成交，更新后继续
-                ++orderIt;
+                orderBook.removeOrder(buyHandle);
             }
         }
+    }
+    return false;
+}
 
-        // 如果该价格下的所有买单都已处理完，移除该价格节点
-        if (ordersAtPrice.empty()) {
-            it = std::map<double, std::map<unsigned int, Order>>::reverse_iterator(buyOrders.erase(std::next(it).base()));
-        } else {
-            ++it;
+bool MatchingEngine::preventSelfTrade(SymbolBook& book, Order& order, OrderHandle restingHandle, Quantity& selfTradeReduced) {
+    if (!replaying) {
+        metrics.selfTradesPrevented.add();
+    }
+    switch (selfTradePrevention) {
+        case SelfTradePrevention::CANCEL_OLDEST:
+            cancelRestingOrder(book, restingHandle);
+            return false;
+        case SelfTradePrevention::DECREMENT: {
+            OrderBook& orderBook = book.orderBook;
+            Order& resting = orderBook.getOrder(restingHandle);
+            Quantity restingRemaining = resting.quantity - resting.filledQuantity;
+            Quantity takerRemaining = order.quantity - order.filledQuantity - selfTradeReduced;
+            Quantity decrement = std::min(takerRemaining, restingRemaining);
+            selfTradeReduced += decrement;
+            if (decrement == restingRemaining) {
+                cancelRestingOrder(book, restingHandle);
+            } else {
+                // 挂单原地减量，保留时间优先级；以 AMENDED 通知下游新的数量
+                orderBook.reduceQuantity(restingHandle, resting.quantity - decrement);
+                resting.updateTime = nowTimestamp();
+                generateOrderUpdateMessage(WireMessageType::AMENDED, resting);
+                book.depthChanged = true;
+            }
+            return decrement == takerRemaining;
         }
+        default:
+            // CANCEL_NEWEST：挂单不动，主动单停止撮合
+            return true;
     }
 }
 
 
-void MatchingEngine::processTrade(Order& order, Order& oppositeOrder) {
-
-    double tradeQuantity = std::min(order.quantity - order.filledQuantity, oppositeOrder.quantity - oppositeOrder.filledQuantity);
-    double tradePrice = oppositeOrder.price;
+void MatchingEngine::processTrade(SymbolBook& book, Order& order, OrderHandle oppositeHandle, Quantity takerRemaining) {
+    OrderBook& orderBook = book.orderBook;
+    Order& oppositeOrder = orderBook.getOrder(oppositeHandle);
+    Quantity tradeQuantity = std::min(takerRemaining, oppositeOrder.quantity - oppositeOrder.filledQuantity);
+    Price tradePrice = oppositeOrder.price;
 
     order.filledQuantity += tradeQuantity;
-    oppositeOrder.filledQuantity += tradeQuantity;
-    TradeRecord trade = createTradeRecord(order, oppositeOrder, tradeQuantity, tradePrice, orderSideToString(order.orderSide));
+    // 挂单一侧经由订单簿更新，同步扣减价位聚合数量
+    orderBook.fillOrder(oppositeHandle, tradeQuantity);
+    uint64_t tradeId = makeTradeId(book.instrument.instrumentId, ++book.tradeSequence);
+    // 成交记录和回报按买卖方向排列双方，order_type 记录主动方的方向
+    const Order& buyOrder = order.orderSide == OrderSide::BUY ? order : oppositeOrder;
+    const Order& sellOrder = order.orderSide == OrderSide::BUY ? oppositeOrder : order;
+    TradeRecord trade = createTradeRecord(tradeId, buyOrder, sellOrder, tradeQuantity, tradePrice, orderSideToString(order.orderSide));
+
+    generateTradeMessage(buyOrder, sellOrder, trade);
+
+    if (!replaying) {
+        metrics.trades.add();
+        book.pendingTrades.push_back(TradePrint{trade.tradeId, order.orderSide, tradePrice, tradeQuantity, trade.tradeTime});
+    }
+}
 
-    generateTradeMessage(order, oppositeOrder, trade);
+template <typename T, typename Encode>
+void MatchingEngine::emitResult(Encode&& encode) {
+    // 恢复时发布线程尚未启动，结果先暂存，启动后最先发出
+    if (replaying) {
+        ResultEvent& event = recoveredResults.emplace_back();
+        event.type = ResultEventType::MESSAGE;
+        event.size = sizeof(T);
+        ::new (event.data) T(encode());
+        return;
+    }
+    // 定长结果直接构造在槽位里，编码和发送交给发布线程
+    ResultEvent* event;
+    SpinWait backoff;
+    while ((event = results.claim()) == nullptr) {
+        backoff.wait();
+    }
+    event->type = ResultEventType::MESSAGE;
+    event->size = sizeof(T);
+    ::new (event->data) T(encode());
+    results.push();
+}
 
+void MatchingEngine::emitFlush() {
+    if (replaying) {
+        recoveredResults.emplace_back().type = ResultEventType::FLUSH;
+        return;
+    }
+    ResultEvent* event;
+    SpinWait backoff;
+    while ((event = results.claim()) == nullptr) {
+        backoff.wait();
+    }
+    event->type = ResultEventType::FLUSH;
+    event->size = 0;
+    results.push();
+    ++flushesEmitted;
 }
 
 void MatchingEngine::generateUnmatchedOrderMessage(const Order& order) {
-    Json::Value message;
-    message["type"] = "UNMATCHED_ORDER";
-    message["order"] = serializeOrder(order);
+    emitResult<OrderWireMessage>([&order]() {
+        return encodeOrderMessage(WireMessageType::UNMATCHED_ORDER, order);
+    });
+}
 
-    std::string serializedMessage = serializeMessage(message);
-    LOG_DEBUG("generateUnmatchedOrderMessage push: " + serializedMessage);
-    zmq::message_t resultMessage(serializedMessage.data(), serializedMessage.size());
-    resultSocket.send(resultMessage, zmq::send_flags::none);
+void MatchingEngine::generateOrderUpdateMessage(WireMessageType type, const Order& order) {
+    emitResult<OrderWireMessage>([type, &order]() {
+        return encodeOrderMessage(type, order);
+    });
 }
 
-void MatchingEngine::generateTradeMessage(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade) {
-    Json::Value message;
-    message["type"] = "TRADE";
-    message["buyOrder"] = serializeOrder(buyOrder);
-    message["sellOrder"] = serializeOrder(sellOrder);
-    message["tradeRecord"] = serializeTradeRecord(trade);
+void MatchingEngine::generateRejectMessage(WireMessageType type, unsigned int orderId, const std::string& reason) {
+    emitResult<RejectWireMessage>([type, orderId, &reason]() {
+        return encodeRejectMessage(type, orderId, reason);
+    });
+}
 
-    std::string serializedMessage = serializeMessage(message);
-    LOG_DEBUG("generateTradeMessage push: " + serializedMessage);
-    zmq::message_t resultMessage(serializedMessage.data(), serializedMessage.size());
-    resultSocket.send(resultMessage, zmq::send_flags::none);
+void MatchingEngine::generateTradeMessage(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade) {
+    emitResult<TradeWireMessage>([&buyOrder, &sellOrder, &trade]() {
+        return encodeTradeMessage(buyOrder, sellOrder, trade);
+    });
 }
 
-TradeRecord MatchingEngine::createTradeRecord(const Order& buyOrder, const Order& sellOrder, double tradeQuantity, double tradePrice, const std::string& orderType) {
+TradeRecord MatchingEngine::createTradeRecord(uint64_t tradeId, const Order& buyOrder, const Order& sellOrder, Quantity tradeQuantity, Price tradePrice, const std::string& orderType) {
     TradeRecord trade;
-    trade.tradeId = rand();  // 可以改为更好的生成方法
+    trade.tradeId = tradeId;
     trade.buyerUserId = buyOrder.userId;
     trade.sellerUserId = sellOrder.userId;
     trade.buyerOrderId = buyOrder.orderId;
@@ -212,53 +1123,198 @@ TradeRecord MatchingEngine::createTradeRecord(const Order& buyOrder, const Order
     trade.orderType = orderType;
     trade.tradePrice = tradePrice;
     trade.tradeQuantity = tradeQuantity;
-    trade.buyerFee = roundToPrecision(buyOrder.feeRate * tradeQuantity * tradePrice, 8);
-    trade.sellerFee = roundToPrecision(sellOrder.feeRate * tradeQuantity * tradePrice, 8);
-    trade.tradeTime = std::chrono::system_clock::now();
+    trade.buyerFee = calculateFee(tradePrice, tradeQuantity, buyOrder.feeRate);
+    trade.sellerFee = calculateFee(tradePrice, tradeQuantity, sellOrder.feeRate);
+    trade.tradeTime = nowTimestamp();
     return trade;
 }
 
-double MatchingEngine::roundToPrecision(double value, int precision) {
-    double factor = std::pow(10.0, precision);
-    return std::round(value * factor) / factor;
+void MatchingEngine::publishMarketData() {
+    auto now = std::chrono::steady_clock::now();
+    for (const auto& book : books) {
+        publishTrades(*book);
+        publishDepth(*book, now);
+    }
 }
 
-void MatchingEngine::publishOrderBook() {
-    auto now = std::chrono::steady_clock::now();
-    // 每秒最多发布一次订单簿
-    if (std::chrono::duration_cast<std::chrono::seconds>(now - lastPublishTime).count() >= 1) {
-        lastPublishTime = now;
-        std::string orderBookData = formatOrderBook();
-        zmq::message_t message(orderBookData.c_str(), orderBookData.size());
-        bookSocket.send(message, zmq::send_flags::none);
-        LOG_DEBUG("Published order book");
+MarketDataEvent& MatchingEngine::claimMarketData() {
+    MarketDataEvent* event;
+    SpinWait backoff;
+    while ((event = marketData.claim()) == nullptr) {
+        backoff.wait();
+    }
+    return *event;
+}
+
+void MatchingEngine::publishTrades(SymbolBook& book) {
+    if (book.pendingTrades.empty()) {
+        return;
+    }
+    // 与槽位交换缓冲：本批成交交给发布线程，槽位里上一轮发完清空的缓冲留给下一批
+    MarketDataEvent& event = claimMarketData();
+    event.type = MarketDataEventType::TRADES;
+    event.symbol = &book.instrument.symbol;
+    event.trades.swap(book.pendingTrades);
+    marketData.push();
+}
+
+void MatchingEngine::publishDepth(SymbolBook& book, std::chrono::steady_clock::time_point now) {
+    // 到期或被请求时发全量快照，否则只发变化的价位
+    if (book.depthSnapshotRequested || now - book.lastDepthSnapshotTime >= depthSnapshotInterval) {
+        book.depthSnapshotRequested = false;
+        book.depthChanged = false;
+        book.lastDepthSnapshotTime = now;
+        MarketDataEvent& event = claimMarketData();
+        event.type = MarketDataEventType::DEPTH;
+        event.symbol = &book.instrument.symbol;
+        event.depth = book.depthPublisher.snapshot(book.orderBook);
+        marketData.push();
+        return;
+    }
+    if (book.depthChanged) {
+        book.depthChanged = false;
+        // 增量直接写进槽位；没有变化时不发布，槽位留给下一次
+        MarketDataEvent& event = claimMarketData();
+        if (book.depthPublisher.delta(book.orderBook, event.depth)) {
+            event.type = MarketDataEventType::DEPTH;
+            event.symbol = &book.instrument.symbol;
+            marketData.push();
+        }
     }
 }
 
-std::string MatchingEngine::formatOrderBook() {
-    std::ostringstream oss;
-    oss << std::left << std::setw(12) << "Order Side" << " | "
-        << std::setw(8) << "Price" << " | "
-        << std::setw(8) << "Quantity" << "\n";
-    oss << std::string(36, '-') << "\n";
+void MatchingEngine::publishLoop() {
+    if (cpus.publisher >= 0 && !pinCurrentThreadToCpu(cpus.publisher)) {
+        LOG_WARN("Failed to pin publisher stage to CPU " + std::to_string(cpus.publisher));
+    }
+    publishRecoveredResults();
+    SpinWait idle;
+    while (true) {
+        // 先读退出标记再取队列，撮合线程退出前放入的事件都会被发出
+        bool done = matcherDone;
+        bool busy = drainResults();
+        busy = drainMarketData() || busy;
+        if (busy) {
+            idle.reset();
+        } else if (done) {
+            break;
+        } else {
+            idle.wait();
+        }
+    }
+    try {
+        flushResults();
+    } catch (const std::exception& e) {
+        LOG_ERROR("Failed to flush results: " + std::string(e.what()));
+    }
+}
 
-    // 遍历 buyOrders
-    for (const auto& [price, ordersAtPrice] : buyOrders) {
-        for (const auto& [orderId, order] : ordersAtPrice) {
-            oss << std::left << std::setw(12) << "BUY" << " | "
-                << std::setw(8) << std::fixed << std::setprecision(8) << price << " | "
-                << std::setw(8) << order.quantity << "\n";
+void MatchingEngine::publishRecoveredResults() {
+    for (const ResultEvent& event : recoveredResults) {
+        try {
+            publishResult(event);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to publish recovered result: " + std::string(e.what()));
         }
     }
+    std::vector<ResultEvent>().swap(recoveredResults);
+}
+
+void MatchingEngine::publishResult(const ResultEvent& event) {
+    if (event.type == ResultEventType::FLUSH) {
+        flushResults();
+        return;
+    }
+    auto encodeStart = std::chrono::steady_clock::now();
+    pendingResults.push_back(encodeResult(event));
+    metrics.encodeLatency.record(elapsedNanos(encodeStart, std::chrono::steady_clock::now()));
+}
 
-    // 遍历 sellOrders
-    for (const auto& [price, ordersAtPrice] : sellOrders) {
-        for (const auto& [orderId, order] : ordersAtPrice) {
-            oss << std::left << std::setw(12) << "SELL" << " | "
-                << std::setw(8) << std::fixed << std::setprecision(8) << price << " | "
-                << std::setw(8) << order.quantity << "\n";
+bool MatchingEngine::drainResults() {
+    bool drained = false;
+    while (ResultEvent* event = results.front()) {
+        try {
+            publishResult(*event);
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to publish result: " + std::string(e.what()));
         }
+        if (event->type == ResultEventType::FLUSH) {
+            flushesSent.fetch_add(1, std::memory_order_release);
+        }
+        results.pop();
+        drained = true;
     }
+    return drained;
+}
 
-    return oss.str();
-}
\ No newline at end of file
+zmq::message_t MatchingEngine::encodeResult(const ResultEvent& event) const {
+    if (wireFormat == WireFormat::BINARY) {
+        return zmq::message_t(event.data, event.size);
+    }
+
+    // JSON 调试模式：把定长结果还原后序列化
+    WireMessageType type = readWireHeader(event.data, event.size);
+    Json::Value message;
+    message["type"] = wireMessageTypeToString(type);
+    if (type == WireMessageType::TRADE) {
+        TradeWireMessage trade = decodeWireMessage<TradeWireMessage>(event.data, event.size);
+        message["buyOrder"] = serializeOrder(fromWireOrder(trade.buyOrder));
+        message["sellOrder"] = serializeOrder(fromWireOrder(trade.sellOrder));
+        message["tradeRecord"] = serializeTradeRecord(fromWireTrade(trade.trade));
+    } else if (type == WireMessageType::CANCEL_REJECTED || type == WireMessageType::AMEND_REJECTED || type == WireMessageType::ORDER_REJECTED) {
+        RejectWireMessage reject = decodeWireMessage<RejectWireMessage>(event.data, event.size);
+        message["orderId"] = static_cast<Json::UInt>(reject.orderId);
+        message["reason"] = std::string(reject.reason);
+    } else {
+        message["order"] = serializeOrder(fromWireOrder(decodeWireMessage<OrderWireMessage>(event.data, event.size).order));
+    }
+
+    std::string serializedMessage = serializeMessage(message);
+    LOG_DEBUG("Result push: " + serializedMessage);
+    return toZmqMessage(std::move(serializedMessage));
+}
+
+void MatchingEngine::flushResults() {
+    // 每一帧都是一条完整的结果消息，接收端逐帧 recv 即可，无需感知批量
+    size_t count = pendingResults.size();
+    if (count == 0) {
+        return;
+    }
+    auto sendStart = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i) {
+        resultSocket.send(pendingResults[i], i + 1 < count ? zmq::send_flags::sndmore : zmq::send_flags::none);
+    }
+    pendingResults.clear();
+    metrics.sendLatency.record(elapsedNanos(sendStart, std::chrono::steady_clock::now()));
+    metrics.resultsSent.add(count);
+}
+
+bool MatchingEngine::drainMarketData() {
+    bool drained = false;
+    while (MarketDataEvent* event = marketData.front()) {
+        try {
+            const std::string& symbol = *event->symbol;
+            if (event->type == MarketDataEventType::DEPTH) {
+                sendMarketData(symbol, wireFormat == WireFormat::BINARY ? encodeDepthMessage(event->depth) : serializeDepthUpdate(symbol, event->depth));
+            } else {
+                sendMarketData(symbol, wireFormat == WireFormat::BINARY ? encodeTradePrintsMessage(event->trades) : serializeTradePrints(symbol, event->trades));
+            }
+        } catch (const std::exception& e) {
+            LOG_ERROR("Failed to publish market data: " + std::string(e.what()));
+        }
+        // 清空但保留容量，槽位轮转回撮合线程后复用
+        event->trades.clear();
+        marketData.pop();
+        drained = true;
+    }
+    return drained;
+}
+
+void MatchingEngine::sendMarketData(const std::string& symbol, std::string&& payload) {
+    // 第一帧是交易对主题，订阅端可按交易对过滤
+    zmq::message_t topic(symbol.data(), symbol.size());
+    zmq::message_t message = toZmqMessage(std::move(payload));
+    bookSocket.send(topic, zmq::send_flags::sndmore);
+    bookSocket.send(message, zmq::send_flags::none);
+    metrics.marketDataSent.add();
+}
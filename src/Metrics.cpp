@@ -0,0 +1,192 @@
+#include "Metrics.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+
+namespace {
+    std::atomic<size_t> nextThreadSlot{0};
+
+    // 延迟桶边界（纳秒），1-2-5 序列
+    const std::vector<uint64_t>& latencyBounds() {
+        static const std::vector<uint64_t> bounds = []() {
+            std::vector<uint64_t> result;
+            for (uint64_t decade = 100; decade <= 1000000000; decade *= 10) {
+                result.push_back(decade);
+                result.push_back(decade * 2);
+                result.push_back(decade * 5);
+            }
+            result.push_back(10000000000ULL);
+            return result;
+        }();
+        return bounds;
+    }
+
+    const std::vector<uint64_t>& sizeBounds() {
+        static const std::vector<uint64_t> bounds = []() {
+            std::vector<uint64_t> result;
+            for (uint64_t bound = 1; bound <= 65536; bound <<= 1) {
+                result.push_back(bound);
+            }
+            return result;
+        }();
+        return bounds;
+    }
+
+    std::string formatNumber(double value) {
+        char buffer[32];
+        int length = std::snprintf(buffer, sizeof(buffer), "%.9g", value);
+        return std::string(buffer, static_cast<size_t>(length));
+    }
+
+    void appendHeader(std::string& out, const std::string& name, const std::string& help, const char* type) {
+        out += "# HELP " + name + " " + help + "\n";
+        out += "# TYPE " + name + " " + type + "\n";
+    }
+}
+
+size_t metricThreadSlot() {
+    thread_local size_t slot = std::min(nextThreadSlot.fetch_add(1, std::memory_order_relaxed), MAX_METRIC_THREADS - 1);
+    return slot;
+}
+
+uint64_t Counter::value() const {
+    uint64_t total = 0;
+    for (const Slot& slot : slots) {
+        total += slot.value.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t histogramBucketUpperBound(size_t bucket) {
+    if (bucket < 2 * HISTOGRAM_SUB_BUCKETS) {
+        return bucket;
+    }
+    unsigned shift = static_cast<unsigned>(bucket / HISTOGRAM_SUB_BUCKETS - 1);
+    uint64_t mantissa = bucket - shift * HISTOGRAM_SUB_BUCKETS;
+    return ((mantissa + 1) << shift) - 1;
+}
+
+uint64_t HistogramSnapshot::percentile(double p) const {
+    if (count == 0) {
+        return 0;
+    }
+    uint64_t target = std::max<uint64_t>(static_cast<uint64_t>(std::ceil(p / 100.0 * count)), 1);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < buckets.size(); ++i) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return std::min(histogramBucketUpperBound(i), max);
+        }
+    }
+    return max;
+}
+
+uint64_t HistogramSnapshot::countAtMost(uint64_t bound) const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < buckets.size() && histogramBucketUpperBound(i) <= bound; ++i) {
+        total += buckets[i];
+    }
+    return total;
+}
+
+Histogram::~Histogram() {
+    for (auto& shard : shards) {
+        delete shard.load(std::memory_order_relaxed);
+    }
+}
+
+Histogram::Shard* Histogram::allocateShard(size_t slot) {
+    // 只有共用分片会被多个线程同时分配，用 CAS 保证只留下一个
+    Shard* fresh = new Shard();
+    Shard* expected = nullptr;
+    if (!shards[slot].compare_exchange_strong(expected, fresh, std::memory_order_acq_rel)) {
+        delete fresh;
+        return expected;
+    }
+    return fresh;
+}
+
+HistogramSnapshot Histogram::snapshot() const {
+    HistogramSnapshot result;
+    for (const auto& entry : shards) {
+        const Shard* shard = entry.load(std::memory_order_acquire);
+        if (shard == nullptr) {
+            continue;
+        }
+        for (size_t i = 0; i < HISTOGRAM_BUCKET_COUNT; ++i) {
+            result.buckets[i] += shard->buckets[i].load(std::memory_order_relaxed);
+        }
+        result.sum += shard->sum.load(std::memory_order_relaxed);
+        result.max = std::max(result.max, shard->max.load(std::memory_order_relaxed));
+    }
+    // 样本数取各桶之和，抓取与记录并发时 +Inf 桶与 _count 仍然一致
+    for (uint64_t bucket : result.buckets) {
+        result.count += bucket;
+    }
+    return result;
+}
+
+MetricsRegistry& MetricsRegistry::getInstance() {
+    static MetricsRegistry instance;
+    return instance;
+}
+
+Counter& MetricsRegistry::counter(const std::string& name, const std::string& help) {
+    std::lock_guard<std::mutex> lock(mutex);
+    CounterEntry& entry = counters[name];
+    if (!entry.counter) {
+        entry.help = help;
+        entry.counter = std::make_unique<Counter>();
+    }
+    return *entry.counter;
+}
+
+Histogram& MetricsRegistry::latencyHistogram(const std::string& name, const std::string& help) {
+    return histogram(name, help, HistogramUnit::NANOSECONDS);
+}
+
+Histogram& MetricsRegistry::sizeHistogram(const std::string& name, const std::string& help) {
+    return histogram(name, help, HistogramUnit::COUNT);
+}
+
+Histogram& MetricsRegistry::histogram(const std::string& name, const std::string& help, HistogramUnit unit) {
+    std::lock_guard<std::mutex> lock(mutex);
+    HistogramEntry& entry = histograms[name];
+    if (!entry.histogram) {
+        entry.help = help;
+        entry.unit = unit;
+        entry.histogram = std::make_unique<Histogram>();
+    }
+    return *entry.histogram;
+}
+
+std::string MetricsRegistry::renderPrometheus() const {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string out;
+
+    for (const auto& entry : counters) {
+        appendHeader(out, entry.first, entry.second.help, "counter");
+        out += entry.first + " " + std::to_string(entry.second.counter->value()) + "\n";
+    }
+
+    for (const auto& entry : histograms) {
+        const std::string& name = entry.first;
+        bool latency = entry.second.unit == HistogramUnit::NANOSECONDS;
+        double scale = latency ? 1e-9 : 1.0;
+        HistogramSnapshot snapshot = entry.second.histogram->snapshot();
+
+        appendHeader(out, name, entry.second.help, "histogram");
+        for (uint64_t bound : latency ? latencyBounds() : sizeBounds()) {
+            out += name + "_bucket{le=\"" + formatNumber(bound * scale) + "\"} " +
+                   std::to_string(snapshot.countAtMost(bound)) + "\n";
+        }
+        out += name + "_bucket{le=\"+Inf\"} " + std::to_string(snapshot.count) + "\n";
+        out += name + "_sum " + formatNumber(snapshot.sum * scale) + "\n";
+        out += name + "_count " + std::to_string(snapshot.count) + "\n";
+
+        // 标准直方图只有累计桶，另外导出自进程启动以来的最大值
+        appendHeader(out, name + "_max", "Maximum of " + name + " since start", "gauge");
+        out += name + "_max " + formatNumber(snapshot.max * scale) + "\n";
+    }
+    return out;
+}
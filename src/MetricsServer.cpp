@@ -0,0 +1,69 @@
+#include "MetricsServer.h"
+#include "Metrics.h"
+#include "Logger.h"
+#include <fstream>
+#include <stdexcept>
+#include <json/json.h>
+
+MetricsConfig readMetricsConfig(const std::string& configFile) {
+    std::ifstream file(configFile);
+    if (!file.is_open()) {
+        throw std::runtime_error("Could not open config file: " + configFile);
+    }
+
+    Json::Value root;
+    Json::CharReaderBuilder readerBuilder;
+    std::string errs;
+    if (!Json::parseFromStream(readerBuilder, file, &root, &errs)) {
+        throw std::runtime_error("Failed to parse configuration file: " + errs);
+    }
+
+    const Json::Value& metrics = root["metrics"];
+    MetricsConfig config;
+    config.host = metrics.get("host", config.host).asString();
+    config.matchPort = metrics.get("matchPort", DEFAULT_MATCH_METRICS_PORT).asInt();
+    config.persistencePort = metrics.get("persistencePort", DEFAULT_PERSISTENCE_METRICS_PORT).asInt();
+    config.gatewayPort = metrics.get("gatewayPort", DEFAULT_GATEWAY_METRICS_PORT).asInt();
+    for (int port : {config.matchPort, config.persistencePort, config.gatewayPort}) {
+        if (port < 0 || port > 65535) {
+            throw std::runtime_error("metrics ports must be between 0 and 65535");
+        }
+    }
+    return config;
+}
+
+void registerMetricsEndpoint(httplib::Server& server) {
+    server.Get("/metrics", [](const httplib::Request&, httplib::Response& res) {
+        res.set_content(MetricsRegistry::getInstance().renderPrometheus(), "text/plain; version=0.0.4");
+    });
+}
+
+MetricsServer::MetricsServer(const std::string& host, int port) : host_(host), port_(port) {
+    registerMetricsEndpoint(svr_);
+}
+
+MetricsServer::~MetricsServer() {
+    stop();
+}
+
+void MetricsServer::start() {
+    if (port_ == 0) {
+        return;
+    }
+    listenThread_ = std::thread([this]() {
+        LOG_INFO("Serving metrics at " + host_ + ":" + std::to_string(port_) + "/metrics");
+        if (!svr_.listen(host_.c_str(), port_)) {
+            LOG_ERROR("Failed to start metrics server at " + host_ + ":" + std::to_string(port_));
+        }
+    });
+}
+
+void MetricsServer::stop() {
+    if (!listenThread_.joinable()) {
+        return;
+    }
+    // 监听尚未开始时 stop() 不起作用，先等监听就绪或失败
+    svr_.wait_until_ready();
+    svr_.stop();
+    listenThread_.join();
+}
@@ -0,0 +1,52 @@
+#include "OpenOrders.h"
+#include "Serialization.h"
+#include <stdexcept>
+
+namespace {
+    // 与下面 SELECT 的列顺序一致
+    enum OpenOrderColumn : unsigned int {
+        ORDER_ID, USER_ID, TRADING_PAIR, PRICE, QUANTITY, FEE_RATE, ORDER_SIDE, ORDER_TYPE, TIME_IN_FORCE,
+        STATUS, FILLED_QUANTITY, CREATE_TIME, UPDATE_TIME
+    };
+
+    std::string openOrdersQuery(DbConnection& dbConn, const std::vector<std::string>& symbols) {
+        std::string query = "SELECT order_id, user_id, trading_pair, price, quantity, fee_rate, order_side, order_type, time_in_force, "
+                            "status, filled_quantity, create_time, update_time FROM orders "
+                            "WHERE status IN ('INITIAL', 'MATCHING', 'PARTIALLY_FILLED')";
+        if (!symbols.empty()) {
+            query += " AND trading_pair IN (";
+            for (size_t i = 0; i < symbols.size(); ++i) {
+                query += (i > 0 ? ", '" : "'") + dbConn.escape(symbols[i]) + "'";
+            }
+            query += ")";
+        }
+        return query + " ORDER BY create_time ASC, order_id ASC";
+    }
+}
+
+size_t loadOpenOrders(DbConnection& dbConn, const std::vector<std::string>& symbols, const std::function<void(Order&)>& onOrder) {
+    size_t count = 0;
+    bool ok = dbConn.queryRows(openOrdersQuery(dbConn, symbols), [&onOrder, &count](const DbRow& row) {
+        Order order;
+        order.orderId = static_cast<unsigned int>(row.asUInt64(ORDER_ID));
+        order.userId = row.asUInt64(USER_ID);
+        order.symbol = std::string(row.asText(TRADING_PAIR));
+        order.price = row.asFixed(PRICE, PRICE_DECIMALS);
+        order.quantity = row.asFixed(QUANTITY, QUANTITY_DECIMALS);
+        order.feeRate = row.asFixed(FEE_RATE, FEE_RATE_DECIMALS);
+        order.orderSide = stringToOrderSide(std::string(row.asText(ORDER_SIDE)));
+        order.orderType = stringToOrderType(std::string(row.asText(ORDER_TYPE)));
+        order.timeInForce = row.isNull(TIME_IN_FORCE) ? TimeInForce::GTC : stringToTimeInForce(std::string(row.asText(TIME_IN_FORCE)));
+        order.status = stringToOrderStatus(std::string(row.asText(STATUS)));
+        order.filledQuantity = row.asFixed(FILLED_QUANTITY, QUANTITY_DECIMALS);
+        // 时间列可为 NULL：缺创建时间的订单排在最前（ORDER BY 把 NULL 排在前面），缺更新时间时沿用创建时间
+        order.createTime = row.isNull(CREATE_TIME) ? Timestamp() : row.asTimestamp(CREATE_TIME);
+        order.updateTime = row.isNull(UPDATE_TIME) ? order.createTime : row.asTimestamp(UPDATE_TIME);
+        onOrder(order);
+        ++count;
+    });
+    if (!ok) {
+        throw std::runtime_error("Failed to load open orders from database");
+    }
+    return count;
+}
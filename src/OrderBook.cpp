@@ -0,0 +1,296 @@
+#include "OrderBook.h"
+#include <algorithm>
+#include <utility>
+
+PriceLadder::PriceLadder(bool highestFirst, size_t windowLevels)
+        : highestFirst(highestFirst), windowLevels((std::max<size_t>(windowLevels, 64) + 63) / 64 * 64),
+          baseTick(0), bestIndex(-1), allocations(0) {
+}
+
+PriceLevel* PriceLadder::levelAt(int64_t tick) {
+    if (levels.empty()) {
+        // 窗口在第一张挂单到来时一次分配，之后大小不变
+        levels.resize(windowLevels);
+        occupied.resize(windowLevels / 64, 0);
+        ++allocations;
+        baseTick = tick - windowSize() / 2;
+    }
+    if (empty() && !inWindow(tick)) {
+        // 整边为空时窗口直接对准新价格，无需搬移
+        baseTick = tick - windowSize() / 2;
+    } else if (betterThanWindow(tick)) {
+        recenter(tick);
+    }
+    if (inWindow(tick)) {
+        return &levels[tick - baseTick];
+    }
+
+    auto result = overflow.try_emplace(tick);
+    if (result.second) {
+        ++allocations;
+    }
+    return &result.first->second;
+}
+
+PriceLevel* PriceLadder::findLevel(int64_t tick) {
+    if (inWindow(tick)) {
+        return &levels[tick - baseTick];
+    }
+    auto it = overflow.find(tick);
+    return it == overflow.end() ? nullptr : &it->second;
+}
+
+PriceLevel* PriceLadder::best() {
+    if (bestIndex < 0 && !overflow.empty()) {
+        recenter(highestFirst ? overflow.rbegin()->first : overflow.begin()->first);
+    }
+    return bestIndex < 0 ? nullptr : &levels[bestIndex];
+}
+
+void PriceLadder::markOccupied(int64_t tick) {
+    if (!inWindow(tick)) {
+        return;
+    }
+    int64_t index = tick - baseTick;
+    occupied[index / 64] |= (1ULL << (index % 64));
+
+    if (bestIndex < 0 || (highestFirst ? index > bestIndex : index < bestIndex)) {
+        bestIndex = index;
+    }
+}
+
+void PriceLadder::markEmpty(int64_t tick) {
+    if (!inWindow(tick)) {
+        overflow.erase(tick);
+        return;
+    }
+    int64_t index = tick - baseTick;
+    occupied[index / 64] &= ~(1ULL << (index % 64));
+
+    // 最优价位被吃空时，游标沿位图移动到下一个非空价位
+    if (index == bestIndex) {
+        bestIndex = highestFirst ? findPrevOccupied(index) : findNextOccupied(index);
+    }
+}
+
+void PriceLadder::recenter(int64_t tick) {
+    // 窗口以 tick 为中心重新定位：只搬移非空价位，代价与窗口内挂单价位数和位图长度成正比
+    int64_t size = windowSize();
+    int64_t shift = tick - size / 2 - baseTick;
+    if (shift == 0) {
+        return;
+    }
+    if (shift > 0) {
+        // 新下标比旧下标小，从低到高搬移不会覆盖尚未搬移的价位
+        for (size_t word = 0; word < occupied.size(); ++word) {
+            uint64_t bits = occupied[word];
+            occupied[word] = 0;
+            while (bits) {
+                int64_t index = static_cast<int64_t>(word * 64 + __builtin_ctzll(bits));
+                moveLevel(index, index - shift);
+                bits &= bits - 1;
+            }
+        }
+    } else {
+        for (size_t word = occupied.size(); word-- > 0; ) {
+            uint64_t bits = occupied[word];
+            occupied[word] = 0;
+            while (bits) {
+                int bit = 63 - __builtin_clzll(bits);
+                moveLevel(static_cast<int64_t>(word * 64 + bit), static_cast<int64_t>(word * 64 + bit) - shift);
+                bits &= ~(1ULL << bit);
+            }
+        }
+    }
+    baseTick += shift;
+
+    // 落进新窗口的溢出价位搬回窗口
+    for (auto it = overflow.lower_bound(baseTick); it != overflow.end() && it->first < baseTick + size; ) {
+        int64_t index = it->first - baseTick;
+        levels[index] = it->second;
+        occupied[index / 64] |= (1ULL << (index % 64));
+        it = overflow.erase(it);
+    }
+    bestIndex = highestFirst ? findPrevOccupied(size) : findNextOccupied(-1);
+}
+
+void PriceLadder::moveLevel(int64_t from, int64_t to) {
+    // from 为旧窗口下标，to 为新窗口下标；移出新窗口的价位转入溢出区
+    if (to >= 0 && to < windowSize()) {
+        levels[to] = levels[from];
+        occupied[to / 64] |= (1ULL << (to % 64));
+    } else {
+        overflow.emplace(baseTick + from, levels[from]);
+        ++allocations;
+    }
+    levels[from] = PriceLevel();
+}
+
+int64_t PriceLadder::findNextOccupied(int64_t index) const {
+    int64_t start = index + 1;
+    if (start >= static_cast<int64_t>(levels.size())) {
+        return -1;
+    }
+    size_t word = start / 64;
+    uint64_t bits = occupied[word] & (~0ULL << (start % 64));
+    while (true) {
+        if (bits) {
+            return static_cast<int64_t>(word * 64 + __builtin_ctzll(bits));
+        }
+        if (++word >= occupied.size()) {
+            return -1;
+        }
+        bits = occupied[word];
+    }
+}
+
+int64_t PriceLadder::findPrevOccupied(int64_t index) const {
+    int64_t start = index - 1;
+    if (start < 0) {
+        return -1;
+    }
+    size_t word = start / 64;
+    int shift = 63 - static_cast<int>(start % 64);
+    uint64_t bits = (occupied[word] << shift) >> shift;
+    while (true) {
+        if (bits) {
+            return static_cast<int64_t>(word * 64 + 63 - __builtin_clzll(bits));
+        }
+        if (word == 0) {
+            return -1;
+        }
+        bits = occupied[--word];
+    }
+}
+
+OrderBook::OrderBook(Price tickSize, size_t orderCapacity, size_t windowLevels)
+        : tickSize(tickSize), buyLadder(true, windowLevels), sellLadder(false, windowLevels),
+          pool(orderCapacity), orderIndex(orderCapacity), userIndex(orderCapacity) {
+}
+
+bool OrderBook::canRest(const Order& order) const {
+    return order.price > 0 && order.price % tickSize == 0 && orderIndex.find(order.orderId) == NULL_HANDLE;
+}
+
+OrderHandle OrderBook::addOrder(Order&& order) {
+    if (!canRest(order)) {
+        return NULL_HANDLE;
+    }
+    int64_t tick = order.price / tickSize;
+
+    PriceLadder& ladder = ladderFor(order.orderSide);
+    PriceLevel* level = ladder.levelAt(tick);
+
+    unsigned int orderId = order.orderId;
+    OrderHandle handle = pool.allocate(std::move(order));
+    orderIndex.insert(orderId, handle);
+    linkUserOrder(handle);
+
+    OrderNode& node = pool.get(handle);
+    node.prev = level->tail;
+    if (level->tail != NULL_HANDLE) {
+        pool.get(level->tail).next = handle;
+    } else {
+        level->head = handle;
+        ladder.markOccupied(tick);
+    }
+    level->tail = handle;
+    ++level->orderCount;
+    level->quantity += node.order.quantity - node.order.filledQuantity;
+    return handle;
+}
+
+void OrderBook::removeOrder(OrderHandle handle) {
+    OrderNode& node = pool.get(handle);
+    int64_t tick = node.order.price / tickSize;
+    PriceLadder& ladder = ladderFor(node.order.orderSide);
+    PriceLevel* level = ladder.findLevel(tick);
+
+    if (node.prev != NULL_HANDLE) {
+        pool.get(node.prev).next = node.next;
+    } else {
+        level->head = node.next;
+    }
+    if (node.next != NULL_HANDLE) {
+        pool.get(node.next).prev = node.prev;
+    } else {
+        level->tail = node.prev;
+    }
+    --level->orderCount;
+    level->quantity -= node.order.quantity - node.order.filledQuantity;
+
+    if (level->empty()) {
+        ladder.markEmpty(tick);
+    }
+    orderIndex.erase(node.order.orderId);
+    unlinkUserOrder(handle);
+    pool.release(handle);
+}
+
+void OrderBook::linkUserOrder(OrderHandle handle) {
+    // 用户链表内的顺序无关紧要：已有挂单时插在头部之后，不必改动索引
+    OrderNode& node = pool.get(handle);
+    OrderHandle head = userIndex.find(node.order.userId);
+    if (head == NULL_HANDLE) {
+        userIndex.insert(node.order.userId, handle);
+        return;
+    }
+    OrderNode& headNode = pool.get(head);
+    node.userPrev = head;
+    node.userNext = headNode.userNext;
+    if (headNode.userNext != NULL_HANDLE) {
+        pool.get(headNode.userNext).userPrev = handle;
+    }
+    headNode.userNext = handle;
+}
+
+void OrderBook::unlinkUserOrder(OrderHandle handle) {
+    // 只有摘除头部时才查索引
+    OrderNode& node = pool.get(handle);
+    if (node.userNext != NULL_HANDLE) {
+        pool.get(node.userNext).userPrev = node.userPrev;
+    }
+    if (node.userPrev != NULL_HANDLE) {
+        pool.get(node.userPrev).userNext = node.userNext;
+    } else if (node.userNext != NULL_HANDLE) {
+        userIndex.assign(node.order.userId, node.userNext);
+    } else {
+        userIndex.erase(node.order.userId);
+    }
+}
+
+void OrderBook::reduceQuantity(OrderHandle handle, Quantity newQuantity) {
+    Order& order = pool.get(handle).order;
+    levelOf(order)->quantity -= order.quantity - newQuantity;
+    order.quantity = newQuantity;
+}
+
+void OrderBook::fillOrder(OrderHandle handle, Quantity quantity) {
+    Order& order = pool.get(handle).order;
+    order.filledQuantity += quantity;
+    levelOf(order)->quantity -= quantity;
+}
+
+PriceLevel* OrderBook::bestLevel(OrderSide side) {
+    return ladderFor(side).best();
+}
+
+Quantity OrderBook::availableQuantity(OrderSide side, Price limitPrice, Quantity needed) const {
+    Quantity available = 0;
+    const PriceLadder& ladder = side == OrderSide::BUY ? buyLadder : sellLadder;
+    ladder.forEachBestLevelWhile([&](int64_t tick, const PriceLevel& level) {
+        Price price = tickToPrice(tick);
+        // 买盘价格不低于、卖盘价格不高于对手的限价才可成交
+        if (side == OrderSide::BUY ? price < limitPrice : price > limitPrice) {
+            return false;
+        }
+        available += level.quantity;
+        return available < needed;
+    });
+    return available;
+}
+
+uint64_t OrderBook::allocationCount() const {
+    return pool.allocationCount() + orderIndex.allocationCount() + userIndex.allocationCount() +
+           buyLadder.allocationCount() + sellLadder.allocationCount();
+}
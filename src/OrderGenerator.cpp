@@ -1,22 +1,26 @@
 #include "OrderGenerator.h"
 #include "Serialization.h"  // 假设我们有一个序列化库
+#include "OpenOrders.h"
 #include <chrono>
 #include <thread>
 
 std::atomic<unsigned int> OrderGenerator::orderIdCounter(10000);
 
-OrderGenerator::OrderGenerator(DbConnection& dbConn, zmq::context_t& context, const std::string& orderServerAddress)
+OrderGenerator::OrderGenerator(DbConnection& dbConn, zmq::context_t& context, const std::string& orderServerAddress, const std::vector<Instrument>& instruments,
+                               WireFormat wireFormat, bool reloadOpenOrders)
         : orderSocket(context, zmq::socket_type::push), dbConn(dbConn), generator(std::random_device()()),
-          priceDistribution(5000.0, 60000.0),
-          quantityDistribution(0.1, 10.0),
-          feeRateDistribution(0.001, 0.005),
+          instruments(instruments), wireFormat(wireFormat), reloadOpenOrders(reloadOpenOrders),
+          instrumentDistribution(0, instruments.size() - 1),
+          feeRateDistribution(FEE_RATE_SCALE / 1000, FEE_RATE_SCALE * 5 / 1000),
           orderSideDistribution(0, 1),
           orderTypeDistribution(0, 1) {
     orderSocket.connect(orderServerAddress);
 }
 
 void OrderGenerator::generateOrders(int numOrders) {
-    loadOrdersFromDatabase();
+    if (reloadOpenOrders) {
+        loadOrdersFromDatabase();
+    }
 
     orderIdCounter = getMaxOrderId();
     for (int i = 0; i < numOrders; ++i) {
@@ -32,17 +36,22 @@ Order OrderGenerator::createRandomOrder() {
     Order order;
     order.orderId = ++orderIdCounter;
     order.userId = orderIdCounter;
-    order.price = roundToPrecision(priceDistribution(generator), 8);
-    order.quantity = roundToPrecision(quantityDistribution(generator), 6);
-    order.feeRate = roundToPrecision(feeRateDistribution(generator), 6);
+    // 随机选择交易对，价格以 tick 为单位、数量以 lot 为单位生成
+    const Instrument& instrument = instruments[instrumentDistribution(generator)];
+    std::uniform_int_distribution<int64_t> priceDistribution(5000 * PRICE_SCALE / instrument.tickSize, 60000 * PRICE_SCALE / instrument.tickSize);
+    std::uniform_int_distribution<int64_t> quantityDistribution(QUANTITY_SCALE / 10 / instrument.lotSize, 10 * QUANTITY_SCALE / instrument.lotSize);
+    order.symbol = instrument.symbol;
+    order.price = priceDistribution(generator) * instrument.tickSize;
+    order.quantity = quantityDistribution(generator) * instrument.lotSize;
+    order.feeRate = feeRateDistribution(generator);
     order.orderSide = getRandomOrderSide();
     // order.orderType = getRandomOrderType();
     order.orderType = OrderType::LIMIT;
     order.status = OrderStatus::INITIAL;
-    order.createTime = std::chrono::system_clock::now();
+    order.createTime = nowTimestamp();
     order.updateTime = order.createTime;
-    order.filledQuantity = 0.0;
-    LOG_DEBUG("create random orders from database. orderId:" + std::to_string(order.orderId) + " price:" + std::to_string(order.price));
+    order.filledQuantity = 0;
+    LOG_DEBUG("create random orders from database. orderId:" + std::to_string(order.orderId) + " price:" + formatFixed(order.price, PRICE_DECIMALS));
     return order;
 }
 
@@ -55,25 +64,34 @@ OrderType OrderGenerator::getRandomOrderType() {
 }
 
 void OrderGenerator::sendOrder(const Order& order, bool isUpdate) {
-    Json::Value message;
     if(!isUpdate){
         writeOrderToDatabase(order);
     }
 
+    if (wireFormat == WireFormat::BINARY) {
+        zmq::message_t zmqMessage = encodeToZmqMessage<OrderWireMessage>([&order]() {
+            return encodeOrderMessage(WireMessageType::NEW_ORDER, order);
+        });
+        orderSocket.send(zmqMessage, zmq::send_flags::none);
+        return;
+    }
+
+    Json::Value message;
+
     message["type"] = "ORDER";
     message["order"] = serializeOrder(order);  // Use the new serializeOrder function
     std::string serializedMessage = serializeMessage(message);  // Serialize the message
 
-    zmq::message_t zmqMessage(serializedMessage.data(), serializedMessage.size());
+    zmq::message_t zmqMessage = toZmqMessage(std::move(serializedMessage));
     orderSocket.send(zmqMessage, zmq::send_flags::none);
 }
 
 void OrderGenerator::writeOrderToDatabase(const Order& order) {
     // 数据库写入逻辑
-    std::string query = "INSERT INTO orders (order_id, user_id, price, quantity, fee_rate, order_side, order_type, status, filled_quantity) VALUES (" +
-                        std::to_string(order.orderId) + ", " + std::to_string(order.userId) + ", " + std::to_string(order.price) + ", " +
-                        std::to_string(order.quantity) + ", " + std::to_string(order.feeRate) + ", '" + orderSideToString(order.orderSide) + "', '" +
-                        orderTypeToString(order.orderType) + "', '" + orderStatusToString(order.status) + "', " + std::to_string(order.filledQuantity) + ")";
+    std::string query = "INSERT INTO orders (order_id, user_id, trading_pair, price, quantity, fee_rate, order_side, order_type, status, filled_quantity) VALUES (" +
+                        std::to_string(order.orderId) + ", " + std::to_string(order.userId) + ", '" + order.symbol + "', " + formatFixed(order.price, PRICE_DECIMALS) + ", " +
+                        formatFixed(order.quantity, QUANTITY_DECIMALS) + ", " + formatFixed(order.feeRate, FEE_RATE_DECIMALS) + ", '" + orderSideToString(order.orderSide) + "', '" +
+                        orderTypeToString(order.orderType) + "', '" + orderStatusToString(order.status) + "', " + formatFixed(order.filledQuantity, QUANTITY_DECIMALS) + ")";
 
     if (!dbConn.executeQuery(query)) {
         LOG_DEBUG("Failed to insert order into database");
@@ -81,35 +99,18 @@ void OrderGenerator::writeOrderToDatabase(const Order& order) {
 }
 
 void OrderGenerator::loadOrdersFromDatabase() {
-    std::string query = "SELECT order_id, user_id, price, quantity, fee_rate, order_side, order_type, status, filled_quantity, create_time, update_time FROM orders WHERE status IN ('INITIAL', 'MATCHING', 'PARTIALLY_FILLED') ORDER BY create_time ASC";
-
     try {
-        std::vector<std::map<std::string, std::string>> results = dbConn.executeQueryWithResult(query);
-
-        if (results.empty()) {
-            LOG_DEBUG("No orders found with status INITIAL, MATCHING, or PARTIALLY_FILLED.");
-            return;
-        }
-
-        double total = 0;
-        for (const auto& row : results) {
-            Order order;
-            order.orderId = std::stoul(row.at("order_id"));
-            order.userId = std::stoul(row.at("user_id"));
-            order.price = std::stod(row.at("price"));
-            order.quantity = std::stod(row.at("quantity"));
-            order.feeRate = std::stod(row.at("fee_rate"));
-            order.orderSide = stringToOrderSide(row.at("order_side"));
-            order.orderType = stringToOrderType(row.at("order_type"));
-            order.status = stringToOrderStatus(row.at("status"));
-            order.filledQuantity = std::stod(row.at("filled_quantity"));
-            order.createTime = string_to_time_point(row.at("create_time"));
-            order.updateTime = string_to_time_point(row.at("update_time"));
-            LOG_DEBUG("loading orders from database. orderId:" + std::to_string(order.orderId) + " price:" + std::to_string(order.price) + " price:" + row.at("price"));
+        Quantity total = 0;
+        size_t loaded = loadOpenOrders(dbConn, {}, [this, &total](Order& order) {
+            LOG_DEBUG("loading orders from database. orderId:" + std::to_string(order.orderId) + " price:" + formatFixed(order.price, PRICE_DECIMALS));
             sendOrder(order, true);
             total += order.quantity - order.filledQuantity;
+        });
+        if (loaded == 0) {
+            LOG_DEBUG("No orders found with status INITIAL, MATCHING, or PARTIALLY_FILLED.");
+            return;
         }
-        LOG_DEBUG("loading orders from database. total:" + std::to_string(total));
+        LOG_DEBUG("loading orders from database. total:" + formatFixed(total, QUANTITY_DECIMALS));
     } catch (const std::exception& e) {
         LOG_DEBUG("Error loading orders from database: " + std::string(e.what()));
         // 这里可以根据需要进行进一步的错误处理
@@ -118,20 +119,15 @@ void OrderGenerator::loadOrdersFromDatabase() {
 
 
 unsigned int OrderGenerator::getMaxOrderId() {
-    std::string query = "SELECT MAX(order_id) AS max_order_id FROM orders";
-    auto results = dbConn.executeQueryWithResult(query);
+    unsigned int maxOrderId = 10000;
     try {
-        if (!results.empty()) {
-            return std::stoul(results[0].at("max_order_id"));
-        }
+        dbConn.queryRows("SELECT MAX(order_id) FROM orders", [&maxOrderId](const DbRow& row) {
+            if (!row.isNull(0)) {
+                maxOrderId = static_cast<unsigned int>(row.asUInt64(0));
+            }
+        });
     } catch (const std::exception& e) {
         LOG_DEBUG("Error loading orders from database: " + std::string(e.what()));
     }
-
-    return 10000;
-}
-
-double OrderGenerator::roundToPrecision(double value, int precision) {
-    double factor = std::pow(10.0, precision);
-    return std::round(value * factor) / factor;
+    return maxOrderId;
 }
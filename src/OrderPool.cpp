@@ -0,0 +1,152 @@
+#include "OrderPool.h"
+#include <utility>
+
+OrderPool::OrderPool(size_t capacity)
+        : freeHead(NULL_HANDLE), used(0), allocations(0) {
+    grow(capacity > 0 ? capacity : 1);
+}
+
+OrderHandle OrderPool::allocate(Order&& order) {
+    if (freeHead == NULL_HANDLE) {
+        // 池耗尽时成倍扩容，句柄是下标所以旧句柄不失效
+        grow(nodes.size() * 2);
+    }
+
+    OrderHandle handle = freeHead;
+    OrderNode& node = nodes[handle];
+    freeHead = node.next;
+    node.order = std::move(order);
+    node.prev = NULL_HANDLE;
+    node.next = NULL_HANDLE;
+    node.userPrev = NULL_HANDLE;
+    node.userNext = NULL_HANDLE;
+    ++used;
+    return handle;
+}
+
+void OrderPool::release(OrderHandle handle) {
+    nodes[handle].next = freeHead;
+    freeHead = handle;
+    --used;
+}
+
+void OrderPool::grow(size_t newCapacity) {
+    size_t oldCapacity = nodes.size();
+    nodes.resize(newCapacity);
+    ++allocations;
+
+    // 新节点按下标顺序挂到 free list 上，先分配低下标，访问更连续
+    for (size_t i = newCapacity; i > oldCapacity; --i) {
+        nodes[i - 1].next = freeHead;
+        freeHead = static_cast<OrderHandle>(i - 1);
+    }
+}
+
+template <typename Key>
+HandleIndex<Key>::HandleIndex(size_t expectedEntries)
+        : mask(0), shift(64), count(0), allocations(0) {
+    size_t slotCount = 16;
+    while (slotCount < expectedEntries * 2) {
+        slotCount <<= 1;
+    }
+    rehash(slotCount);
+}
+
+template <typename Key>
+bool HandleIndex<Key>::insert(Key key, OrderHandle handle) {
+    // 负载因子保持在 0.5 以下，探测链短
+    if ((count + 1) * 2 > slots.size()) {
+        rehash(slots.size() * 2);
+    }
+
+    for (size_t i = slotFor(key); ; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.handle == NULL_HANDLE) {
+            slot.key = key;
+            slot.handle = handle;
+            ++count;
+            return true;
+        }
+        if (slot.key == key) {
+            return false;
+        }
+    }
+}
+
+template <typename Key>
+void HandleIndex<Key>::assign(Key key, OrderHandle handle) {
+    for (size_t i = slotFor(key); ; i = (i + 1) & mask) {
+        Slot& slot = slots[i];
+        if (slot.handle == NULL_HANDLE) {
+            break;
+        }
+        if (slot.key == key) {
+            slot.handle = handle;
+            return;
+        }
+    }
+    insert(key, handle);
+}
+
+template <typename Key>
+OrderHandle HandleIndex<Key>::find(Key key) const {
+    for (size_t i = slotFor(key); ; i = (i + 1) & mask) {
+        const Slot& slot = slots[i];
+        if (slot.handle == NULL_HANDLE) {
+            return NULL_HANDLE;
+        }
+        if (slot.key == key) {
+            return slot.handle;
+        }
+    }
+}
+
+template <typename Key>
+void HandleIndex<Key>::erase(Key key) {
+    size_t i = slotFor(key);
+    while (true) {
+        if (slots[i].handle == NULL_HANDLE) {
+            return;
+        }
+        if (slots[i].key == key) {
+            break;
+        }
+        i = (i + 1) & mask;
+    }
+
+    // 后移删除：把后续探测链上的元素往前挪，保证查找不会提前遇到空位
+    size_t hole = i;
+    for (size_t j = (hole + 1) & mask; slots[j].handle != NULL_HANDLE; j = (j + 1) & mask) {
+        size_t home = slotFor(slots[j].key);
+        bool movable = hole <= j ? (home <= hole || home > j) : (home <= hole && home > j);
+        if (movable) {
+            slots[hole] = slots[j];
+            hole = j;
+        }
+    }
+    slots[hole] = Slot{};
+    --count;
+}
+
+template <typename Key>
+void HandleIndex<Key>::rehash(size_t newSlotCount) {
+    std::vector<Slot> oldSlots(newSlotCount);
+    oldSlots.swap(slots);
+    ++allocations;
+
+    mask = newSlotCount - 1;
+    shift = 64;
+    for (size_t n = newSlotCount; n > 1; n >>= 1) {
+        --shift;
+    }
+    count = 0;
+
+    for (const Slot& slot : oldSlots) {
+        if (slot.handle != NULL_HANDLE) {
+            insert(slot.key, slot.handle);
+        }
+    }
+}
+
+template class HandleIndex<unsigned int>;
+template class HandleIndex<unsigned long long>;
@@ -0,0 +1,98 @@
+#include "OrderRouter.h"
+#include "Serialization.h"
+#include "WireProtocol.h"
+#include "Logger.h"
+#include <algorithm>
+#include <stdexcept>
+
+std::vector<std::vector<Instrument>> assignInstrumentsToShards(const std::vector<Instrument>& instruments, size_t shardCount) {
+    if (shardCount == 0) {
+        throw std::invalid_argument("shardCount must be positive");
+    }
+    std::vector<std::vector<Instrument>> shards(std::min(shardCount, instruments.size()));
+    for (size_t i = 0; i < instruments.size(); ++i) {
+        shards[i % shards.size()].push_back(instruments[i]);
+    }
+    return shards;
+}
+
+OrderRouter::OrderRouter(zmq::socket_t& orderSocket, std::vector<zmq::socket_t>& shardSockets,
+                         const std::vector<std::vector<Instrument>>& shards)
+        : orderSocket(orderSocket), shardSockets(shardSockets), running(false) {
+    for (size_t shard = 0; shard < shards.size(); ++shard) {
+        for (const Instrument& instrument : shards[shard]) {
+            symbolShards[instrument.symbol] = shard;
+        }
+    }
+}
+
+void OrderRouter::run() {
+    LOG_INFO("OrderRouter running. shards: " + std::to_string(shardSockets.size()));
+    running = true;
+    zmq::message_t message;
+    while (running) {
+        try {
+            if (orderSocket.recv(message, zmq::recv_flags::none).has_value()) {
+                route(message);
+            }
+        } catch (const zmq::error_t& e) {
+            // 上下文已关闭，套接字不会再可用
+            if (e.num() == ETERM) {
+                break;
+            }
+            LOG_ERROR("ZeroMQ error in OrderRouter: " + std::string(e.what()));
+        } catch (const std::exception& e) {
+            LOG_ERROR("Error in OrderRouter: " + std::string(e.what()));
+        }
+    }
+    LOG_INFO("OrderRouter stopped.");
+}
+
+void OrderRouter::stop() {
+    running = false;
+}
+
+void OrderRouter::route(zmq::message_t& message) {
+    std::string symbol = readSymbol(message);
+    if (symbol.empty() && isCancelAll(message)) {
+        // 不限交易对的按用户撤单：每个分片各转发一份
+        for (size_t shard = 0; shard < shardSockets.size(); ++shard) {
+            zmq::message_t copy;
+            copy.copy(message);
+            shardSockets[shard].send(copy, zmq::send_flags::none);
+        }
+        return;
+    }
+    auto it = symbolShards.find(symbol);
+    if (it == symbolShards.end()) {
+        LOG_ERROR("OrderRouter dropped message for unknown symbol: " + symbol);
+        return;
+    }
+    // send 之后 message 被置空，所有权交给分片
+    shardSockets[it->second].send(message, zmq::send_flags::none);
+}
+
+std::string OrderRouter::readSymbol(const zmq::message_t& message) {
+    if (isBinaryMessage(message.data(), message.size())) {
+        return readWireSymbol(message.data(), message.size());
+    }
+
+    // JSON 调试模式：撤单、改单、批量下单、快照请求的交易对在顶层，新订单的在内嵌的 order 里
+    Json::Value root = deserializeMessage(static_cast<const char*>(message.data()), message.size());
+    std::string messageType = root["type"].asString();
+    if (messageType == "CANCEL" || messageType == "AMEND" || messageType == "MASS_ORDER" || messageType == "BOOK_SNAPSHOT_REQUEST") {
+        return root.get("symbol", DEFAULT_SYMBOL).asString();
+    }
+    if (messageType == "CANCEL_ALL") {
+        return root.get("symbol", "").asString();
+    }
+    return deserializeEmbeddedMessage(root["order"]).get("symbol", DEFAULT_SYMBOL).asString();
+}
+
+bool OrderRouter::isCancelAll(const zmq::message_t& message) {
+    if (isBinaryMessage(message.data(), message.size())) {
+        return readWireHeader(message.data(), message.size()) == WireMessageType::CANCEL_ALL;
+    }
+    Json::Value root = deserializeMessage(static_cast<const char*>(message.data()), message.size());
+    return root["type"].asString() == "CANCEL_ALL";
+}
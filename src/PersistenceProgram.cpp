@@ -1,8 +1,28 @@
 #include "PersistenceProgram.h"
+#include <algorithm>
+#include <filesystem>
 #include <iostream>
 
-PersistenceProgram::PersistenceProgram(DbConnectionPool& connectionPool, zmq::context_t& context, const std::string& resultServerAddress)
-        : dbConnPool(connectionPool), context(context), resultServerAddress(resultServerAddress), resultSocket(context, zmq::socket_type::pull), running(false) {
+namespace {
+    // 提交失败后的重试间隔，每次失败翻倍，不超过上限
+    constexpr std::chrono::milliseconds COMMIT_RETRY_INITIAL_DELAY(100);
+    constexpr std::chrono::milliseconds COMMIT_RETRY_MAX_DELAY(5000);
+}
+
+PersistenceMetrics::PersistenceMetrics()
+        : messagesReceived(MetricsRegistry::getInstance().counter("persistence_messages_received_total", "Result messages received by writer threads")),
+          batchesCommitted(MetricsRegistry::getInstance().counter("persistence_batches_committed_total", "Batches committed to the database")),
+          batchesFailed(MetricsRegistry::getInstance().counter("persistence_batches_failed_total", "Batch commits that failed and were retried")),
+          rowsDeadLettered(MetricsRegistry::getInstance().counter("persistence_rows_dead_lettered_total", "Rows rejected by the database and written to the dead-letter file")),
+          queueLag(MetricsRegistry::getInstance().latencyHistogram("persistence_queue_lag_seconds", "Time from the engine event to receipt by a writer thread")),
+          batchSize(MetricsRegistry::getInstance().sizeHistogram("persistence_batch_messages", "Messages per committed batch")),
+          commitLatency(MetricsRegistry::getInstance().latencyHistogram("persistence_commit_seconds", "Time to write and commit one batch")) {
+}
+
+PersistenceProgram::PersistenceProgram(DbConnectionPool& connectionPool, zmq::context_t& context, const std::string& resultServerAddress,
+                                       const PersistenceConfig& persistenceConfig, size_t partition, size_t partitionCount)
+        : dbConnPool(connectionPool), context(context), resultServerAddress(resultServerAddress), resultSocket(context, zmq::socket_type::pull), running(false),
+          persistenceConfig(persistenceConfig), partition(partition), partitionCount(partitionCount), batchMessages(0) {
 
     try {
         dbConn = dbConnPool.getConnection(); // 获取连接
@@ -10,7 +30,10 @@ PersistenceProgram::PersistenceProgram(DbConnectionPool& connectionPool, zmq::co
             LOG_ERROR("Failed to get database connection.");
             throw std::runtime_error("Failed to get database connection");
         }
+        batchWriter = std::make_unique<BatchWriter>(*dbConn);
 
+        // 接收超时即批次的最长等待时间，没有新消息时也能按时提交
+        resultSocket.set(zmq::sockopt::rcvtimeo, persistenceConfig.flushIntervalMs);
         resultSocket.connect(resultServerAddress);
     } catch (const std::exception& e) {
         LOG_ERROR("Exception while initializing PersistenceProgram: " + std::string(e.what()));
@@ -19,6 +42,7 @@ PersistenceProgram::PersistenceProgram(DbConnectionPool& connectionPool, zmq::co
 }
 
 PersistenceProgram::~PersistenceProgram() {
+    batchWriter.reset();    // 预编译语句须在归还连接前关闭
     if (dbConn) {
         dbConnPool.returnConnection(dbConn); // 归还连接
     }
@@ -47,42 +71,65 @@ void PersistenceProgram::run() {
             zmq::message_t resultMessage;
             auto result = resultSocket.recv(resultMessage, zmq::recv_flags::none);
             if (!result) {
-                LOG_ERROR("No message received.");
+                // 接收超时：提交已缓冲的批次
+                flushBatch();
                 continue;
             }
 
-            std::string resultData(static_cast<char*>(resultMessage.data()), resultMessage.size());
-            LOG_DEBUG("Received message from resultSocket: " + resultData);
-
-            if (resultData.empty()) {
-                LOG_ERROR("Received empty message.");
-                continue;
+            if (batchMessages == 0) {
+                batchStart = std::chrono::steady_clock::now();
             }
+            ++batchMessages;
+            metrics.messagesReceived.add();
 
-            Json::Value message;
-            Json::CharReaderBuilder reader;
-            std::string errs;
-            std::istringstream s(resultData);
-
-            if (!Json::parseFromStream(reader, s, &message, &errs)) {
-                LOG_ERROR("Failed to parse message: " + errs);
-                continue;
+            try {
+                if (isBinaryMessage(resultMessage.data(), resultMessage.size())) {
+                    processBinaryMessage(resultMessage.data(), resultMessage.size());
+                } else {
+                    processJsonMessage(resultMessage);
+                }
+            } catch (const std::exception& e) {
+                // 只丢弃这一条消息；重建套接字会连同队列里已收到的消息一起丢掉
+                LOG_ERROR("Dropping malformed result message: " + std::string(e.what()));
             }
 
-            PersistenceProgram::processMessage(message);
-
+            if (batchMessages >= persistenceConfig.batchSize ||
+                std::chrono::steady_clock::now() - batchStart >= std::chrono::milliseconds(persistenceConfig.flushIntervalMs)) {
+                flushBatch();
+            }
         } catch (const zmq::error_t& e) {
             LOG_ERROR("ZeroMQ error in PersistenceProgram run loop: " + std::string(e.what()));
             reconnectResultClient();
         } catch (const std::exception& e) {
             LOG_ERROR("Error in PersistenceProgram run loop: " + std::string(e.what()));
-            reconnectResultClient();
         }
 
     }
+    flushBatch();
     LOG_INFO("PersistenceProgram stopped.");
 }
 
+void PersistenceProgram::processJsonMessage(const zmq::message_t& resultMessage) {
+    // JSON 调试模式，直接在消息缓冲区上解析
+    const char* resultData = static_cast<const char*>(resultMessage.data());
+    LOG_DEBUG("Received message from resultSocket: " + std::string(resultData, resultMessage.size()));
+
+    if (resultMessage.size() == 0) {
+        LOG_ERROR("Received empty message.");
+        return;
+    }
+
+    Json::Value message;
+    try {
+        message = deserializeMessage(resultData, resultMessage.size());
+    } catch (const std::runtime_error& e) {
+        LOG_ERROR("Failed to parse message: " + std::string(e.what()));
+        return;
+    }
+
+    processMessage(message);
+}
+
 void PersistenceProgram::processMessage(const Json::Value& message) {
     std::string messageType = message["type"].asString();
     if (messageType == "TRADE") {
@@ -91,17 +138,53 @@ void PersistenceProgram::processMessage(const Json::Value& message) {
     } else if (messageType == "UNMATCHED_ORDER") {
         LOG_DEBUG("Processing UNMATCHED_ORDER message.");
         processUnmatchedOrderMessage(message);
+    } else if (messageType == "CANCELED" || messageType == "EXPIRED" || messageType == "AMENDED") {
+        LOG_DEBUG("Processing " + messageType + " message.");
+        processOrderUpdateMessage(message);
+    } else if (messageType == "CANCEL_REJECTED" || messageType == "AMEND_REJECTED" || messageType == "ORDER_REJECTED") {
+        LOG_WARN(messageType + " orderId: " + std::to_string(message["orderId"].asUInt()) + " reason: " + message["reason"].asString());
     } else {
         LOG_ERROR("Unknown message type received: " + messageType);
     }
 }
 
+void PersistenceProgram::processBinaryMessage(const void* data, size_t size) {
+    WireMessageType type = readWireHeader(data, size);
+    LOG_DEBUG("Processing binary " + wireMessageTypeToString(type) + " message.");
+    switch (type) {
+        case WireMessageType::TRADE: {
+            TradeWireMessage message = decodeWireMessage<TradeWireMessage>(data, size);
+            persistTrade(fromWireOrder(message.buyOrder), fromWireOrder(message.sellOrder), fromWireTrade(message.trade));
+            break;
+        }
+        case WireMessageType::UNMATCHED_ORDER:
+            processOrder(fromWireOrder(decodeWireMessage<OrderWireMessage>(data, size).order));
+            break;
+        case WireMessageType::CANCELED:
+        case WireMessageType::EXPIRED:
+        case WireMessageType::AMENDED:
+            updateOrder(fromWireOrder(decodeWireMessage<OrderWireMessage>(data, size).order));
+            break;
+        case WireMessageType::CANCEL_REJECTED:
+        case WireMessageType::AMEND_REJECTED:
+        case WireMessageType::ORDER_REJECTED: {
+            RejectWireMessage message = decodeWireMessage<RejectWireMessage>(data, size);
+            message.reason[sizeof(message.reason) - 1] = '\0';
+            LOG_WARN(wireMessageTypeToString(type) + " orderId: " + std::to_string(message.orderId) + " reason: " + message.reason);
+            break;
+        }
+        default:
+            LOG_ERROR("Unknown wire message type received: " + std::to_string(static_cast<int>(type)));
+    }
+}
 
 void PersistenceProgram::reconnectResultClient() {
     while (running) {
         try {
             resultSocket.close();
             resultSocket = zmq::socket_t(context, zmq::socket_type::pull);
+            // 新套接字同样需要接收超时，否则没有新消息时批次不会按时提交，stop() 也等不到返回
+            resultSocket.set(zmq::sockopt::rcvtimeo, persistenceConfig.flushIntervalMs);
             resultSocket.connect(resultServerAddress);
             LOG_DEBUG("Reconnected to result server.");
             return;
@@ -113,7 +196,7 @@ void PersistenceProgram::reconnectResultClient() {
 }
 
 void PersistenceProgram::processUnmatchedOrderMessage(const Json::Value& message) {
-    Json::Value orderData = deserializeMessage(message["order"].asString());
+    Json::Value orderData = deserializeEmbeddedMessage(message["order"]);
     if (!orderData.isObject()) {
         LOG_ERROR("Invalid order data: not an object");
         throw std::runtime_error("Invalid order data");
@@ -122,10 +205,20 @@ void PersistenceProgram::processUnmatchedOrderMessage(const Json::Value& message
     processOrder(order);
 }
 
+void PersistenceProgram::processOrderUpdateMessage(const Json::Value& message) {
+    Json::Value orderData = deserializeEmbeddedMessage(message["order"]);
+    if (!orderData.isObject()) {
+        LOG_ERROR("Invalid order data: not an object");
+        throw std::runtime_error("Invalid order data");
+    }
+    Order order = deserializeOrder(orderData);
+    updateOrder(order);
+}
+
 void PersistenceProgram::processTradeMessage(const Json::Value& message) {
-    Json::Value buyOrderData = deserializeMessage(message["buyOrder"].asString());
-    Json::Value sellOrderData = deserializeMessage(message["sellOrder"].asString());
-    Json::Value tradeRecordData = deserializeMessage(message["tradeRecord"].asString());
+    Json::Value buyOrderData = deserializeEmbeddedMessage(message["buyOrder"]);
+    Json::Value sellOrderData = deserializeEmbeddedMessage(message["sellOrder"]);
+    Json::Value tradeRecordData = deserializeEmbeddedMessage(message["tradeRecord"]);
 
     if (!buyOrderData.isObject() || !sellOrderData.isObject() || !tradeRecordData.isObject()) {
         LOG_ERROR("Invalid trade message data: not an object");
@@ -135,39 +228,110 @@ void PersistenceProgram::processTradeMessage(const Json::Value& message) {
     Order buyOrder = deserializeOrder(buyOrderData);
     Order sellOrder = deserializeOrder(sellOrderData);
     TradeRecord trade = deserializeTradeRecord(tradeRecordData);
-
-    executeQuery("START TRANSACTION");
-    processOrder(buyOrder);
-    processOrder(sellOrder);
-    processTradeRecord(trade);
-    executeQuery("COMMIT");
+    persistTrade(buyOrder, sellOrder, trade);
 }
 
-bool PersistenceProgram::executeQuery(const std::string& query) {
-    std::lock_guard<std::mutex> lock(connMutex);
-    return dbConn->executeQuery(query);
+void PersistenceProgram::persistTrade(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade) {
+    recordQueueLag(trade.tradeTime);
+    // 成交消息会发往买卖双方所在分区，各分区只写自己的订单，成交记录由买方分区写入
+    if (ownsOrder(buyOrder.orderId)) {
+        batchWriter->addOrder(buyOrder);
+        batchWriter->addTrade(trade);
+    }
+    if (ownsOrder(sellOrder.orderId)) {
+        batchWriter->addOrder(sellOrder);
+    }
 }
 
 void PersistenceProgram::processOrder(const Order& order) {
-    std::string status = "MATCHING";
-    if(order.filledQuantity >= order.quantity){
-        status = "FULLY_FILLED";
-    }else if(order.filledQuantity > 0){
-        status = "PARTIALLY_FILLED";
+    recordQueueLag(order.updateTime);
+    batchWriter->addOrder(order);
+}
+
+void PersistenceProgram::updateOrder(const Order& order) {
+    recordQueueLag(order.updateTime);
+    batchWriter->addOrder(order);
+}
+
+void PersistenceProgram::flushBatch() {
+    if (batchMessages == 0) {
+        return;
+    }
+    // 临时错误（断线、死锁、锁等待超时）时保留本批数据，重连后重试直到成功；重试期间不再接收新消息，
+    // 结果积压在 ZeroMQ 队列里，队列满后撮合引擎的发送随之阻塞，不会丢弃已发布的结果。
+    // 数据错误（如数值越界）重试也不会成功，改为逐行提交，被拒绝的行写入死信文件后继续
+    auto commitStart = std::chrono::steady_clock::now();
+    std::chrono::milliseconds retryDelay = COMMIT_RETRY_INITIAL_DELAY;
+    auto onRejected = [this](const Order* order, const TradeRecord* trade, unsigned int error, const std::string& message) {
+        deadLetter(order, trade, error, message);
+    };
+    while (!batchWriter->flush()) {
+        metrics.batchesFailed.add();
+        if (!BatchWriter::isTransientError(batchWriter->lastError()) && batchWriter->flushRows(onRejected)) {
+            break;
+        }
+        // 连接恢复前不再尝试提交
+        do {
+            if (!running) {
+                LOG_ERROR("Stopping with an uncommitted batch. orders: " + std::to_string(batchWriter->orderCount()) +
+                          " trades: " + std::to_string(batchWriter->tradeCount()));
+                return;
+            }
+            std::this_thread::sleep_for(retryDelay);
+            retryDelay = std::min(retryDelay * 2, COMMIT_RETRY_MAX_DELAY);
+        } while (!reconnectDatabase());
     }
+    metrics.commitLatency.record(elapsedNanos(commitStart, std::chrono::steady_clock::now()));
+    metrics.batchSize.record(batchMessages);
+    metrics.batchesCommitted.add();
+    batchMessages = 0;
+}
 
-    std::string query = "UPDATE orders SET status = '" + status +
-                        "', filled_quantity = " + std::to_string(order.filledQuantity) +
-                        " WHERE order_id = " + std::to_string(order.orderId);
-    executeQuery(query);
+void PersistenceProgram::deadLetter(const Order* order, const TradeRecord* trade, unsigned int error, const std::string& message) {
+    // 与结果消息一样把记录作为字符串字段内嵌，便于修正后重新投递
+    Json::Value record;
+    record["type"] = order != nullptr ? "ORDER" : "TRADE";
+    record["error"] = error;
+    record["message"] = message;
+    if (order != nullptr) {
+        record["order"] = serializeOrder(*order);
+    } else {
+        record["tradeRecord"] = serializeTradeRecord(*trade);
+    }
+    std::string line = serializeMessage(record);
+    LOG_ERROR("Row rejected by database, dead-lettered: " + line);
+    metrics.rowsDeadLettered.add();
+
+    if (!deadLetters.is_open()) {
+        std::error_code ec;
+        std::filesystem::create_directories(persistenceConfig.deadLetterDir, ec);
+        std::string path = persistenceConfig.deadLetterDir + "/partition-" + std::to_string(partition) + ".jsonl";
+        deadLetters.open(path, std::ios::app);
+        if (!deadLetters.is_open()) {
+            LOG_ERROR("Failed to open dead-letter file: " + path);
+            return;
+        }
+    }
+    deadLetters << line << '\n';
+    deadLetters.flush();
 }
 
-void PersistenceProgram::processTradeRecord(const TradeRecord& trade) {
-    std::string query = "INSERT INTO trade_records (buyer_user_id, seller_user_id, buyer_order_id, seller_order_id, order_type, trade_price, trade_quantity, buyer_fee, seller_fee) VALUES (" +
-                        std::to_string(trade.buyerUserId) + ", " + std::to_string(trade.sellerUserId) + ", " +
-                        std::to_string(trade.buyerOrderId) + ", " + std::to_string(trade.sellerOrderId) + ", '" + trade.orderType + "', " +
-                        std::to_string(trade.tradePrice) + ", " + std::to_string(trade.tradeQuantity) + ", " + std::to_string(trade.buyerFee) + ", " +
-                        std::to_string(trade.sellerFee) + ")";
+bool PersistenceProgram::reconnectDatabase() {
+    // 连接仍可用时（如死锁、锁等待超时）直接重试，断开时重建连接
+    if (dbConn->getConnection() != nullptr && mysql_ping(dbConn->getConnection()) == 0) {
+        return true;
+    }
+    try {
+        dbConn->reconnect();
+        return true;
+    } catch (const std::exception& e) {
+        LOG_ERROR("Error reconnecting to database: " + std::string(e.what()));
+        return false;
+    }
+}
 
-    executeQuery(query);
+void PersistenceProgram::recordQueueLag(Timestamp eventTime) {
+    // 跨进程比较墙上时间，时钟回拨时记为 0
+    int64_t lag = toNanos(nowTimestamp()) - toNanos(eventTime);
+    metrics.queueLag.record(static_cast<uint64_t>(std::max<int64_t>(lag, 0)));
 }
@@ -0,0 +1,82 @@
+#include "ResultDispatcher.h"
+#include "Serialization.h"
+#include "WireProtocol.h"
+#include "Logger.h"
+
+ResultDispatcher::ResultDispatcher(zmq::socket_t& resultSocket, std::vector<zmq::socket_t>& partitionSockets)
+        : resultSocket(resultSocket), partitionSockets(partitionSockets), running(false) {
+}
+
+void ResultDispatcher::run() {
+    LOG_INFO("ResultDispatcher running. partitions: " + std::to_string(partitionSockets.size()));
+    running = true;
+    zmq::message_t message;
+    while (running) {
+        try {
+            if (resultSocket.recv(message, zmq::recv_flags::none).has_value()) {
+                dispatch(message);
+            }
+        } catch (const zmq::error_t& e) {
+            LOG_ERROR("ZeroMQ error in ResultDispatcher: " + std::string(e.what()));
+        } catch (const std::exception& e) {
+            LOG_ERROR("Error in ResultDispatcher: " + std::string(e.what()));
+        }
+    }
+    LOG_INFO("ResultDispatcher stopped.");
+}
+
+void ResultDispatcher::stop() {
+    running = false;
+}
+
+void ResultDispatcher::dispatch(zmq::message_t& message) {
+    uint32_t orderIds[2];
+    size_t count = readOrderIds(message, orderIds);
+    size_t first = persistencePartition(orderIds[0], partitionSockets.size());
+    if (count == 2) {
+        size_t second = persistencePartition(orderIds[1], partitionSockets.size());
+        if (second != first) {
+            // 买卖双方在不同分区时另一方收到一份拷贝
+            zmq::message_t copy(message.data(), message.size());
+            partitionSockets[second].send(copy, zmq::send_flags::none);
+        }
+    }
+    // send 之后 message 被置空，所有权交给分区
+    partitionSockets[first].send(message, zmq::send_flags::none);
+}
+
+size_t ResultDispatcher::readOrderIds(const zmq::message_t& message, uint32_t (&orderIds)[2]) {
+    if (isBinaryMessage(message.data(), message.size())) {
+        switch (readWireHeader(message.data(), message.size())) {
+            case WireMessageType::TRADE: {
+                TradeWireMessage trade = decodeWireMessage<TradeWireMessage>(message.data(), message.size());
+                orderIds[0] = trade.buyOrder.orderId;
+                orderIds[1] = trade.sellOrder.orderId;
+                return 2;
+            }
+            case WireMessageType::CANCEL_REJECTED:
+            case WireMessageType::AMEND_REJECTED:
+            case WireMessageType::ORDER_REJECTED:
+                orderIds[0] = decodeWireMessage<RejectWireMessage>(message.data(), message.size()).orderId;
+                return 1;
+            default:
+                orderIds[0] = decodeWireMessage<OrderWireMessage>(message.data(), message.size()).order.orderId;
+                return 1;
+        }
+    }
+
+    // JSON 调试模式
+    Json::Value root = deserializeMessage(static_cast<const char*>(message.data()), message.size());
+    std::string messageType = root["type"].asString();
+    if (messageType == "TRADE") {
+        orderIds[0] = deserializeEmbeddedMessage(root["buyOrder"])["orderId"].asUInt();
+        orderIds[1] = deserializeEmbeddedMessage(root["sellOrder"])["orderId"].asUInt();
+        return 2;
+    }
+    if (messageType == "CANCEL_REJECTED" || messageType == "AMEND_REJECTED" || messageType == "ORDER_REJECTED") {
+        orderIds[0] = root["orderId"].asUInt();
+        return 1;
+    }
+    orderIds[0] = deserializeEmbeddedMessage(root["order"])["orderId"].asUInt();
+    return 1;
+}
@@ -1,20 +1,23 @@
 #include "Serialization.h"
 #include <iomanip>
 #include <sstream>
+#include <memory>
 #include <stdexcept>
 
-std::string time_point_to_string(const std::chrono::time_point<std::chrono::system_clock>& tp) {
-    std::time_t time = std::chrono::system_clock::to_time_t(tp);
-    char buffer[30];
-    std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&time));
-    return std::string(buffer);
+Json::Value timestampToJson(Timestamp tp) {
+    char buffer[TIMESTAMP_TEXT_LENGTH];
+    size_t length = formatTimestamp(tp, buffer);
+    return Json::Value(buffer, buffer + length);
 }
 
-std::chrono::time_point<std::chrono::system_clock> string_to_time_point(const std::string& s) {
-    std::tm tm = {};
-    std::istringstream iss(s);
-    iss >> std::get_time(&tm, "%Y-%m-%dT%H:%M:%SZ");
-    return std::chrono::system_clock::from_time_t(std::mktime(&tm));
+Timestamp timestampFromJson(const Json::Value& value) {
+    // 直接在 JSON 字符串上解析，不拷贝成 std::string
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    if (!value.isString() || !value.getString(&begin, &end)) {
+        throw std::invalid_argument("Timestamp field is not a string");
+    }
+    return parseTimestamp(begin, static_cast<size_t>(end - begin));
 }
 
 std::string orderSideToString(OrderSide side) {
@@ -45,6 +48,24 @@ OrderType stringToOrderType(const std::string& str) {
     return OrderType::UNKNOWN;
 }
 
+std::string timeInForceToString(TimeInForce timeInForce) {
+    switch (timeInForce) {
+        case TimeInForce::GTC: return "GTC";
+        case TimeInForce::IOC: return "IOC";
+        case TimeInForce::FOK: return "FOK";
+        case TimeInForce::POST_ONLY: return "POST_ONLY";
+        default: return "UNKNOWN";
+    }
+}
+
+TimeInForce stringToTimeInForce(const std::string& str) {
+    if (str == "GTC") return TimeInForce::GTC;
+    if (str == "IOC") return TimeInForce::IOC;
+    if (str == "FOK") return TimeInForce::FOK;
+    if (str == "POST_ONLY") return TimeInForce::POST_ONLY;
+    return TimeInForce::UNKNOWN;
+}
+
 std::string orderStatusToString(OrderStatus status) {
     switch (status) {
         case OrderStatus::INITIAL: return "INITIAL";
@@ -70,19 +91,21 @@ OrderStatus stringToOrderStatus(const std::string& str) {
 std::string serializeOrder(const Order& order) {
     Json::Value root;
     root["orderId"] = order.orderId;
-    root["userId"] = order.userId;
-    root["price"] = std::to_string(order.price);
-    root["quantity"] = std::to_string(order.quantity);
-    root["feeRate"] = std::to_string(order.feeRate);
+    root["userId"] = static_cast<Json::UInt64>(order.userId);
+    root["symbol"] = order.symbol;
+    root["price"] = formatFixed(order.price, PRICE_DECIMALS);
+    root["quantity"] = formatFixed(order.quantity, QUANTITY_DECIMALS);
+    root["feeRate"] = formatFixed(order.feeRate, FEE_RATE_DECIMALS);
     root["orderSide"] = orderSideToString(order.orderSide);
     root["orderType"] = orderTypeToString(order.orderType);
     root["status"] = orderStatusToString(order.status);
-    root["createTime"] = time_point_to_string(order.createTime);
-    root["updateTime"] = time_point_to_string(order.updateTime);
-    root["filledQuantity"] = std::to_string(order.filledQuantity);
+    root["timeInForce"] = timeInForceToString(order.timeInForce);
+    root["createTime"] = timestampToJson(order.createTime);
+    root["updateTime"] = timestampToJson(order.updateTime);
+    root["filledQuantity"] = formatFixed(order.filledQuantity, QUANTITY_DECIMALS);
     Json::StreamWriterBuilder writer;
     writer["indentation"] = ""; // 去掉换行符和缩进
-    LOG_DEBUG("serialize orders. orderId:" + std::to_string(order.orderId) + " price:" + std::to_string(order.price));
+    LOG_DEBUG("serialize orders. orderId:" + std::to_string(order.orderId) + " price:" + formatFixed(order.price, PRICE_DECIMALS));
     LOG_DEBUG("serialize orders. json:" + Json::writeString(writer, root));
     return Json::writeString(writer, root);
 }
@@ -97,15 +120,17 @@ Order deserializeOrder(const Json::Value& root) {
     try {
         order.orderId = root["orderId"].asUInt();
         order.userId = root["userId"].asUInt64();
-        order.price = convertStringToDouble(root, "price");
-        order.quantity = convertStringToDouble(root, "quantity");
-        order.feeRate = convertStringToDouble(root, "feeRate");
+        order.symbol = root.get("symbol", DEFAULT_SYMBOL).asString();
+        order.price = convertStringToFixed(root, "price", PRICE_DECIMALS);
+        order.quantity = convertStringToFixed(root, "quantity", QUANTITY_DECIMALS);
+        order.feeRate = convertStringToFixed(root, "feeRate", FEE_RATE_DECIMALS);
         order.orderSide = stringToOrderSide(root["orderSide"].asString());
         order.orderType = stringToOrderType(root["orderType"].asString());
         order.status = stringToOrderStatus(root["status"].asString());
-        order.createTime = string_to_time_point(root["createTime"].asString());
-        order.updateTime = string_to_time_point(root["updateTime"].asString());
-        order.filledQuantity = convertStringToDouble(root, "filledQuantity");
+        order.timeInForce = stringToTimeInForce(root.get("timeInForce", "GTC").asString());
+        order.createTime = timestampFromJson(root["createTime"]);
+        order.updateTime = timestampFromJson(root["updateTime"]);
+        order.filledQuantity = convertStringToFixed(root, "filledQuantity", QUANTITY_DECIMALS);
     } catch (const std::exception& e) {
         throw std::runtime_error("Error deserializing Order: " + std::string(e.what()));
     }
@@ -115,17 +140,17 @@ Order deserializeOrder(const Json::Value& root) {
 
 std::string serializeTradeRecord(const TradeRecord& trade) {
     Json::Value root;
-    root["tradeId"] = trade.tradeId;
-    root["buyerUserId"] = trade.buyerUserId;
-    root["sellerUserId"] = trade.sellerUserId;
+    root["tradeId"] = static_cast<Json::UInt64>(trade.tradeId);
+    root["buyerUserId"] = static_cast<Json::UInt64>(trade.buyerUserId);
+    root["sellerUserId"] = static_cast<Json::UInt64>(trade.sellerUserId);
     root["buyerOrderId"] = trade.buyerOrderId;
     root["sellerOrderId"] = trade.sellerOrderId;
     root["orderType"] = trade.orderType;
-    root["tradePrice"] = std::to_string(trade.tradePrice);
-    root["tradeQuantity"] = std::to_string(trade.tradeQuantity);
-    root["buyerFee"] = std::to_string(trade.buyerFee);
-    root["sellerFee"] = std::to_string(trade.sellerFee);
-    root["tradeTime"] = time_point_to_string(trade.tradeTime);
+    root["tradePrice"] = formatFixed(trade.tradePrice, PRICE_DECIMALS);
+    root["tradeQuantity"] = formatFixed(trade.tradeQuantity, QUANTITY_DECIMALS);
+    root["buyerFee"] = formatFixed(trade.buyerFee, AMOUNT_DECIMALS);
+    root["sellerFee"] = formatFixed(trade.sellerFee, AMOUNT_DECIMALS);
+    root["tradeTime"] = timestampToJson(trade.tradeTime);
     Json::StreamWriterBuilder writer;
     writer["indentation"] = ""; // 去掉换行符和缩进
     return Json::writeString(writer, root);
@@ -139,17 +164,17 @@ TradeRecord deserializeTradeRecord(const Json::Value& root) {
     }
 
     try {
-        trade.tradeId = root["tradeId"].asUInt();
+        trade.tradeId = root["tradeId"].asUInt64();
         trade.buyerUserId = root["buyerUserId"].asUInt64();
         trade.sellerUserId = root["sellerUserId"].asUInt64();
         trade.buyerOrderId = root["buyerOrderId"].asUInt();
         trade.sellerOrderId = root["sellerOrderId"].asUInt();
         trade.orderType = root["orderType"].asString();
-        trade.tradePrice = convertStringToDouble(root, "tradePrice");
-        trade.tradeQuantity = convertStringToDouble(root, "tradeQuantity");
-        trade.buyerFee = convertStringToDouble(root, "buyerFee");
-        trade.sellerFee = convertStringToDouble(root, "sellerFee");
-        trade.tradeTime = string_to_time_point(root["tradeTime"].asString());
+        trade.tradePrice = convertStringToFixed(root, "tradePrice", PRICE_DECIMALS);
+        trade.tradeQuantity = convertStringToFixed(root, "tradeQuantity", QUANTITY_DECIMALS);
+        trade.buyerFee = convertStringToFixed(root, "buyerFee", AMOUNT_DECIMALS);
+        trade.sellerFee = convertStringToFixed(root, "sellerFee", AMOUNT_DECIMALS);
+        trade.tradeTime = timestampFromJson(root["tradeTime"]);
     } catch (const std::exception& e) {
         throw std::runtime_error("Error deserializing TradeRecord: " + std::string(e.what()));
     }
@@ -163,12 +188,16 @@ std::string serializeMessage(const Json::Value& message) {
 }
 
 Json::Value deserializeMessage(const std::string& data) {
+    return deserializeMessage(data.data(), data.size());
+}
+
+Json::Value deserializeMessage(const char* data, size_t size) {
+    // CharReader 线程内复用，避免每条消息重新构造
+    thread_local std::unique_ptr<Json::CharReader> reader(Json::CharReaderBuilder().newCharReader());
     Json::Value root;
-    Json::CharReaderBuilder reader;
-    std::istringstream s(data);
     std::string errs;
 
-    if (!Json::parseFromStream(reader, s, &root, &errs)) {
+    if (!reader->parse(data, data + size, &root, &errs)) {
         LOG_DEBUG("Failed to parse JSON: " + errs);
         throw std::runtime_error("Failed to parse JSON");
     }
@@ -176,15 +205,24 @@ Json::Value deserializeMessage(const std::string& data) {
     return root;
 }
 
-// 转换字符串到 double 的辅助函数
-double convertStringToDouble(const Json::Value& value, const std::string& key) {
+Json::Value deserializeEmbeddedMessage(const Json::Value& field) {
+    const char* begin = nullptr;
+    const char* end = nullptr;
+    if (!field.isString() || !field.getString(&begin, &end)) {
+        throw std::runtime_error("Failed to parse JSON: embedded message is not a string");
+    }
+    return deserializeMessage(begin, static_cast<size_t>(end - begin));
+}
+
+// 转换十进制字符串到定点数的辅助函数
+int64_t convertStringToFixed(const Json::Value& value, const std::string& key, int decimals) {
     if (!value.isMember(key) || !value[key].isString()) {
         throw std::invalid_argument("Key is missing or not a string in JSON object: " + key);
     }
 
     const std::string& strValue = value[key].asString();
     try {
-        return std::stod(strValue);
+        return parseFixed(strValue, decimals);
     } catch (const std::exception& e) {
         throw std::runtime_error("Conversion error for key " + key + ": " + std::string(e.what()));
     }
@@ -0,0 +1,165 @@
+#include "Snapshot.h"
+#include "Journal.h"
+#include "WireProtocol.h"
+#include "Logger.h"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+#pragma pack(push, 1)
+    struct SnapshotHeader {
+        uint32_t magic;
+        uint16_t version;
+        uint16_t reserved;
+        uint64_t sequence;
+        uint64_t orderCount;
+        uint64_t tradeSequence;
+    };
+#pragma pack(pop)
+
+    bool writeFully(int fd, const void* data, size_t size) {
+        const char* bytes = static_cast<const char*>(data);
+        while (size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    }
+}
+
+void writeSnapshot(const std::string& path, uint64_t sequence, uint64_t tradeSequence, const std::vector<WireOrder>& orders) {
+    SnapshotHeader header{SNAPSHOT_MAGIC, SNAPSHOT_VERSION, 0, sequence, orders.size(), tradeSequence};
+    std::string tmpPath = path + ".tmp";
+    int fd = ::open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Could not open snapshot file: " + tmpPath + ": " + std::strerror(errno));
+    }
+    // 临时文件刷盘后再改名，改名后刷目录，返回时新快照已落盘
+    bool written = writeFully(fd, &header, sizeof(header)) &&
+                   writeFully(fd, orders.data(), orders.size() * sizeof(WireOrder)) &&
+                   ::fsync(fd) == 0;
+    std::string error = written ? "" : std::strerror(errno);
+    ::close(fd);
+    if (!written) {
+        throw std::runtime_error("Failed to write snapshot file: " + tmpPath + ": " + error);
+    }
+    if (std::rename(tmpPath.c_str(), path.c_str()) != 0) {
+        throw std::runtime_error("Failed to rename snapshot file: " + tmpPath);
+    }
+    syncParentDirectory(path);
+}
+
+bool readSnapshot(const std::string& path, BookSnapshot& snapshot) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    SnapshotHeader header{};
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header)) || header.magic != SNAPSHOT_MAGIC ||
+        header.version != SNAPSHOT_VERSION) {
+        throw std::runtime_error("Invalid snapshot file: " + path);
+    }
+
+    // 先按文件剩余长度核对订单数，损坏的计数不会触发巨大的分配；除法避免乘法溢出
+    std::streamoff headerEnd = file.tellg();
+    file.seekg(0, std::ios::end);
+    uint64_t remaining = static_cast<uint64_t>(file.tellg() - headerEnd);
+    file.seekg(headerEnd);
+    if (remaining % sizeof(WireOrder) != 0 || header.orderCount != remaining / sizeof(WireOrder)) {
+        throw std::runtime_error("Snapshot file size does not match its order count: " + path);
+    }
+
+    std::vector<WireOrder> wireOrders(header.orderCount);
+    if (!file.read(reinterpret_cast<char*>(wireOrders.data()), wireOrders.size() * sizeof(WireOrder))) {
+        throw std::runtime_error("Truncated snapshot file: " + path);
+    }
+
+    snapshot.sequence = header.sequence;
+    snapshot.tradeSequence = header.tradeSequence;
+    snapshot.orders.clear();
+    snapshot.orders.reserve(wireOrders.size());
+    for (const WireOrder& wire : wireOrders) {
+        snapshot.orders.push_back(fromWireOrder(wire));
+    }
+    return true;
+}
+
+SnapshotWriter::SnapshotWriter(const std::atomic<uint64_t>& flushesSent)
+        : flushesSent(flushesSent), pending(false), stopping(false) {
+    thread = std::thread(&SnapshotWriter::run, this);
+}
+
+SnapshotWriter::~SnapshotWriter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    condition.notify_all();
+    thread.join();
+}
+
+void SnapshotWriter::submit(SnapshotJob& next) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::swap(job, next);
+        pending = true;
+    }
+    condition.notify_all();
+}
+
+void SnapshotWriter::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    condition.wait(lock, [this]() { return !pending; });
+}
+
+void SnapshotWriter::run() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        condition.wait(lock, [this]() { return pending || stopping; });
+        if (!pending) {
+            return;
+        }
+        // 等发布线程发完复制前的结果；停止时仍未发完则放弃
+        while (!stopping && flushesSent.load(std::memory_order_acquire) < job.flushes) {
+            condition.wait_for(lock, std::chrono::milliseconds(1));
+        }
+        if (flushesSent.load(std::memory_order_acquire) < job.flushes) {
+            pending = false;
+            condition.notify_all();
+            return;
+        }
+        // 写盘期间不持锁，撮合线程只读 pending，不会在此期间交换任务
+        lock.unlock();
+        write(job);
+        lock.lock();
+        pending = false;
+        condition.notify_all();
+    }
+}
+
+void SnapshotWriter::write(SnapshotJob& current) {
+    try {
+        writeSnapshot(current.path, current.sequence, current.tradeSequence, current.orders);
+        // 快照落盘后删除旧日志段，顺带预建下一段，刷目录一并提交删除和新建
+        Journal::removeSegmentsBefore(current.journalPath, current.journalSegment);
+        Journal::prepareSegment(current.journalPath, current.journalSegment + 1);
+        LOG_INFO("Wrote snapshot for " + current.symbol + " at sequence " + std::to_string(current.sequence) +
+                 ". resting orders: " + std::to_string(current.orders.size()));
+    } catch (const std::exception& e) {
+        // 旧日志段保留，下次快照时一并删除
+        LOG_ERROR("Failed to snapshot " + current.symbol + ": " + std::string(e.what()));
+    }
+}
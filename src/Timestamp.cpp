@@ -0,0 +1,165 @@
+#include "Timestamp.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+    constexpr int64_t NANOS_PER_SECOND = 1000000000;
+    constexpr int64_t SECONDS_PER_DAY = 86400;
+    constexpr size_t DATE_PREFIX_LENGTH = 11;      // "YYYY-MM-DDT"
+
+    // 向负无穷取整的除法，epoch 之前的时间也能正确拆分
+    int64_t floorDiv(int64_t value, int64_t divisor) {
+        int64_t quotient = value / divisor;
+        return (value % divisor < 0) ? quotient - 1 : quotient;
+    }
+
+    // 公历日期与自 1970-01-01 起天数的互换（Howard Hinnant 的 days_from_civil / civil_from_days）
+    int64_t daysFromCivil(int64_t year, unsigned month, unsigned day) {
+        year -= month <= 2;
+        int64_t era = floorDiv(year, 400);
+        unsigned yearOfEra = static_cast<unsigned>(year - era * 400);
+        unsigned dayOfYear = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+        unsigned dayOfEra = yearOfEra * 365 + yearOfEra / 4 - yearOfEra / 100 + dayOfYear;
+        return era * 146097 + static_cast<int64_t>(dayOfEra) - 719468;
+    }
+
+    void civilFromDays(int64_t days, int64_t& year, unsigned& month, unsigned& day) {
+        days += 719468;
+        int64_t era = floorDiv(days, 146097);
+        unsigned dayOfEra = static_cast<unsigned>(days - era * 146097);
+        unsigned yearOfEra = (dayOfEra - dayOfEra / 1460 + dayOfEra / 36524 - dayOfEra / 146096) / 365;
+        unsigned dayOfYear = dayOfEra - (365 * yearOfEra + yearOfEra / 4 - yearOfEra / 100);
+        unsigned mp = (5 * dayOfYear + 2) / 153;
+        day = dayOfYear - (153 * mp + 2) / 5 + 1;
+        month = mp < 10 ? mp + 3 : mp - 9;
+        year = static_cast<int64_t>(yearOfEra) + era * 400 + (month <= 2);
+    }
+
+    void writeDigits(char* out, uint64_t value, size_t width) {
+        for (size_t i = width; i > 0; --i) {
+            out[i - 1] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        }
+    }
+
+    // 按线程缓存最近一次格式化的日期前缀
+    struct DatePrefixCache {
+        int64_t day = INT64_MIN;
+        char prefix[DATE_PREFIX_LENGTH];
+    };
+
+    const char* datePrefix(int64_t days) {
+        thread_local DatePrefixCache cache;
+        if (cache.day != days) {
+            int64_t year;
+            unsigned month, day;
+            civilFromDays(days, year, month, day);
+            writeDigits(cache.prefix, static_cast<uint64_t>(year), 4);
+            cache.prefix[4] = '-';
+            writeDigits(cache.prefix + 5, month, 2);
+            cache.prefix[7] = '-';
+            writeDigits(cache.prefix + 8, day, 2);
+            cache.prefix[10] = 'T';
+            cache.day = days;
+        }
+        return cache.prefix;
+    }
+
+    [[noreturn]] void invalidTimestamp(const char* text, size_t length) {
+        throw std::invalid_argument("Invalid timestamp: " + std::string(text, length));
+    }
+
+    unsigned readDigits(const char* text, size_t length, size_t offset, size_t width) {
+        if (offset + width > length) {
+            invalidTimestamp(text, length);
+        }
+        unsigned value = 0;
+        for (size_t i = offset; i < offset + width; ++i) {
+            if (text[i] < '0' || text[i] > '9') {
+                invalidTimestamp(text, length);
+            }
+            value = value * 10 + static_cast<unsigned>(text[i] - '0');
+        }
+        return value;
+    }
+
+    void expect(const char* text, size_t length, size_t offset, char c) {
+        if (offset >= length || text[offset] != c) {
+            invalidTimestamp(text, length);
+        }
+    }
+}
+
+size_t formatTimestamp(Timestamp tp, char* buffer) {
+    int64_t nanos = toNanos(tp);
+    int64_t seconds = floorDiv(nanos, NANOS_PER_SECOND);
+    int64_t days = floorDiv(seconds, SECONDS_PER_DAY);
+    int64_t secondOfDay = seconds - days * SECONDS_PER_DAY;
+
+    std::memcpy(buffer, datePrefix(days), DATE_PREFIX_LENGTH);
+    char* p = buffer + DATE_PREFIX_LENGTH;
+    writeDigits(p, static_cast<uint64_t>(secondOfDay / 3600), 2);
+    p[2] = ':';
+    writeDigits(p + 3, static_cast<uint64_t>(secondOfDay / 60 % 60), 2);
+    p[5] = ':';
+    writeDigits(p + 6, static_cast<uint64_t>(secondOfDay % 60), 2);
+    p[8] = '.';
+    writeDigits(p + 9, static_cast<uint64_t>(nanos - seconds * NANOS_PER_SECOND), 9);
+    p[18] = 'Z';
+    return TIMESTAMP_TEXT_LENGTH;
+}
+
+std::string formatTimestamp(Timestamp tp) {
+    char buffer[TIMESTAMP_TEXT_LENGTH];
+    return std::string(buffer, formatTimestamp(tp, buffer));
+}
+
+Timestamp parseTimestamp(const char* text, size_t length) {
+    unsigned year = readDigits(text, length, 0, 4);
+    expect(text, length, 4, '-');
+    unsigned month = readDigits(text, length, 5, 2);
+    expect(text, length, 7, '-');
+    unsigned day = readDigits(text, length, 8, 2);
+    if (length <= 10 || (text[10] != 'T' && text[10] != ' ')) {
+        invalidTimestamp(text, length);
+    }
+    unsigned hour = readDigits(text, length, 11, 2);
+    expect(text, length, 13, ':');
+    unsigned minute = readDigits(text, length, 14, 2);
+    expect(text, length, 16, ':');
+    unsigned second = readDigits(text, length, 17, 2);
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) {
+        invalidTimestamp(text, length);
+    }
+
+    // 小数秒最多 9 位，不足补零
+    size_t offset = 19;
+    int64_t fraction = 0;
+    if (offset < length && text[offset] == '.') {
+        size_t digits = 0;
+        for (++offset; offset < length && text[offset] >= '0' && text[offset] <= '9'; ++offset, ++digits) {
+            if (digits < 9) {
+                fraction = fraction * 10 + (text[offset] - '0');
+            }
+        }
+        if (digits == 0) {
+            invalidTimestamp(text, length);
+        }
+        for (; digits < 9; ++digits) {
+            fraction *= 10;
+        }
+    }
+    if (offset < length && text[offset] == 'Z') {
+        ++offset;
+    }
+    if (offset != length) {
+        invalidTimestamp(text, length);
+    }
+
+    int64_t seconds = daysFromCivil(year, month, day) * SECONDS_PER_DAY + hour * 3600 + minute * 60 + second;
+    return fromNanos(seconds * NANOS_PER_SECOND + fraction);
+}
+
+Timestamp parseTimestamp(const std::string& text) {
+    return parseTimestamp(text.data(), text.size());
+}
@@ -1,9 +1,61 @@
 #include "WebSocketServer.h"
 #include "Logger.h"
+#include "WireProtocol.h"
+#include "MarketData.h"
+#include "Serialization.h"
 #include <iostream>
 
-WebSocketServer::WebSocketServer(const std::string& host, int port, zmq::context_t& context, const std::string& bookServerAddress)
-        : host_(host), port_(port), bookSocket(context, zmq::socket_type::sub), running_(false) {
+namespace {
+    std::string depthKey(const std::string& symbol, size_t depth) {
+        return "depth:" + symbol + ":" + std::to_string(depth);
+    }
+
+    std::string tradesKey(const std::string& symbol) {
+        return "trades:" + symbol;
+    }
+
+    std::string klineKey(const std::string& symbol, const std::string& interval) {
+        return "kline:" + symbol + ":" + interval;
+    }
+
+    PublicationPtr makePublication(Publication::Kind kind, const std::string& key, std::string&& payload) {
+        return std::make_shared<const Publication>(Publication{kind, key, std::move(payload), nullptr});
+    }
+
+    // 按 RFC 6455 服务端的格式预先组好文本帧：不掩码、不压缩，连接发送已组帧的消息时直接放进发送队列
+    server::message_ptr prepareTextFrame(const server::connection_ptr& con, const std::string& payload) {
+        server::message_ptr message = con->get_message(websocketpp::frame::opcode::text, payload.size());
+        message->set_payload(payload);
+        websocketpp::frame::basic_header header(websocketpp::frame::opcode::text, payload.size(), true, false);
+        message->set_header(websocketpp::frame::prepare_header(header, websocketpp::frame::extended_header(payload.size())));
+        message->set_prepared(true);
+        return message;
+    }
+
+    // 订阅应答：{"type": "SUBSCRIBED" | "UNSUBSCRIBED" | "ERROR", "subscription", "message"}
+    PublicationPtr makeControl(const std::string& type, const std::string& key, const std::string& error = "") {
+        Json::Value message;
+        message["type"] = type;
+        if (!key.empty()) {
+            message["subscription"] = key;
+        }
+        if (!error.empty()) {
+            message["message"] = error;
+        }
+        return makePublication(Publication::Kind::CONTROL, key, serializeMessage(message));
+    }
+}
+
+GatewayMetrics::GatewayMetrics()
+        : framesSent(MetricsRegistry::getInstance().counter("gateway_frames_sent_total", "WebSocket frames written to clients")),
+          framesDropped(MetricsRegistry::getInstance().counter("gateway_frames_dropped_total", "Queued frames dropped or coalesced for slow clients")),
+          fanOutLatency(MetricsRegistry::getInstance().latencyHistogram("gateway_fan_out_seconds", "Time to queue one upstream update for all subscribers")) {
+}
+
+WebSocketServer::WebSocketServer(const std::string& host, int port, zmq::context_t& context, const std::string& bookServerAddress,
+                                 const GatewayConfig& gatewayConfig)
+        : host_(host), port_(port), bookSocket(context, zmq::socket_type::sub), config_(gatewayConfig),
+          flushScheduled_(false), retryScheduled_(false), running_(false) {
     bookSocket.connect(bookServerAddress);
     bookSocket.set(zmq::sockopt::subscribe, ""); // 订阅所有消息
 }
@@ -15,14 +67,14 @@ WebSocketServer::~WebSocketServer() {
 void WebSocketServer::start() {
     running_ = true;
 
-    // 启动接收线程
-    receiveThread_ = std::thread(&WebSocketServer::receive_order_book, this);
-
     m_server.init_asio();
     m_server.set_open_handler(bind(&WebSocketServer::on_open, this, std::placeholders::_1));
     m_server.set_close_handler(bind(&WebSocketServer::on_close, this, std::placeholders::_1));
     m_server.set_message_handler(bind(&WebSocketServer::on_message, this, std::placeholders::_1, std::placeholders::_2));
 
+    // 启动接收线程；推送经 io_service 投递，需在 init_asio 之后
+    receiveThread_ = std::thread(&WebSocketServer::receive_order_book, this);
+
     m_server.listen(port_);
     m_server.start_accept();
     m_server.run();
@@ -39,14 +91,18 @@ void WebSocketServer::stop() {
 void WebSocketServer::receive_order_book() {
     while (running_) {
         try {
+            // 行情消息为两帧：交易对主题 + 消息内容
+            zmq::message_t topic;
             zmq::message_t message;
-            auto result = bookSocket.recv(message, zmq::recv_flags::none);
-            if (result) {
-                std::string orderBookData(static_cast<char*>(message.data()), message.size());
-                std::lock_guard<std::mutex> lock(orderBookMutex_);
-                latestOrderBook_ = orderBookData;
-                LOG_DEBUG("Received order book data");
-                send_to_all(orderBookData);
+            if (bookSocket.recv(topic, zmq::recv_flags::none) && topic.more() &&
+                bookSocket.recv(message, zmq::recv_flags::none)) {
+                LOG_DEBUG("Received market data");
+                std::string symbol(static_cast<const char*>(topic.data()), topic.size());
+                if (readMarketDataType(message.data(), message.size()) == WireMessageType::TRADE_PRINTS) {
+                    handle_trades(symbol, message);
+                } else {
+                    handle_depth(symbol, message);
+                }
             }
         } catch (const zmq::error_t& e) {
             std::cerr << "ZeroMQ error in receive_order_book: " << e.what() << std::endl;
@@ -56,23 +112,365 @@ void WebSocketServer::receive_order_book() {
     }
 }
 
-void WebSocketServer::send_to_all(const std::string& message) {
-    std::lock_guard<std::mutex> lock(m_connection_lock);
-    for (auto conn : m_connections) {
-        m_server.send(conn, message, websocketpp::frame::opcode::text);
+void WebSocketServer::handle_depth(const std::string& symbol, const zmq::message_t& message) {
+    DepthUpdate update = parseDepthMessage(message.data(), message.size());
+    std::lock_guard<std::mutex> bookLock(orderBookMutex_);
+    DepthBook& book = orderBooks_[symbol];
+    if (!book.apply(update)) {
+        // 断档：各视图保持上次发布的状态，等待上游下一次快照
+        return;
+    }
+
+    // 每种订阅档数各求一次增量、序列化一次，由该档数的所有订阅者共享
+    auto views = depthViews_.find(symbol);
+    if (views == depthViews_.end()) {
+        return;
+    }
+    std::vector<PublicationPtr> publications;
+    DepthUpdate viewUpdate;
+    for (auto& entry : views->second) {
+        if (entry.second.delta(book, viewUpdate)) {
+            publications.push_back(makePublication(Publication::Kind::DEPTH_DELTA, depthKey(symbol, entry.first),
+                                                   serializeDepthUpdate(symbol, viewUpdate)));
+        }
+    }
+    if (!publications.empty()) {
+        fan_out(publications);
     }
 }
 
+void WebSocketServer::handle_trades(const std::string& symbol, const zmq::message_t& message) {
+    std::vector<TradePrint> trades = parseTradePrintsMessage(message.data(), message.size());
+    if (trades.empty()) {
+        return;
+    }
+    std::vector<PublicationPtr> publications;
+    publications.push_back(makePublication(Publication::Kind::TRADES, tradesKey(symbol), serializeTradePrints(symbol, trades)));
+
+    // 每批成交后推送各周期更新后的当前 K 线
+    std::lock_guard<std::mutex> klineLock(klineMutex_);
+    for (const KlineSeries& series : klines_.addTrades(symbol, trades)) {
+        publications.push_back(makePublication(Publication::Kind::KLINE, klineKey(symbol, series.name()),
+                                               serializeKline(symbol, series, *series.latest())));
+    }
+    fan_out(publications);
+}
+
 void WebSocketServer::on_open(websocketpp::connection_hdl hdl) {
+    // 新连接不会收到任何行情，直到订阅
+    websocketpp::lib::error_code ec;
+    server::connection_ptr con = m_server.get_con_from_hdl(hdl, ec);
     std::lock_guard<std::mutex> lock(m_connection_lock);
-    m_connections.insert(hdl);
+    ClientSession& session = sessions_[hdl];
+    if (!ec && con->get_request_header("Sec-WebSocket-Version").empty()) {
+        session.sharedFrames = false;
+    }
 }
 
 void WebSocketServer::on_close(websocketpp::connection_hdl hdl) {
     std::lock_guard<std::mutex> lock(m_connection_lock);
-    m_connections.erase(hdl);
+    auto it = sessions_.find(hdl);
+    if (it == sessions_.end()) {
+        return;
+    }
+    for (const std::string& key : it->second.subscriptions) {
+        auto subscribers = subscribers_.find(key);
+        subscribers->second.erase(hdl);
+        if (subscribers->second.empty()) {
+            subscribers_.erase(subscribers);
+        }
+    }
+    if (it->second.droppedMessages > 0) {
+        LOG_INFO("WebSocket client closed after dropping " + std::to_string(it->second.droppedMessages) + " messages");
+    }
+    sessions_.erase(it);
 }
 
 void WebSocketServer::on_message(websocketpp::connection_hdl hdl, server::message_ptr msg) {
-    std::cout << "Received message: " << msg->get_payload() << std::endl;
+    std::string op;
+    std::string channel;
+    std::string symbol;
+    size_t depth;
+    std::string interval;
+    try {
+        Json::Value request = deserializeMessage(msg->get_payload());
+        op = request.get("op", "").asString();
+        channel = request.get("channel", "").asString();
+        symbol = request.get("symbol", "").asString();
+        depth = request.get("depth", static_cast<Json::UInt64>(config_.maxDepth)).asUInt64();
+        interval = request.get("interval", "1m").asString();
+    } catch (const std::exception&) {
+        reject(hdl, "Invalid request");
+        return;
+    }
+    if (symbol.empty()) {
+        reject(hdl, "Missing symbol");
+        return;
+    }
+
+    if (op == "subscribe") {
+        subscribe(hdl, channel, symbol, depth, interval);
+    } else if (op == "unsubscribe") {
+        if (channel == "depth") {
+            unsubscribe(hdl, depthKey(symbol, depth));
+        } else if (channel == "trades") {
+            unsubscribe(hdl, tradesKey(symbol));
+        } else if (channel == "kline") {
+            unsubscribe(hdl, klineKey(symbol, interval));
+        } else {
+            reject(hdl, "Unknown channel: " + channel);
+        }
+    } else {
+        reject(hdl, "Unknown op: " + op);
+    }
+}
+
+void WebSocketServer::subscribe(websocketpp::connection_hdl hdl, const std::string& channel, const std::string& symbol,
+                                size_t depth, const std::string& interval) {
+    // 注册订阅者与取初始状态在同一组锁内完成，之后的增量一定接在初始快照之后
+    if (channel == "depth") {
+        if (depth == 0 || depth > config_.maxDepth) {
+            reject(hdl, "depth must be between 1 and " + std::to_string(config_.maxDepth));
+            return;
+        }
+        std::string key = depthKey(symbol, depth);
+        std::lock_guard<std::mutex> bookLock(orderBookMutex_);
+        PublicationPtr snapshot = makePublication(Publication::Kind::DEPTH_SNAPSHOT, key,
+                                                  serializeDepthUpdate(symbol, depth_view(symbol, depth).published()));
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        auto session = sessions_.find(hdl);
+        if (session == sessions_.end() || !session->second.subscriptions.insert(key).second) {
+            return;
+        }
+        subscribers_[key].insert(hdl);
+        enqueue(session->second, makeControl("SUBSCRIBED", key));
+        enqueue(session->second, snapshot);
+    } else if (channel == "trades") {
+        std::string key = tradesKey(symbol);
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        auto session = sessions_.find(hdl);
+        if (session == sessions_.end() || !session->second.subscriptions.insert(key).second) {
+            return;
+        }
+        subscribers_[key].insert(hdl);
+        enqueue(session->second, makeControl("SUBSCRIBED", key));
+    } else if (channel == "kline") {
+        if (!isKlineInterval(interval)) {
+            reject(hdl, "Unknown interval: " + interval);
+            return;
+        }
+        std::string key = klineKey(symbol, interval);
+        std::lock_guard<std::mutex> klineLock(klineMutex_);
+        PublicationPtr current;
+        const KlineSeries* series = klines_.find(symbol, interval);
+        if (series != nullptr && series->latest() != nullptr) {
+            current = makePublication(Publication::Kind::KLINE, key, serializeKline(symbol, *series, *series->latest()));
+        }
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        auto session = sessions_.find(hdl);
+        if (session == sessions_.end() || !session->second.subscriptions.insert(key).second) {
+            return;
+        }
+        subscribers_[key].insert(hdl);
+        enqueue(session->second, makeControl("SUBSCRIBED", key));
+        if (current) {
+            enqueue(session->second, current);
+        }
+    } else {
+        reject(hdl, "Unknown channel: " + channel);
+        return;
+    }
+    schedule_flush();
+}
+
+void WebSocketServer::unsubscribe(websocketpp::connection_hdl hdl, const std::string& key) {
+    {
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        auto session = sessions_.find(hdl);
+        if (session == sessions_.end() || session->second.subscriptions.erase(key) == 0) {
+            return;
+        }
+        session->second.resyncKeys.erase(key);
+        auto subscribers = subscribers_.find(key);
+        subscribers->second.erase(hdl);
+        if (subscribers->second.empty()) {
+            subscribers_.erase(subscribers);
+        }
+        enqueue(session->second, makeControl("UNSUBSCRIBED", key));
+    }
+    schedule_flush();
+}
+
+void WebSocketServer::reject(websocketpp::connection_hdl hdl, const std::string& error) {
+    {
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        auto session = sessions_.find(hdl);
+        if (session == sessions_.end()) {
+            return;
+        }
+        enqueue(session->second, makeControl("ERROR", "", error));
+    }
+    schedule_flush();
+}
+
+DepthPublisher& WebSocketServer::depth_view(const std::string& symbol, size_t depth) {
+    std::map<size_t, DepthPublisher>& views = depthViews_[symbol];
+    auto it = views.find(depth);
+    if (it == views.end()) {
+        // 新视图以当前状态为比较基准；上游尚未同步时为空，之后的增量会补齐
+        it = views.emplace(depth, DepthPublisher(depth)).first;
+        it->second.snapshot(orderBooks_[symbol]);
+    }
+    return it->second;
+}
+
+void WebSocketServer::fan_out(const std::vector<PublicationPtr>& publications) {
+    {
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        auto start = std::chrono::steady_clock::now();
+        for (const PublicationPtr& publication : publications) {
+            publish(publication);
+        }
+        metrics_.fanOutLatency.record(elapsedNanos(start, std::chrono::steady_clock::now()));
+    }
+    schedule_flush();
+}
+
+void WebSocketServer::publish(const PublicationPtr& publication) {
+    auto subscribers = subscribers_.find(publication->key);
+    if (subscribers == subscribers_.end()) {
+        return;
+    }
+    for (const websocketpp::connection_hdl& hdl : subscribers->second) {
+        auto session = sessions_.find(hdl);
+        if (session != sessions_.end()) {
+            enqueue(session->second, publication);
+        }
+    }
+}
+
+void WebSocketServer::enqueue(ClientSession& session, const PublicationPtr& publication) {
+    if (session.queue.size() >= config_.maxQueuedMessages) {
+        shed(session);
+    }
+    // 待补快照的深度订阅，中间的增量已无意义
+    if (publication->kind == Publication::Kind::DEPTH_DELTA && session.resyncKeys.count(publication->key) > 0) {
+        ++session.droppedMessages;
+        metrics_.framesDropped.add();
+        return;
+    }
+    if (session.queue.size() >= config_.maxQueuedMessages) {
+        // 剩下的都是成交流水和应答，丢弃最旧的
+        session.queue.pop_front();
+        ++session.droppedMessages;
+        metrics_.framesDropped.add();
+    }
+    session.queue.push_back(publication);
+}
+
+void WebSocketServer::shed(ClientSession& session) {
+    // 队列已满：丢掉所有深度消息，等队列排空后补发一次快照；K 线每个订阅只保留最新的一根
+    std::deque<PublicationPtr> kept;
+    std::set<std::string> latestKlines;
+    size_t before = session.queue.size();
+    for (auto it = session.queue.rbegin(); it != session.queue.rend(); ++it) {
+        const Publication& publication = **it;
+        if (publication.kind == Publication::Kind::DEPTH_SNAPSHOT || publication.kind == Publication::Kind::DEPTH_DELTA) {
+            session.resyncKeys.insert(publication.key);
+            continue;
+        }
+        if (publication.kind == Publication::Kind::KLINE && !latestKlines.insert(publication.key).second) {
+            continue;
+        }
+        kept.push_front(*it);
+    }
+    session.queue.swap(kept);
+    session.droppedMessages += before - session.queue.size();
+    metrics_.framesDropped.add(before - session.queue.size());
+    LOG_WARN("WebSocket client backlog full, dropped " + std::to_string(before - session.queue.size()) + " queued messages");
+}
+
+void WebSocketServer::schedule_flush() {
+    // 同一时刻最多投递一次，突发的推送合并成一次写出
+    if (!flushScheduled_.exchange(true)) {
+        m_server.get_io_service().post([this]() { flush(); });
+    }
+}
+
+void WebSocketServer::flush() {
+    flushScheduled_ = false;
+    std::vector<std::pair<websocketpp::connection_hdl, std::string>> pendingResync;
+    bool backlogged = false;
+    {
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        for (auto& entry : sessions_) {
+            ClientSession& session = entry.second;
+            if (!session.queue.empty()) {
+                websocketpp::lib::error_code ec;
+                server::connection_ptr con = m_server.get_con_from_hdl(entry.first, ec);
+                if (ec) {
+                    continue;
+                }
+                // send 只把数据放进连接的发送缓冲，不阻塞；缓冲超过水位的慢连接留到下次重试
+                // 同一推送只在首个订阅者处组帧一次，其余连接共享同一条消息，不再逐连接复制和组帧
+                while (!session.queue.empty() && con->get_buffered_amount() < config_.maxBufferedBytes) {
+                    const Publication& publication = *session.queue.front();
+                    if (!session.sharedFrames) {
+                        con->send(publication.payload.data(), publication.payload.size(), websocketpp::frame::opcode::text);
+                    } else {
+                        if (!publication.frame) {
+                            publication.frame = prepareTextFrame(con, publication.payload);
+                        }
+                        con->send(publication.frame);
+                    }
+                    session.queue.pop_front();
+                    metrics_.framesSent.add();
+                }
+                if (!session.queue.empty()) {
+                    backlogged = true;
+                    continue;
+                }
+            }
+            for (const std::string& key : session.resyncKeys) {
+                pendingResync.emplace_back(entry.first, key);
+            }
+            session.resyncKeys.clear();
+        }
+    }
+
+    if (!pendingResync.empty()) {
+        resync(pendingResync);
+    }
+    if (backlogged && !retryScheduled_) {
+        retryScheduled_ = true;
+        m_server.set_timer(config_.retryIntervalMs, [this](const websocketpp::lib::error_code&) {
+            retryScheduled_ = false;
+            flush();
+        });
+    }
+}
+
+void WebSocketServer::resync(const std::vector<std::pair<websocketpp::connection_hdl, std::string>>& pending) {
+    std::map<std::string, PublicationPtr> snapshots;
+    {
+        std::lock_guard<std::mutex> bookLock(orderBookMutex_);
+        std::lock_guard<std::mutex> lock(m_connection_lock);
+        for (const auto& entry : pending) {
+            auto session = sessions_.find(entry.first);
+            if (session == sessions_.end() || session->second.subscriptions.count(entry.second) == 0) {
+                continue;
+            }
+            // 订阅键形如 "depth:<symbol>:<depth>"
+            PublicationPtr& snapshot = snapshots[entry.second];
+            if (!snapshot) {
+                size_t separator = entry.second.rfind(':');
+                std::string symbol = entry.second.substr(6, separator - 6);
+                size_t depth = std::stoul(entry.second.substr(separator + 1));
+                snapshot = makePublication(Publication::Kind::DEPTH_SNAPSHOT, entry.second,
+                                           serializeDepthUpdate(symbol, depth_view(symbol, depth).published()));
+            }
+            enqueue(session->second, snapshot);
+        }
+    }
+    schedule_flush();
 }
@@ -0,0 +1,450 @@
+#include "WireProtocol.h"
+#include <algorithm>
+#include <cstddef>
+#include <iomanip>
+#include <sstream>
+
+namespace {
+    WireHeader makeHeader(WireMessageType type, size_t messageSize) {
+        WireHeader header;
+        header.magic = WIRE_MAGIC;
+        header.version = WIRE_VERSION;
+        header.type = static_cast<uint8_t>(type);
+        header.length = static_cast<uint32_t>(messageSize - sizeof(WireHeader));
+        return header;
+    }
+
+    void writeSymbol(char (&field)[MAX_SYMBOL_LENGTH + 1], const std::string& symbol) {
+        if (symbol.size() > MAX_SYMBOL_LENGTH) {
+            throw std::invalid_argument("Symbol too long for wire message: " + symbol);
+        }
+        std::memset(field, 0, sizeof(field));
+        std::memcpy(field, symbol.data(), symbol.size());
+    }
+
+    std::string readSymbol(const char (&field)[MAX_SYMBOL_LENGTH + 1]) {
+        return std::string(field, strnlen(field, sizeof(field)));
+    }
+
+    // 枚举字节超出定义范围（大于最后一个枚举值 last）时抛异常，避免被当作某个合法取值继续处理；
+    // UNKNOWN 原样返回，由撮合引擎的订单校验拒绝
+    template <typename Enum>
+    Enum readWireEnum(uint8_t value, Enum last, const char* field) {
+        if (value > static_cast<uint8_t>(last)) {
+            throw std::runtime_error(std::string("Invalid ") + field + " in wire message: " + std::to_string(value));
+        }
+        return static_cast<Enum>(value);
+    }
+
+    void releaseOwnedString(void*, void* hint) {
+        delete static_cast<std::string*>(hint);
+    }
+}
+
+WireFormat stringToWireFormat(const std::string& str) {
+    if (str == "json" || str == "JSON") return WireFormat::JSON;
+    if (str == "binary" || str == "BINARY") return WireFormat::BINARY;
+    throw std::invalid_argument("Unknown wire format: " + str);
+}
+
+std::string wireMessageTypeToString(WireMessageType type) {
+    switch (type) {
+        case WireMessageType::NEW_ORDER: return "ORDER";
+        case WireMessageType::CANCEL: return "CANCEL";
+        case WireMessageType::CANCEL_ALL: return "CANCEL_ALL";
+        case WireMessageType::MASS_ORDER: return "MASS_ORDER";
+        case WireMessageType::AMEND: return "AMEND";
+        case WireMessageType::TRADE: return "TRADE";
+        case WireMessageType::UNMATCHED_ORDER: return "UNMATCHED_ORDER";
+        case WireMessageType::CANCELED: return "CANCELED";
+        case WireMessageType::EXPIRED: return "EXPIRED";
+        case WireMessageType::AMENDED: return "AMENDED";
+        case WireMessageType::CANCEL_REJECTED: return "CANCEL_REJECTED";
+        case WireMessageType::AMEND_REJECTED: return "AMEND_REJECTED";
+        case WireMessageType::ORDER_REJECTED: return "ORDER_REJECTED";
+        case WireMessageType::BOOK_SNAPSHOT_REQUEST: return "BOOK_SNAPSHOT_REQUEST";
+        case WireMessageType::BOOK_SNAPSHOT: return "BOOK_SNAPSHOT";
+        case WireMessageType::BOOK_DELTA: return "BOOK_DELTA";
+        case WireMessageType::TRADE_PRINTS: return "TRADE_PRINTS";
+        default: return "UNKNOWN";
+    }
+}
+
+bool isBinaryMessage(const void* data, size_t size) {
+    if (size < sizeof(WireHeader)) {
+        return false;
+    }
+    uint16_t magic;
+    std::memcpy(&magic, data, sizeof(magic));
+    return magic == WIRE_MAGIC;
+}
+
+WireMessageType readWireHeader(const void* data, size_t size) {
+    if (!isBinaryMessage(data, size)) {
+        throw std::runtime_error("Not a binary wire message");
+    }
+    WireHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (header.version != WIRE_VERSION) {
+        throw std::runtime_error("Unsupported wire protocol version: " + std::to_string(header.version));
+    }
+    if (sizeof(WireHeader) + header.length != size) {
+        throw std::runtime_error("Wire message length mismatch");
+    }
+    return static_cast<WireMessageType>(header.type);
+}
+
+std::string readWireSymbol(const void* data, size_t size) {
+    size_t offset;
+    switch (readWireHeader(data, size)) {
+        case WireMessageType::NEW_ORDER:
+            offset = offsetof(OrderWireMessage, order) + offsetof(WireOrder, symbol);
+            break;
+        case WireMessageType::CANCEL:
+            offset = offsetof(CancelWireMessage, symbol);
+            break;
+        case WireMessageType::CANCEL_ALL:
+            offset = offsetof(CancelAllWireMessage, symbol);
+            break;
+        case WireMessageType::MASS_ORDER:
+            offset = sizeof(WireHeader) + offsetof(WireMassOrderHeader, symbol);
+            break;
+        case WireMessageType::AMEND:
+            offset = offsetof(AmendWireMessage, symbol);
+            break;
+        case WireMessageType::BOOK_SNAPSHOT_REQUEST:
+            offset = offsetof(BookSnapshotRequestWireMessage, symbol);
+            break;
+        default:
+            throw std::runtime_error("Wire message carries no symbol");
+    }
+    if (offset + MAX_SYMBOL_LENGTH + 1 > size) {
+        throw std::runtime_error("Wire message too short for symbol");
+    }
+    char field[MAX_SYMBOL_LENGTH + 1];
+    std::memcpy(field, static_cast<const char*>(data) + offset, sizeof(field));
+    return readSymbol(field);
+}
+
+WireOrder toWireOrder(const Order& order) {
+    WireOrder wire;
+    wire.orderId = order.orderId;
+    wire.userId = order.userId;
+    writeSymbol(wire.symbol, order.symbol);
+    wire.price = order.price;
+    wire.quantity = order.quantity;
+    wire.feeRate = order.feeRate;
+    wire.filledQuantity = order.filledQuantity;
+    wire.createTime = toNanos(order.createTime);
+    wire.updateTime = toNanos(order.updateTime);
+    wire.orderSide = static_cast<uint8_t>(order.orderSide);
+    wire.orderType = static_cast<uint8_t>(order.orderType);
+    wire.status = static_cast<uint8_t>(order.status);
+    wire.timeInForce = static_cast<uint8_t>(order.timeInForce);
+    return wire;
+}
+
+Order fromWireOrder(const WireOrder& wire) {
+    Order order;
+    order.orderId = wire.orderId;
+    order.userId = wire.userId;
+    order.symbol = readSymbol(wire.symbol);
+    order.price = wire.price;
+    order.quantity = wire.quantity;
+    order.feeRate = wire.feeRate;
+    order.filledQuantity = wire.filledQuantity;
+    order.createTime = fromNanos(wire.createTime);
+    order.updateTime = fromNanos(wire.updateTime);
+    order.orderSide = readWireEnum(wire.orderSide, OrderSide::UNKNOWN, "order side");
+    order.orderType = readWireEnum(wire.orderType, OrderType::UNKNOWN, "order type");
+    order.status = readWireEnum(wire.status, OrderStatus::UNKNOWN, "order status");
+    order.timeInForce = readWireEnum(wire.timeInForce, TimeInForce::UNKNOWN, "time in force");
+    return order;
+}
+
+WireTrade toWireTrade(const TradeRecord& trade) {
+    WireTrade wire;
+    wire.tradeId = trade.tradeId;
+    wire.buyerUserId = trade.buyerUserId;
+    wire.sellerUserId = trade.sellerUserId;
+    wire.buyerOrderId = trade.buyerOrderId;
+    wire.sellerOrderId = trade.sellerOrderId;
+    wire.takerSide = static_cast<uint8_t>(trade.orderType == "SELL" ? OrderSide::SELL : OrderSide::BUY);
+    wire.tradePrice = trade.tradePrice;
+    wire.tradeQuantity = trade.tradeQuantity;
+    wire.buyerFee = trade.buyerFee;
+    wire.sellerFee = trade.sellerFee;
+    wire.tradeTime = toNanos(trade.tradeTime);
+    return wire;
+}
+
+TradeRecord fromWireTrade(const WireTrade& wire) {
+    TradeRecord trade;
+    trade.tradeId = wire.tradeId;
+    trade.buyerUserId = wire.buyerUserId;
+    trade.sellerUserId = wire.sellerUserId;
+    trade.buyerOrderId = wire.buyerOrderId;
+    trade.sellerOrderId = wire.sellerOrderId;
+    trade.orderType = static_cast<OrderSide>(wire.takerSide) == OrderSide::SELL ? "SELL" : "BUY";
+    trade.tradePrice = wire.tradePrice;
+    trade.tradeQuantity = wire.tradeQuantity;
+    trade.buyerFee = wire.buyerFee;
+    trade.sellerFee = wire.sellerFee;
+    trade.tradeTime = fromNanos(wire.tradeTime);
+    return trade;
+}
+
+OrderWireMessage encodeOrderMessage(WireMessageType type, const Order& order) {
+    OrderWireMessage message;
+    message.header = makeHeader(type, sizeof(message));
+    message.order = toWireOrder(order);
+    return message;
+}
+
+CancelWireMessage encodeCancelMessage(const std::string& symbol, uint32_t orderId) {
+    CancelWireMessage message;
+    message.header = makeHeader(WireMessageType::CANCEL, sizeof(message));
+    writeSymbol(message.symbol, symbol);
+    message.orderId = orderId;
+    return message;
+}
+
+CancelAllWireMessage encodeCancelAllMessage(const std::string& symbol, uint64_t userId) {
+    CancelAllWireMessage message;
+    message.header = makeHeader(WireMessageType::CANCEL_ALL, sizeof(message));
+    writeSymbol(message.symbol, symbol);
+    message.userId = userId;
+    return message;
+}
+
+AmendWireMessage encodeAmendMessage(const std::string& symbol, uint32_t orderId, Price price, Quantity quantity) {
+    AmendWireMessage message;
+    message.header = makeHeader(WireMessageType::AMEND, sizeof(message));
+    writeSymbol(message.symbol, symbol);
+    message.orderId = orderId;
+    message.price = price;
+    message.quantity = quantity;
+    return message;
+}
+
+TradeWireMessage encodeTradeMessage(const Order& buyOrder, const Order& sellOrder, const TradeRecord& trade) {
+    TradeWireMessage message;
+    message.header = makeHeader(WireMessageType::TRADE, sizeof(message));
+    message.buyOrder = toWireOrder(buyOrder);
+    message.sellOrder = toWireOrder(sellOrder);
+    message.trade = toWireTrade(trade);
+    return message;
+}
+
+RejectWireMessage encodeRejectMessage(WireMessageType type, uint32_t orderId, const std::string& reason) {
+    RejectWireMessage message;
+    message.header = makeHeader(type, sizeof(message));
+    message.orderId = orderId;
+    std::memset(message.reason, 0, sizeof(message.reason));
+    std::memcpy(message.reason, reason.data(), std::min(reason.size(), sizeof(message.reason) - 1));
+    return message;
+}
+
+BookSnapshotRequestWireMessage encodeBookSnapshotRequest(const std::string& symbol) {
+    BookSnapshotRequestWireMessage message;
+    message.header = makeHeader(WireMessageType::BOOK_SNAPSHOT_REQUEST, sizeof(message));
+    writeSymbol(message.symbol, symbol);
+    return message;
+}
+
+std::string encodeMassOrderMessage(const Order& common, const std::vector<MassInstruction>& instructions) {
+    if (instructions.size() > MAX_MASS_ORDER_INSTRUCTIONS) {
+        throw std::invalid_argument("Too many instructions for MASS_ORDER: " + std::to_string(instructions.size()));
+    }
+    std::string buffer(sizeof(WireHeader) + sizeof(WireMassOrderHeader) + instructions.size() * sizeof(WireMassInstruction), '\0');
+    WireHeader header = makeHeader(WireMessageType::MASS_ORDER, buffer.size());
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    WireMassOrderHeader mass;
+    writeSymbol(mass.symbol, common.symbol);
+    mass.userId = common.userId;
+    mass.createTime = toNanos(common.createTime);
+    mass.count = static_cast<uint16_t>(instructions.size());
+    std::memcpy(&buffer[sizeof(WireHeader)], &mass, sizeof(mass));
+
+    size_t offset = sizeof(WireHeader) + sizeof(WireMassOrderHeader);
+    for (const MassInstruction& instruction : instructions) {
+        WireMassInstruction wire;
+        wire.action = static_cast<uint8_t>(instruction.action);
+        wire.orderSide = static_cast<uint8_t>(instruction.orderSide);
+        wire.orderType = static_cast<uint8_t>(instruction.orderType);
+        wire.timeInForce = static_cast<uint8_t>(instruction.timeInForce);
+        wire.orderId = instruction.orderId;
+        wire.price = instruction.price;
+        wire.quantity = instruction.quantity;
+        wire.feeRate = instruction.feeRate;
+        std::memcpy(&buffer[offset], &wire, sizeof(wire));
+        offset += sizeof(wire);
+    }
+    return buffer;
+}
+
+void decodeMassOrderMessage(const void* data, size_t size, Order& common, std::vector<MassInstruction>& instructions) {
+    if (readWireHeader(data, size) != WireMessageType::MASS_ORDER) {
+        throw std::runtime_error("Not a MASS_ORDER wire message");
+    }
+    if (size < sizeof(WireHeader) + sizeof(WireMassOrderHeader)) {
+        throw std::runtime_error("MASS_ORDER wire message too short");
+    }
+    const char* p = static_cast<const char*>(data) + sizeof(WireHeader);
+    WireMassOrderHeader mass;
+    std::memcpy(&mass, p, sizeof(mass));
+    p += sizeof(mass);
+    if (size != sizeof(WireHeader) + sizeof(WireMassOrderHeader) + mass.count * sizeof(WireMassInstruction)) {
+        throw std::runtime_error("MASS_ORDER wire message count mismatch");
+    }
+    if (mass.count > MAX_MASS_ORDER_INSTRUCTIONS) {
+        throw std::runtime_error("Too many instructions in MASS_ORDER: " + std::to_string(mass.count));
+    }
+
+    common.symbol = readSymbol(mass.symbol);
+    common.userId = mass.userId;
+    common.createTime = fromNanos(mass.createTime);
+    instructions.resize(mass.count);
+    for (MassInstruction& instruction : instructions) {
+        WireMassInstruction wire;
+        std::memcpy(&wire, p, sizeof(wire));
+        instruction.action = readWireEnum(wire.action, MassAction::AMEND, "mass order action");
+        instruction.orderSide = readWireEnum(wire.orderSide, OrderSide::UNKNOWN, "order side");
+        instruction.orderType = readWireEnum(wire.orderType, OrderType::UNKNOWN, "order type");
+        instruction.timeInForce = readWireEnum(wire.timeInForce, TimeInForce::UNKNOWN, "time in force");
+        instruction.orderId = wire.orderId;
+        instruction.price = wire.price;
+        instruction.quantity = wire.quantity;
+        instruction.feeRate = wire.feeRate;
+        p += sizeof(wire);
+    }
+}
+
+std::string encodeDepthMessage(const DepthUpdate& update) {
+    size_t levelCount = update.bids.size() + update.asks.size();
+    std::string buffer(sizeof(WireHeader) + sizeof(WireDepthHeader) + levelCount * sizeof(WireDepthLevel), '\0');
+    WireHeader header = makeHeader(update.snapshot ? WireMessageType::BOOK_SNAPSHOT : WireMessageType::BOOK_DELTA, buffer.size());
+    std::memcpy(&buffer[0], &header, sizeof(header));
+
+    WireDepthHeader depth;
+    depth.sequence = update.sequence;
+    depth.bidCount = static_cast<uint16_t>(update.bids.size());
+    depth.askCount = static_cast<uint16_t>(update.asks.size());
+    std::memcpy(&buffer[sizeof(WireHeader)], &depth, sizeof(depth));
+
+    size_t offset = sizeof(WireHeader) + sizeof(WireDepthHeader);
+    for (const std::vector<DepthLevel>* side : {&update.bids, &update.asks}) {
+        for (const DepthLevel& level : *side) {
+            WireDepthLevel wire{level.price, level.quantity};
+            std::memcpy(&buffer[offset], &wire, sizeof(wire));
+            offset += sizeof(wire);
+        }
+    }
+    return buffer;
+}
+
+DepthUpdate decodeDepthMessage(const void* data, size_t size) {
+    WireMessageType type = readWireHeader(data, size);
+    if (type != WireMessageType::BOOK_SNAPSHOT && type != WireMessageType::BOOK_DELTA) {
+        throw std::runtime_error("Not a BOOK_SNAPSHOT / BOOK_DELTA wire message");
+    }
+    if (size < sizeof(WireHeader) + sizeof(WireDepthHeader)) {
+        throw std::runtime_error("Depth wire message too short");
+    }
+
+    const char* p = static_cast<const char*>(data) + sizeof(WireHeader);
+    WireDepthHeader depth;
+    std::memcpy(&depth, p, sizeof(depth));
+    p += sizeof(depth);
+    if (size != sizeof(WireHeader) + sizeof(WireDepthHeader) + (depth.bidCount + depth.askCount) * sizeof(WireDepthLevel)) {
+        throw std::runtime_error("Depth wire message level count mismatch");
+    }
+
+    DepthUpdate update;
+    update.snapshot = type == WireMessageType::BOOK_SNAPSHOT;
+    update.sequence = depth.sequence;
+    update.bids.resize(depth.bidCount);
+    update.asks.resize(depth.askCount);
+    for (std::vector<DepthLevel>* side : {&update.bids, &update.asks}) {
+        for (DepthLevel& level : *side) {
+            WireDepthLevel wire;
+            std::memcpy(&wire, p, sizeof(wire));
+            level.price = wire.price;
+            level.quantity = wire.quantity;
+            p += sizeof(wire);
+        }
+    }
+    return update;
+}
+
+std::string encodeTradePrintsMessage(const std::vector<TradePrint>& trades) {
+    uint32_t count = static_cast<uint32_t>(trades.size());
+    std::string buffer(sizeof(WireHeader) + sizeof(count) + trades.size() * sizeof(WireTradePrint), '\0');
+    WireHeader header = makeHeader(WireMessageType::TRADE_PRINTS, buffer.size());
+    std::memcpy(&buffer[0], &header, sizeof(header));
+    std::memcpy(&buffer[sizeof(WireHeader)], &count, sizeof(count));
+
+    size_t offset = sizeof(WireHeader) + sizeof(count);
+    for (const TradePrint& trade : trades) {
+        WireTradePrint wire;
+        wire.tradeId = trade.tradeId;
+        wire.takerSide = static_cast<uint8_t>(trade.takerSide);
+        wire.price = trade.price;
+        wire.quantity = trade.quantity;
+        wire.tradeTime = toNanos(trade.tradeTime);
+        std::memcpy(&buffer[offset], &wire, sizeof(wire));
+        offset += sizeof(wire);
+    }
+    return buffer;
+}
+
+std::vector<TradePrint> decodeTradePrintsMessage(const void* data, size_t size) {
+    if (readWireHeader(data, size) != WireMessageType::TRADE_PRINTS) {
+        throw std::runtime_error("Not a TRADE_PRINTS wire message");
+    }
+    uint32_t count;
+    if (size < sizeof(WireHeader) + sizeof(count)) {
+        throw std::runtime_error("TRADE_PRINTS wire message too short");
+    }
+    const char* p = static_cast<const char*>(data) + sizeof(WireHeader);
+    std::memcpy(&count, p, sizeof(count));
+    p += sizeof(count);
+    if (size != sizeof(WireHeader) + sizeof(count) + count * sizeof(WireTradePrint)) {
+        throw std::runtime_error("TRADE_PRINTS wire message count mismatch");
+    }
+
+    std::vector<TradePrint> trades(count);
+    for (TradePrint& trade : trades) {
+        WireTradePrint wire;
+        std::memcpy(&wire, p, sizeof(wire));
+        trade.tradeId = wire.tradeId;
+        trade.takerSide = static_cast<OrderSide>(wire.takerSide);
+        trade.price = wire.price;
+        trade.quantity = wire.quantity;
+        trade.tradeTime = fromNanos(wire.tradeTime);
+        p += sizeof(wire);
+    }
+    return trades;
+}
+
+std::string formatBookTable(const std::string& symbol, const std::vector<BookEntry>& entries) {
+    std::ostringstream oss;
+    oss << "Symbol: " << symbol << "\n";
+    oss << std::left << std::setw(12) << "Order Side" << " | "
+        << std::setw(8) << "Price" << " | "
+        << std::setw(8) << "Quantity" << "\n";
+    oss << std::string(36, '-') << "\n";
+
+    for (const BookEntry& entry : entries) {
+        oss << std::left << std::setw(12) << (entry.side == OrderSide::BUY ? "BUY" : "SELL") << " | "
+            << std::setw(8) << formatFixed(entry.price, PRICE_DECIMALS) << " | "
+            << std::setw(8) << formatFixed(entry.quantity, QUANTITY_DECIMALS) << "\n";
+    }
+    return oss.str();
+}
+
+zmq::message_t toZmqMessage(std::string&& data) {
+    std::string* owned = new std::string(std::move(data));
+    return zmq::message_t(&(*owned)[0], owned->size(), releaseOwnedString, owned);
+}